@@ -41,6 +41,66 @@ CREATE OR REPLACE FUNCTION firebird_fdw_close_connections()
   AS 'MODULE_PATHNAME'
 LANGUAGE C STRICT;
 
+CREATE OR REPLACE FUNCTION firebird_fdw_cache_invalidate(relation regclass DEFAULT NULL)
+  RETURNS pg_catalog.int4
+  AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE PARALLEL UNSAFE;
+
+CREATE TABLE firebird_fdw_mirror (
+  foreign_table regclass PRIMARY KEY,
+  local_table   regclass NOT NULL,
+  remote_id     oid NOT NULL
+);
+
+SELECT pg_catalog.pg_extension_config_dump('firebird_fdw_mirror', '');
+
+CREATE OR REPLACE FUNCTION firebird_fdw_create_mirror(foreign_table regclass, local_table regclass)
+  RETURNS void
+  AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_sync_mirror(foreign_table regclass DEFAULT NULL)
+  RETURNS pg_catalog.int8
+  AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE PARALLEL UNSAFE;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_drop_mirror(foreign_table regclass)
+  RETURNS void
+  AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_export(
+    server_name TEXT,
+    query TEXT,
+    path TEXT,
+    format TEXT DEFAULT 'csv',
+    header BOOL DEFAULT false
+  )
+  RETURNS pg_catalog.int8
+  AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_bulk_load(
+    foreign_table REGCLASS,
+    query TEXT,
+    commit_every BIGINT DEFAULT 0,
+    resume_from BIGINT DEFAULT 0,
+    part INT DEFAULT 0,
+    parts INT DEFAULT 1
+  )
+  RETURNS pg_catalog.int8
+  AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_query(
+    server_name TEXT,
+    query TEXT,
+    VARIADIC params TEXT[] DEFAULT '{}'
+  )
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
 CREATE OR REPLACE FUNCTION firebird_fdw_server_options(
     IN server_name TEXT,
     OUT name TEXT,
@@ -67,3 +127,50 @@ CREATE OR REPLACE FUNCTION firebird_version(
   RETURNS SETOF record
   AS 'MODULE_PATHNAME'
   LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_stat_statements(
+    OUT serverid OID,
+    OUT userid OID,
+    OUT dbid OID,
+    OUT query TEXT,
+    OUT calls INT8,
+    OUT total_time FLOAT8,
+    OUT mean_time FLOAT8,
+    OUT rows INT8,
+    OUT bytes INT8,
+    OUT local_conditions INT8
+  )
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+CREATE VIEW firebird_fdw_stat_statements AS
+  SELECT fs.srvname AS server_name, s.*
+    FROM firebird_fdw_stat_statements() s
+    LEFT JOIN pg_catalog.pg_foreign_server fs ON fs.oid = s.serverid;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_stat_statements_reset()
+  RETURNS void
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+REVOKE ALL ON FUNCTION firebird_fdw_stat_statements_reset() FROM PUBLIC;
+
+CREATE OR REPLACE FUNCTION firebird_fdw_connections(
+    OUT server_name TEXT,
+    OUT user_name TEXT,
+    OUT connected_at TIMESTAMPTZ,
+    OUT last_used TIMESTAMPTZ,
+    OUT xact_active BOOL,
+    OUT xact_depth INT4,
+    OUT xact_start TIMESTAMPTZ,
+    OUT statements INT8,
+    OUT round_trips INT8,
+    OUT bytes_sent INT8,
+    OUT bytes_received INT8,
+    OUT reconnects INT8,
+    OUT prepared_statements INT4
+  )
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME'
+  LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
@@ -0,0 +1,728 @@
+/*-------------------------------------------------------------------------
+ *
+ * Bulk loading via Firebird external tables for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/bulkload.c
+ *
+ * Where the Firebird server runs on the same host as PostgreSQL, rows can
+ * be loaded without transmitting them individually: they are written to
+ * a file in Firebird's external table format, in the directory specified
+ * by the server option "external_file_directory", and copied into the
+ * target table with a single "INSERT ... SELECT" from an external table
+ * defined on that file.
+ *
+ * Each value is written as a fixed-width length indicator (or "N" for
+ * NULL) followed by the value's text representation, padded to a width
+ * derived from the target column's Firebird datatype. Firebird converts
+ * the text to the column's datatype on insertion.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "firebird_fdw.h"
+
+#include <sys/stat.h>
+
+#if (PG_VERSION_NUM >= 110000)
+#include "catalog/pg_authid.h"
+#endif
+#include "catalog/pg_type.h"
+#include "executor/spi.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+
+
+/* Width of the length indicator preceding each value */
+#define FIREBIRD_BULK_LOAD_LENGTH_WIDTH 10
+
+/* Number of rows fetched from the source query at a time */
+#define FIREBIRD_BULK_LOAD_FETCH_SIZE 1000
+
+typedef struct fbBulkLoadColumn
+{
+	char	   *fb_column;		/* quoted Firebird column name */
+	char	   *fb_name;		/* Firebird column name as stored in metadata */
+	int			width;			/* maximum length of the value's text representation */
+} fbBulkLoadColumn;
+
+typedef struct fbBulkLoadState
+{
+	const char *relname;		/* name of the target foreign table */
+	Portal		portal;			/* cursor on the source query */
+	SPITupleTable *tuptable;	/* most recently fetched rows */
+	uint64		ntuples;		/* number of rows in tuptable */
+	uint64		next;			/* next row in tuptable to be processed */
+	int64		input_row;		/* number of source query rows consumed */
+	int64		committed_row;	/* source query rows up to here are committed */
+	int64		nrows;			/* number of rows loaded */
+	int64		commit_every;
+	int64		resume_from;
+	int			part;
+	int			parts;
+	bool		done;			/* source query exhausted */
+} fbBulkLoadState;
+
+extern Datum firebird_fdw_bulk_load(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(firebird_fdw_bulk_load);
+
+static fbBulkLoadColumn *fbBulkLoadGetColumns(Oid foreign_table, FirebirdFdwState *fdw_state,
+											  FBconn *conn, int *ncolumns);
+static int	fbBulkLoadColumnWidth(int field_type, int field_length);
+static int64 fbBulkLoadWriteFile(const char *path, fbBulkLoadState *state,
+								 fbBulkLoadColumn *columns, int ncolumns);
+static void fbBulkLoadExecRemote(FBconn *conn, char *query);
+static void fbBulkLoadErrorCallback(void *arg);
+
+
+/**
+ * firebird_fdw_bulk_load()
+ *
+ * Insert the rows returned by the provided query into the specified
+ * foreign table via a Firebird external table, returning the number of
+ * rows inserted.
+ *
+ * The load uses a separate connection, and is committed in Firebird
+ * independently of the local transaction. If "commit_every" is set,
+ * the rows are loaded and committed in chunks of that size; progress is
+ * reported after each chunk, and the number of source query rows
+ * processed is added to the context of any error, so that an
+ * interrupted load can be continued with "resume_from".
+ *
+ * "part" and "parts" restrict the load to the source query rows whose
+ * hash modulo "parts" equals "part", so a load can be split across
+ * several sessions. As the hash is derived from each row's values, rows
+ * are assigned to the same part in every session, whatever order the
+ * source query returns them in.
+ */
+Datum
+firebird_fdw_bulk_load(PG_FUNCTION_ARGS)
+{
+	Oid			foreign_table = PG_GETARG_OID(0);
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	FirebirdFdwState *fdw_state;
+	ForeignTable *table;
+	ForeignServer *server;
+	UserMapping *user;
+	fbServerOptions server_options = fbServerOptions_init;
+	char	   *directory = NULL;
+	char	   *path;
+	char	   *ext_table;
+	FBconn	   *volatile conn = NULL;
+	volatile bool ext_table_created = false;
+	fbBulkLoadColumn *columns;
+	int			ncolumns;
+	fbBulkLoadState state;
+	ErrorContextCallback errcallback;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	memset(&state, 0, sizeof(fbBulkLoadState));
+	state.commit_every = PG_GETARG_INT64(2);
+	state.resume_from = PG_GETARG_INT64(3);
+	state.part = PG_GETARG_INT32(4);
+	state.parts = PG_GETARG_INT32(5);
+	state.committed_row = state.resume_from;
+
+	if (state.commit_every < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"commit_every\" must be zero or a positive integer")));
+
+	if (state.resume_from < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"resume_from\" must be zero or a positive integer")));
+
+	if (state.parts < 1 || state.part < 0 || state.part >= state.parts)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"part\" must be between 0 and %i", state.parts - 1),
+				 errhint("\"parts\" must be a positive integer.")));
+
+	if (get_rel_relkind(foreign_table) != RELKIND_FOREIGN_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a foreign table",
+						get_rel_name(foreign_table))));
+
+	state.relname = get_rel_name(foreign_table);
+
+	/* Same permission requirements as INSERT on the foreign table */
+	if (pg_class_aclcheck(foreign_table, GetUserId(), ACL_INSERT) != ACLCHECK_OK)
+		aclcheck_error(ACLCHECK_NO_PRIV,
+#if (PG_VERSION_NUM >= 110000)
+					   OBJECT_FOREIGN_TABLE,
+#else
+					   ACL_KIND_CLASS,
+#endif
+					   state.relname);
+
+	fdw_state = getFdwState(foreign_table);
+
+	if (fdw_state->svr_query != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("unable to bulk load into foreign table \"%s\"",
+						state.relname),
+				 errdetail("Foreign tables defined with the \"query\" option are not updatable.")));
+
+	if (fdw_state->svr_procedure != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("unable to bulk load into foreign table \"%s\"",
+						state.relname),
+				 errdetail("Foreign tables defined with the \"procedure\" option are not updatable.")));
+
+	if (!firebirdIsTableUpdatable(foreign_table))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("unable to bulk load into foreign table \"%s\"",
+						state.relname),
+				 errdetail("Option \"updatable\" is set to \"false\" for the foreign table or its server.")));
+
+	table = GetForeignTable(foreign_table);
+	server = GetForeignServer(table->serverid);
+	user = GetUserMapping(GetUserId(), server->serverid);
+
+	server_options.external_file_directory.opt.strptr = &directory;
+	firebirdGetServerOptions(server, &server_options);
+
+	if (directory == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("option \"external_file_directory\" not set for foreign server \"%s\"",
+						server->servername)));
+
+	/* Writing files on the server requires the same privileges as COPY */
+#if (PG_VERSION_NUM >= 110000)
+#if (PG_VERSION_NUM >= 140000)
+	if (!has_privs_of_role(GetUserId(), ROLE_PG_WRITE_SERVER_FILES))
+#else
+	if (!has_privs_of_role(GetUserId(), DEFAULT_ROLE_WRITE_SERVER_FILES))
+#endif
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser or a member of the pg_write_server_files role to bulk load")));
+#else
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to bulk load")));
+#endif
+
+	path = psprintf("%s/fbfdw_bulk_load_%i.dat", directory, MyProcPid);
+	ext_table = psprintf("FBFDW_EXT_%i", MyProcPid);
+
+	/* Cached results of the foreign table would not reflect the load */
+	firebirdCacheNoteModification(foreign_table);
+
+	PG_TRY();
+	{
+		StringInfoData create_sql;
+		StringInfoData insert_sql;
+		char	   *drop_sql;
+		SPIPlanPtr	plan;
+		int			nestlevel;
+		int			i;
+
+		conn = firebirdOpenConnection(server, user);
+		FQsetAutocommit(conn, true);
+
+		columns = fbBulkLoadGetColumns(foreign_table, fdw_state, conn, &ncolumns);
+
+		/*
+		 * The external table must be committed before it can be used; as
+		 * the connection is in autocommit mode, each statement is
+		 * committed individually.
+		 */
+		initStringInfo(&create_sql);
+		appendStringInfo(&create_sql, "CREATE TABLE %s EXTERNAL FILE '", ext_table);
+
+		for (i = 0; path[i] != '\0'; i++)
+		{
+			if (path[i] == '\'')
+				appendStringInfoChar(&create_sql, '\'');
+			appendStringInfoChar(&create_sql, path[i]);
+		}
+
+		appendStringInfoString(&create_sql, "' (");
+
+		for (i = 0; i < ncolumns; i++)
+			appendStringInfo(&create_sql,
+							 "L_%i CHAR(%i) CHARACTER SET NONE, V_%i CHAR(%i) CHARACTER SET NONE, ",
+							 i + 1, FIREBIRD_BULK_LOAD_LENGTH_WIDTH,
+							 i + 1, columns[i].width);
+
+		appendStringInfoString(&create_sql, "EOL CHAR(1) CHARACTER SET NONE)");
+
+		initStringInfo(&insert_sql);
+		appendStringInfo(&insert_sql,
+						 "INSERT INTO %s (",
+						 quote_fb_identifier(fdw_state->svr_table,
+											 fdw_state->quote_identifier));
+
+		for (i = 0; i < ncolumns; i++)
+			appendStringInfo(&insert_sql, "%s%s", (i > 0) ? ", " : "", columns[i].fb_column);
+
+		appendStringInfoString(&insert_sql, ") SELECT ");
+
+		for (i = 0; i < ncolumns; i++)
+			appendStringInfo(&insert_sql,
+							 "%sCASE WHEN L_%i = 'N' THEN NULL ELSE SUBSTRING(V_%i FROM 1 FOR CAST(L_%i AS INTEGER)) END",
+							 (i > 0) ? ", " : "",
+							 i + 1, i + 1, i + 1);
+
+		appendStringInfo(&insert_sql, " FROM %s", ext_table);
+
+		drop_sql = psprintf("DROP TABLE %s", ext_table);
+
+		/* Ensure values are output in a format Firebird understands */
+		nestlevel = NewGUCNestLevel();
+		(void) set_config_option("datestyle", "ISO",
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+		(void) set_config_option("extra_float_digits", "3",
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+
+		/* Add each row's part number as an additional column */
+		if (state.parts > 1)
+			query = psprintf("SELECT fbfdw_q.*, "
+							 "(pg_catalog.hashtext(fbfdw_q::pg_catalog.text) & 2147483647) %% %i "
+							 "FROM (%s) fbfdw_q",
+							 state.parts, query);
+
+		SPI_connect();
+
+		plan = SPI_prepare(query, 0, NULL);
+
+		if (plan == NULL)
+			elog(ERROR, "unable to prepare query: %s", SPI_result_code_string(SPI_result));
+
+		state.portal = SPI_cursor_open(NULL, plan, NULL, NULL, true);
+
+		errcallback.callback = fbBulkLoadErrorCallback;
+		errcallback.arg = (void *) &state;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		while (state.done == false)
+		{
+			int64		chunk_rows = fbBulkLoadWriteFile(path, &state, columns, ncolumns);
+
+			if (chunk_rows > 0)
+			{
+				fbBulkLoadExecRemote(conn, create_sql.data);
+				ext_table_created = true;
+
+				fbBulkLoadExecRemote(conn, insert_sql.data);
+
+				ext_table_created = false;
+				fbBulkLoadExecRemote(conn, drop_sql);
+
+				state.nrows += chunk_rows;
+			}
+
+			state.committed_row = state.input_row;
+
+			if (state.commit_every > 0 && chunk_rows > 0)
+				ereport(NOTICE,
+						(errmsg("bulk load into \"%s\": " INT64_FORMAT " rows committed",
+								state.relname, state.nrows)));
+		}
+
+		error_context_stack = errcallback.previous;
+
+		SPI_cursor_close(state.portal);
+		SPI_finish();
+
+		AtEOXact_GUC(true, nestlevel);
+	}
+	PG_CATCH();
+	{
+		if (conn != NULL)
+		{
+			if (ext_table_created == true)
+			{
+				char	   *drop = psprintf("DROP TABLE %s", ext_table);
+
+				FQclear(FQexec(conn, drop));
+			}
+
+			FQfinish(conn);
+		}
+
+		(void) unlink(path);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	FQfinish(conn);
+
+	if (unlink(path) != 0 && errno != ENOENT)
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("could not remove file \"%s\": %m", path)));
+
+	PG_RETURN_INT64(state.nrows);
+}
+
+
+/**
+ * fbBulkLoadGetColumns()
+ *
+ * Return the Firebird names and maximum value widths of the foreign
+ * table's columns, in column order.
+ */
+static fbBulkLoadColumn *
+fbBulkLoadGetColumns(Oid foreign_table, FirebirdFdwState *fdw_state,
+					 FBconn *conn, int *ncolumns)
+{
+	Relation	rel = table_open(foreign_table, AccessShareLock);
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	fbBulkLoadColumn *columns = palloc0(sizeof(fbBulkLoadColumn) * tupdesc->natts);
+	const char *metadata_query =
+		"    SELECT TRIM(rf.rdb$field_name), f.rdb$field_type, f.rdb$field_length \n"
+		"      FROM rdb$relation_fields rf \n"
+		"INNER JOIN rdb$fields f \n"
+		"        ON rf.rdb$field_source = f.rdb$field_name \n"
+		"     WHERE TRIM(rf.rdb$relation_name) = ?";
+	char	   *p_values[1];
+	FBresult   *res;
+	int			i;
+	int			n = 0;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		char	   *colname = NULL;
+		bool		quote_col_identifier = fdw_state->quote_identifier;
+		fbColumnOptions column_options = fbColumnOptions_init;
+		StringInfoData fb_column;
+
+		if (att->attisdropped)
+			continue;
+
+		column_options.column_name = &colname;
+		column_options.quote_identifier = &quote_col_identifier;
+
+		firebirdGetColumnOptions(foreign_table, att->attnum, &column_options);
+
+		if (colname == NULL)
+			colname = pstrdup(NameStr(att->attname));
+		else
+			colname = pstrdup(colname);
+
+		initStringInfo(&fb_column);
+		convertColumnRef(&fb_column, foreign_table, att->attnum, fdw_state->quote_identifier);
+
+		if (quote_col_identifier == false)
+			unquoted_ident_to_upper(colname);
+
+		columns[n].fb_column = fb_column.data;
+		columns[n].fb_name = colname;
+		columns[n].width = -1;
+		n++;
+	}
+
+	table_close(rel, AccessShareLock);
+
+	/* Determine the column widths from the Firebird metadata */
+	p_values[0] = pstrdup(fdw_state->svr_table);
+
+	if (fdw_state->quote_identifier == false)
+		unquoted_ident_to_upper(p_values[0]);
+
+	res = FQexecParams(conn,
+					   metadata_query,
+					   1,
+					   NULL,
+					   (const char **) p_values,
+					   NULL,
+					   NULL,
+					   0);
+
+	if (FQresultStatus(res) != FBRES_TUPLES_OK)
+		fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, (char *) metadata_query);
+
+	for (i = 0; i < n; i++)
+	{
+		int			row;
+
+		for (row = 0; row < FQntuples(res); row++)
+		{
+			if (strcmp(FQgetvalue(res, row, 0), columns[i].fb_name) != 0)
+				continue;
+
+			columns[i].width = fbBulkLoadColumnWidth(atoi(FQgetvalue(res, row, 1)),
+													 atoi(FQgetvalue(res, row, 2)));
+			break;
+		}
+
+		if (columns[i].width == -1)
+		{
+			FQclear(res);
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" not found in Firebird table \"%s\"",
+							columns[i].fb_name, p_values[0])));
+		}
+
+		if (columns[i].width == 0)
+		{
+			FQclear(res);
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("datatype of Firebird column \"%s\" is not supported for bulk loading",
+							columns[i].fb_name)));
+		}
+	}
+
+	FQclear(res);
+
+	*ncolumns = n;
+
+	return columns;
+}
+
+
+/**
+ * fbBulkLoadColumnWidth()
+ *
+ * Return the maximum length of the text representation of a value of
+ * the provided Firebird datatype, or 0 if the datatype is not supported.
+ */
+static int
+fbBulkLoadColumnWidth(int field_type, int field_length)
+{
+	switch (field_type)
+	{
+		case 14:				/* CHAR */
+		case 37:				/* VARCHAR */
+			return Max(field_length, 1);
+		case 7:					/* SMALLINT / NUMERIC / DECIMAL */
+		case 8:					/* INTEGER / NUMERIC / DECIMAL */
+		case 16:				/* BIGINT / NUMERIC / DECIMAL */
+		case 26:				/* INT128 */
+		case 24:				/* DECFLOAT(16) */
+		case 25:				/* DECFLOAT(34) */
+			return 48;
+		case 10:				/* FLOAT */
+		case 27:				/* DOUBLE PRECISION */
+			return 32;
+		case 12:				/* DATE */
+			return 16;
+		case 13:				/* TIME */
+		case 35:				/* TIMESTAMP */
+			return 32;
+		case 28:				/* TIME WITH TIME ZONE */
+		case 29:				/* TIMESTAMP WITH TIME ZONE */
+			return 96;
+		case 23:				/* BOOLEAN */
+			return 5;
+		default:
+			return 0;
+	}
+}
+
+
+/**
+ * fbBulkLoadWriteFile()
+ *
+ * Write the next chunk of source query rows to the external table file,
+ * returning the number of rows written. Rows before "resume_from" and
+ * rows belonging to other parts are skipped; if the load is split into
+ * parts, the row's part number follows the foreign table's columns.
+ */
+static int64
+fbBulkLoadWriteFile(const char *path, fbBulkLoadState *state,
+					fbBulkLoadColumn *columns, int ncolumns)
+{
+	FILE	   *file;
+	StringInfoData buf;
+	int64		nrows = 0;
+	int			natts = (state->parts > 1) ? ncolumns + 1 : ncolumns;
+
+	file = AllocateFile(path, PG_BINARY_W);
+
+	if (file == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\" for writing: %m",
+						path)));
+
+	/*
+	 * The file must be readable by the Firebird server process, which is
+	 * expected to share the group of the external file directory; other
+	 * users must not be able to read the data being loaded.
+	 */
+	if (chmod(path, S_IRUSR | S_IWUSR | S_IRGRP) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not set permissions of file \"%s\": %m",
+						path)));
+
+	initStringInfo(&buf);
+
+	while (state->commit_every == 0 || nrows < state->commit_every)
+	{
+		HeapTuple	tuple;
+		TupleDesc	tupdesc;
+		int64		input_row;
+		int			col;
+
+		if (state->next >= state->ntuples)
+		{
+			if (state->tuptable != NULL)
+				SPI_freetuptable(state->tuptable);
+
+			SPI_cursor_fetch(state->portal, true, FIREBIRD_BULK_LOAD_FETCH_SIZE);
+
+			state->tuptable = SPI_tuptable;
+			state->ntuples = SPI_processed;
+			state->next = 0;
+
+			if (state->ntuples == 0)
+			{
+				state->done = true;
+				break;
+			}
+
+			if (state->tuptable->tupdesc->natts != natts)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATATYPE_MISMATCH),
+						 errmsg("query returns %i columns, but the foreign table has %i columns",
+								state->tuptable->tupdesc->natts - (natts - ncolumns),
+								ncolumns)));
+
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		tuple = state->tuptable->vals[state->next++];
+		tupdesc = state->tuptable->tupdesc;
+		input_row = state->input_row++;
+
+		if (input_row < state->resume_from)
+			continue;
+
+		if (state->parts > 1)
+		{
+			bool		isnull;
+			Datum		part = SPI_getbinval(tuple, tupdesc, ncolumns + 1, &isnull);
+
+			if (DatumGetInt32(part) != state->part)
+				continue;
+		}
+
+		resetStringInfo(&buf);
+
+		for (col = 0; col < ncolumns; col++)
+		{
+			char	   *value = SPI_getvalue(tuple, tupdesc, col + 1);
+			Oid			typid = SPI_gettypeid(tupdesc, col + 1);
+			int			len;
+
+			if (value == NULL)
+			{
+				appendStringInfo(&buf, "%-*s%*s",
+								 FIREBIRD_BULK_LOAD_LENGTH_WIDTH, "N",
+								 columns[col].width, "");
+				continue;
+			}
+
+			if (typid == BOOLOID)
+				value = (value[0] == 't') ? "TRUE" : "FALSE";
+			else if (typid == BYTEAOID)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("bytea values cannot be bulk loaded")));
+
+			len = strlen(value);
+
+			if (len > columns[col].width)
+				ereport(ERROR,
+						(errcode(ERRCODE_STRING_DATA_RIGHT_TRUNCATION),
+						 errmsg("value too long for Firebird column \"%s\"",
+								columns[col].fb_name)));
+
+			appendStringInfo(&buf, "%0*i%s%*s",
+							 FIREBIRD_BULK_LOAD_LENGTH_WIDTH, len,
+							 value,
+							 columns[col].width - len, "");
+		}
+
+		appendStringInfoChar(&buf, '\n');
+
+		if (fwrite(buf.data, 1, buf.len, file) != (size_t) buf.len)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							path)));
+
+		nrows++;
+	}
+
+	if (FreeFile(file))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m",
+						path)));
+
+	pfree(buf.data);
+
+	elog(DEBUG2, "%s: " INT64_FORMAT " rows written to \"%s\"",
+		 __func__, nrows, path);
+
+	return nrows;
+}
+
+
+/**
+ * fbBulkLoadExecRemote()
+ *
+ * Execute a statement returning no rows on Firebird.
+ */
+static void
+fbBulkLoadExecRemote(FBconn *conn, char *query)
+{
+	FBresult   *res;
+
+	elog(DEBUG2, "remote statement:\n%s", query);
+
+	res = FQexec(conn, query);
+
+	if (FQresultStatus(res) != FBRES_COMMAND_OK)
+		fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, query);
+
+	FQclear(res);
+}
+
+
+/**
+ * fbBulkLoadErrorCallback()
+ *
+ * Report how far a chunked load has progressed, so it can be resumed.
+ */
+static void
+fbBulkLoadErrorCallback(void *arg)
+{
+	fbBulkLoadState *state = (fbBulkLoadState *) arg;
+
+	if (state->commit_every == 0)
+		return;
+
+	errcontext("bulk load into \"%s\": " INT64_FORMAT " rows committed, resume with resume_from => " INT64_FORMAT,
+			   state->relname, state->nrows, state->committed_row);
+}
@@ -0,0 +1,697 @@
+/*-------------------------------------------------------------------------
+ *
+ * Remote query result cache for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/cache.c
+ *
+ * Results of remote queries on foreign tables with the "cache_ttl" option
+ * are retained for the specified number of seconds, and used for
+ * subsequent executions of the same query on the same connection,
+ * without contacting Firebird.
+ *
+ * The cache is local to the backend. Entries are invalidated when
+ * their TTL expires, when a foreign table they reference is modified
+ * via this backend, or explicitly with firebird_fdw_cache_invalidate().
+ * The total size of the cached results is limited by
+ * "firebird_fdw.cache_max_size"; the least recently used entries are
+ * discarded to make room for new ones.
+ * While the current transaction has modified a foreign table, the cache
+ * is bypassed, as results may contain uncommitted changes.
+ *
+ * Additionally, within the execution of a single query, scans issuing
+ * the same remote query on the same connection share one result (e.g.
+ * with self-joins, or a CTE referenced several times), so only one of
+ * them actually contacts Firebird. Shared results are released when
+ * the query's executor state is freed.
+ *
+ * Each scan has a single reference, allocated in the executor state's
+ * query context on first use, through which it reads cached and shared
+ * results. A result still referenced when that context is freed, e.g.
+ * because the query failed, is released then.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "firebird_fdw.h"
+
+#include "access/xact.h"
+#if (PG_VERSION_NUM >= 130000)
+#include "common/hashfn.h"
+#endif
+#include "lib/ilist.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+
+typedef struct ResultCacheKey
+{
+	Oid			serverid;		/* OID of foreign server */
+	Oid			userid;			/* OID of local user whose mapping we use */
+	uint32		query_hash;		/* hash of the query text */
+} ResultCacheKey;
+
+/*
+ * A cached result; this is referenced by the cache entry, and by any
+ * scans currently reading it, and is freed when no longer referenced.
+ */
+typedef struct CachedResultData
+{
+	FBresult   *res;
+	int			refcount;		/* number of scans reading the result */
+	bool		valid;			/* false if removed from the cache */
+} CachedResultData;
+
+/*
+ * A scan's reference to a cached or shared result; "data" is NULL while
+ * the reference is not in use.
+ */
+struct fbCachedResult
+{
+	CachedResultData *data;
+	MemoryContextCallback cb;	/* releases the reference if the query
+								 * context is freed first */
+};
+
+typedef struct ResultCacheEntry
+{
+	ResultCacheKey key;			/* hash key (must be first) */
+	char	   *query;			/* query text, to detect hash collisions */
+	int			nrelids;		/* number of foreign tables referenced */
+	Oid		   *relids;			/* OIDs of foreign tables referenced */
+	TimestampTz expires;		/* time after which the entry is invalid */
+	Size		size;			/* approximate size of the result */
+	dlist_node	lru_node;		/* position in ResultCacheLRU */
+	CachedResultData *result;
+} ResultCacheEntry;
+
+/*
+ * Global result cache (initialized on first use)
+ */
+static HTAB *ResultCacheHash = NULL;
+static MemoryContext ResultCacheContext = NULL;
+
+/* Cache entries, most recently used first, and their total size */
+static dlist_head ResultCacheLRU = DLIST_STATIC_INIT(ResultCacheLRU);
+static Size ResultCacheSize = 0;
+
+/* GUC variables */
+static int	fbCacheMaxSize = 65536;	/* in kilobytes */
+
+/* set if the current transaction has modified a foreign table */
+static bool xact_modified = false;
+
+/*
+ * A result shared by scans within a single query execution; entries
+ * are allocated in the executor state's query context.
+ */
+typedef struct SharedScanResult
+{
+	struct SharedScanResult *next;
+	EState	   *estate;			/* executor state the entry belongs to */
+	FBconn	   *conn;			/* connection the query was executed on */
+	char	   *query;			/* query text */
+	uint64		modification_count;	/* value of "modification_count" when stored */
+	CachedResultData *result;
+} SharedScanResult;
+
+static SharedScanResult *SharedScanResults = NULL;
+
+/*
+ * Incremented whenever a foreign table is modified; shared results
+ * stored before a modification are not used afterwards.
+ */
+static uint64 modification_count = 0;
+
+
+static void fbCacheSetup(void);
+static void firebirdCacheAddRef(fbCachedResult *cached, CachedResultData *data);
+static void firebirdCacheRefReset(void *arg);
+static void firebirdCacheRemoveEntry(ResultCacheEntry *entry);
+static void fb_cache_xact_callback(XactEvent event, void *arg);
+static void firebirdSharedResultsReset(void *arg);
+
+
+/**
+ * firebirdCacheInit()
+ *
+ * Called from _PG_init() to define the result cache GUCs.
+ */
+void
+firebirdCacheInit(void)
+{
+	DefineCustomIntVariable("firebird_fdw.cache_max_size",
+							"Sets the maximum total size of the results cached by each backend.",
+							"Zero disables the result cache.",
+							&fbCacheMaxSize,
+							65536,
+							0, MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+}
+
+
+/**
+ * fbCacheSetup()
+ *
+ * Set up the result cache on first use.
+ */
+static void
+fbCacheSetup(void)
+{
+	HASHCTL		ctl;
+
+	if (ResultCacheHash != NULL)
+		return;
+
+	elog(DEBUG2, "%s(): instantiating result cache", __func__);
+
+	ResultCacheContext = AllocSetContextCreate(CacheMemoryContext,
+											   "firebird_fdw result cache",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(ResultCacheKey);
+	ctl.entrysize = sizeof(ResultCacheEntry);
+	ctl.hcxt = ResultCacheContext;
+
+	ResultCacheHash = hash_create("firebird_fdw result cache", 64,
+								  &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	RegisterXactCallback(fb_cache_xact_callback, NULL);
+}
+
+
+/**
+ * firebirdCacheRefCreate()
+ *
+ * Create a scan's reference to cached and shared results. The reference
+ * is reused for each result the scan reads, and any result it still
+ * refers to is released when the query context of "estate" is freed.
+ */
+fbCachedResult *
+firebirdCacheRefCreate(EState *estate)
+{
+	fbCachedResult *cached;
+
+	cached = (fbCachedResult *) MemoryContextAlloc(estate->es_query_cxt,
+												   sizeof(fbCachedResult));
+	cached->data = NULL;
+	cached->cb.func = firebirdCacheRefReset;
+	cached->cb.arg = (void *) cached;
+	MemoryContextRegisterResetCallback(estate->es_query_cxt, &cached->cb);
+
+	return cached;
+}
+
+
+/**
+ * firebirdCacheLookup()
+ *
+ * Point the reference "cached" at the cached result of the provided
+ * query, returning false if none is available. The result should be
+ * released with firebirdCacheRelease(); otherwise this happens when
+ * the reference's query context is freed.
+ */
+bool
+firebirdCacheLookup(fbCachedResult *cached, Oid serverid, Oid userid, const char *query)
+{
+	ResultCacheKey key;
+	ResultCacheEntry *entry;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (ResultCacheHash == NULL || xact_modified == true)
+		return false;
+
+	/* Assume no pad bytes in key struct */
+	key.serverid = serverid;
+	key.userid = userid;
+	key.query_hash = string_hash(query, strlen(query) + 1);
+
+	entry = (ResultCacheEntry *) hash_search(ResultCacheHash, &key, HASH_FIND, NULL);
+
+	if (entry == NULL || strcmp(entry->query, query) != 0)
+		return false;
+
+	if (GetCurrentTimestamp() >= entry->expires)
+	{
+		elog(DEBUG2, "%s: entry expired", __func__);
+		firebirdCacheRemoveEntry(entry);
+		return false;
+	}
+
+	elog(DEBUG2, "%s: using cached result", __func__);
+
+	dlist_move_head(&ResultCacheLRU, &entry->lru_node);
+
+	firebirdCacheAddRef(cached, entry->result);
+
+	return true;
+}
+
+
+/**
+ * firebirdCacheStore()
+ *
+ * Add the result of the provided query to the cache, for "ttl" seconds,
+ * and point the reference "cached" at it. The cache takes ownership of
+ * "res"; the reference is handled as for firebirdCacheLookup(). If
+ * caching is not possible, e.g. because the result is larger than
+ * firebird_fdw.cache_max_size, false is returned and the caller retains
+ * ownership of "res".
+ */
+bool
+firebirdCacheStore(fbCachedResult *cached, Oid serverid, Oid userid, const char *query,
+				   List *relids, int ttl, FBresult *res)
+{
+	ResultCacheKey key;
+	ResultCacheEntry *entry;
+	HASH_SEQ_STATUS scan;
+	MemoryContext oldcontext;
+	TimestampTz now = GetCurrentTimestamp();
+	Size		size;
+	ListCell   *lc;
+	bool		found;
+	int			i;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (xact_modified == true)
+		return false;
+
+	size = firebirdResultBytes(res) + strlen(query) + sizeof(ResultCacheEntry);
+
+	if (size > (Size) fbCacheMaxSize * 1024)
+	{
+		elog(DEBUG2, "%s: result too large to cache", __func__);
+		return false;
+	}
+
+	fbCacheSetup();
+
+	/* Remove any expired entries */
+	hash_seq_init(&scan, ResultCacheHash);
+	while ((entry = (ResultCacheEntry *) hash_seq_search(&scan)))
+	{
+		if (now >= entry->expires)
+			firebirdCacheRemoveEntry(entry);
+	}
+
+	key.serverid = serverid;
+	key.userid = userid;
+	key.query_hash = string_hash(query, strlen(query) + 1);
+
+	entry = (ResultCacheEntry *) hash_search(ResultCacheHash, &key, HASH_ENTER, &found);
+
+	/* Replace any existing entry, e.g. for a different query with the same hash */
+	if (found)
+	{
+		firebirdCacheRemoveEntry(entry);
+		entry = (ResultCacheEntry *) hash_search(ResultCacheHash, &key, HASH_ENTER, &found);
+	}
+
+	/* Make room by removing the least recently used entries */
+	while (ResultCacheSize + size > (Size) fbCacheMaxSize * 1024 &&
+		   !dlist_is_empty(&ResultCacheLRU))
+	{
+		ResultCacheEntry *lru = dlist_tail_element(ResultCacheEntry, lru_node, &ResultCacheLRU);
+
+		elog(DEBUG2, "%s: discarding least recently used entry", __func__);
+		firebirdCacheRemoveEntry(lru);
+	}
+
+	oldcontext = MemoryContextSwitchTo(ResultCacheContext);
+
+	entry->query = pstrdup(query);
+	entry->nrelids = list_length(relids);
+	entry->relids = (Oid *) palloc(sizeof(Oid) * Max(entry->nrelids, 1));
+
+	i = 0;
+	foreach (lc, relids)
+		entry->relids[i++] = lfirst_oid(lc);
+
+	entry->expires = TimestampTzPlusMilliseconds(now, (int64) ttl * 1000);
+
+	entry->size = size;
+	ResultCacheSize += size;
+	dlist_push_head(&ResultCacheLRU, &entry->lru_node);
+
+	entry->result = (CachedResultData *) palloc(sizeof(CachedResultData));
+	entry->result->res = res;
+	entry->result->refcount = 0;
+	entry->result->valid = true;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	firebirdCacheAddRef(cached, entry->result);
+
+	return true;
+}
+
+
+/**
+ * firebirdCacheGetResult()
+ *
+ * Return the remote query result referenced by a cached result.
+ */
+FBresult *
+firebirdCacheGetResult(fbCachedResult *cached)
+{
+	return cached->data->res;
+}
+
+
+/**
+ * firebirdCacheAddRef()
+ *
+ * Point the reference "cached" at a cached or shared result, releasing
+ * any result it previously referred to.
+ */
+static void
+firebirdCacheAddRef(fbCachedResult *cached, CachedResultData *data)
+{
+	firebirdCacheRelease(cached);
+
+	cached->data = data;
+	data->refcount++;
+}
+
+
+/**
+ * firebirdCacheRelease()
+ *
+ * Release the result referred to by "cached", freeing the result if it is
+ * no longer in the cache. The reference itself can be reused. Releasing a
+ * reference which does not refer to a result has no effect.
+ */
+void
+firebirdCacheRelease(fbCachedResult *cached)
+{
+	CachedResultData *data = cached->data;
+
+	if (data == NULL)
+		return;
+
+	cached->data = NULL;
+
+	Assert(data->refcount > 0);
+
+	data->refcount--;
+
+	if (data->refcount == 0 && data->valid == false)
+	{
+		FQclear(data->res);
+		pfree(data);
+	}
+}
+
+
+/**
+ * firebirdCacheRefReset()
+ *
+ * Memory context callback which releases a reference not released by
+ * its scan.
+ */
+static void
+firebirdCacheRefReset(void *arg)
+{
+	firebirdCacheRelease((fbCachedResult *) arg);
+}
+
+
+/**
+ * firebirdCacheRemoveEntry()
+ *
+ * Remove an entry from the cache; its result will be freed once no
+ * scans reference it.
+ */
+static void
+firebirdCacheRemoveEntry(ResultCacheEntry *entry)
+{
+	CachedResultData *cached = entry->result;
+
+	cached->valid = false;
+
+	if (cached->refcount == 0)
+	{
+		FQclear(cached->res);
+		pfree(cached);
+	}
+
+	pfree(entry->query);
+	pfree(entry->relids);
+
+	dlist_delete(&entry->lru_node);
+	ResultCacheSize -= entry->size;
+
+	hash_search(ResultCacheHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+
+/**
+ * firebirdCacheInvalidate()
+ *
+ * Remove all entries referencing the specified foreign table, or all
+ * entries if InvalidOid is provided. Returns the number of entries
+ * removed.
+ */
+int
+firebirdCacheInvalidate(Oid relid)
+{
+	HASH_SEQ_STATUS scan;
+	ResultCacheEntry *entry;
+	int			removed = 0;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (ResultCacheHash == NULL)
+		return 0;
+
+	hash_seq_init(&scan, ResultCacheHash);
+	while ((entry = (ResultCacheEntry *) hash_seq_search(&scan)))
+	{
+		bool		matched = !OidIsValid(relid);
+		int			i;
+
+		for (i = 0; !matched && i < entry->nrelids; i++)
+		{
+			if (entry->relids[i] == relid)
+				matched = true;
+		}
+
+		if (matched)
+		{
+			firebirdCacheRemoveEntry(entry);
+			removed++;
+		}
+	}
+
+	elog(DEBUG2, "%s: %i entries removed", __func__, removed);
+
+	return removed;
+}
+
+
+/**
+ * firebirdCacheNoteModification()
+ *
+ * Called when a foreign table is modified; remove any cached results
+ * referencing it, and bypass the cache for the rest of the transaction.
+ */
+void
+firebirdCacheNoteModification(Oid relid)
+{
+	fbCacheSetup();
+
+	(void) firebirdCacheInvalidate(relid);
+
+	xact_modified = true;
+	modification_count++;
+}
+
+
+/**
+ * firebirdSharedResultLookup()
+ *
+ * Point the reference "cached" at the result of the provided query if
+ * already executed on the same connection by another scan in the same
+ * query execution, returning false if not available. The result is
+ * handled as for firebirdCacheLookup().
+ */
+bool
+firebirdSharedResultLookup(fbCachedResult *cached, EState *estate, FBconn *conn,
+						   const char *query)
+{
+	SharedScanResult *shared;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	for (shared = SharedScanResults; shared != NULL; shared = shared->next)
+	{
+		if (shared->estate != estate || shared->conn != conn)
+			continue;
+
+		if (shared->modification_count != modification_count)
+			continue;
+
+		if (strcmp(shared->query, query) != 0)
+			continue;
+
+		elog(DEBUG2, "%s: using shared result", __func__);
+
+		firebirdCacheAddRef(cached, shared->result);
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/**
+ * firebirdSharedResultStore()
+ *
+ * Make the result of the provided query available to other scans in the
+ * same query execution, and point the reference "cached" at it. Ownership
+ * of "res" passes to the executor state; the reference is handled as for
+ * firebirdCacheLookup().
+ */
+void
+firebirdSharedResultStore(fbCachedResult *cached, EState *estate, FBconn *conn,
+						  const char *query, FBresult *res)
+{
+	SharedScanResult *shared;
+	MemoryContext oldcontext;
+	bool		registered = false;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	/* Check whether a reset callback was already registered */
+	for (shared = SharedScanResults; shared != NULL; shared = shared->next)
+	{
+		if (shared->estate == estate)
+		{
+			registered = true;
+			break;
+		}
+	}
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/* Entries are released when the query context is reset or deleted */
+	if (registered == false)
+	{
+		MemoryContextCallback *cb = palloc(sizeof(MemoryContextCallback));
+
+		cb->func = firebirdSharedResultsReset;
+		cb->arg = (void *) estate;
+		MemoryContextRegisterResetCallback(estate->es_query_cxt, cb);
+	}
+
+	shared = (SharedScanResult *) palloc(sizeof(SharedScanResult));
+	shared->estate = estate;
+	shared->conn = conn;
+	shared->query = pstrdup(query);
+	shared->modification_count = modification_count;
+
+	/*
+	 * "valid" is never cleared, so firebirdCacheRelease() does not free
+	 * the result; this is done by firebirdSharedResultsReset().
+	 */
+	shared->result = (CachedResultData *) palloc(sizeof(CachedResultData));
+	shared->result->res = res;
+	shared->result->refcount = 0;
+	shared->result->valid = true;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	shared->next = SharedScanResults;
+	SharedScanResults = shared;
+
+	firebirdCacheAddRef(cached, shared->result);
+}
+
+
+/**
+ * firebirdSharedResultsReset()
+ *
+ * Memory context callback which releases the shared results of the
+ * executor state provided as "arg".
+ */
+static void
+firebirdSharedResultsReset(void *arg)
+{
+	EState	   *estate = (EState *) arg;
+	SharedScanResult **link = &SharedScanResults;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	while (*link != NULL)
+	{
+		SharedScanResult *shared = *link;
+
+		if (shared->estate == estate)
+		{
+			/* The entry itself is freed along with the query context */
+			*link = shared->next;
+			FQclear(shared->result->res);
+		}
+		else
+		{
+			link = &shared->next;
+		}
+	}
+}
+
+
+/**
+ * firebirdCachedResultsCount()
+ *
+ * Return the number of cached results.
+ */
+int
+firebirdCachedResultsCount(void)
+{
+	if (ResultCacheHash == NULL)
+		return 0;
+
+	return (int) hash_get_num_entries(ResultCacheHash);
+}
+
+
+/**
+ * fb_cache_xact_callback()
+ *
+ * Stop bypassing the cache at the end of a transaction which modified
+ * a foreign table.
+ */
+static void
+fb_cache_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			xact_modified = false;
+			break;
+		default:
+			break;
+	}
+}
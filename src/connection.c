@@ -18,8 +18,15 @@
 #include "firebird_fdw.h"
 
 #include "access/xact.h"
+#if (PG_VERSION_NUM >= 160000)
+#include "catalog/pg_foreign_server.h"
+#endif
+#include "miscadmin.h"
+#include "utils/acl.h"
 #include "utils/hsearch.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
 
 
 
@@ -36,20 +43,61 @@ typedef struct ConnCacheEntry
 	int			xact_depth;		/* 0 = no xact open, 1 = main xact open, 2 =
 								 * one level of subxact open, etc */
 	bool		have_error;		/* have any subxacts aborted in this xact? */
+
+	/* Statistics reported by firebird_fdw_connections() */
+	TimestampTz connected_at;	/* time connection was established */
+	TimestampTz last_used;		/* time connection was last used */
+	TimestampTz xact_start;		/* start of remote transaction, if any */
+	int64		statements;		/* statements executed */
+	int64		round_trips;	/* requests sent, including transaction control */
+	int64		bytes_sent;		/* statement text and parameter data sent */
+	int64		bytes_received;	/* result data received */
+	int64		reconnects;		/* times the connection was re-established */
+	List	   *prepared_statements; /* prepared statements currently held */
 } ConnCacheEntry;
 
+/*
+ * A statement prepared on a cached connection, and the (sub)transaction
+ * level at which it was prepared; allocated in TopMemoryContext.
+ */
+typedef struct FbPreparedStatement
+{
+	FBresult   *prepared;
+	int			level;
+} FbPreparedStatement;
+
 /*
  * Global connection cache (initialized on first use)
  */
 static HTAB *ConnectionHash = NULL;
 
+extern Datum firebird_fdw_connections(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(firebird_fdw_connections);
+
 /* tracks whether any work is needed in callback functions */
 static bool xact_got_connection = false;
 
+#if (PG_VERSION_NUM >= 170000)
+/* Names of custom wait events, and their IDs once registered */
+static const char *const fbWaitEventNames[FB_WAIT_EVENT_COUNT] = {
+	"FirebirdConnect",
+	"FirebirdExecute",
+	"FirebirdCommit",
+	"FirebirdBatchFlush"
+};
+
+static uint32 fbWaitEventIds[FB_WAIT_EVENT_COUNT] = {0};
+#endif
+
 
 static char *firebirdDbPath(char **address, char **database, int *port);
 static FBconn *firebirdGetConnection(const char *dbpath, const char *svr_username, const char *svr_password);
 static void fb_begin_remote_xact(ConnCacheEntry *entry);
+static ConnCacheEntry *fb_get_conn_entry(FBconn *conn);
+static void fb_reset_conn_stats(ConnCacheEntry *entry);
+static void fb_drop_prepared_statements(ConnCacheEntry *entry, int level);
+static void fb_register_wait_events(void);
 static void fb_xact_callback(XactEvent event, void *arg);
 static void fb_subxact_callback(SubXactEvent event,
 					   SubTransactionId mySubid,
@@ -157,7 +205,11 @@ firebirdGetConnection(const char *dbpath, const char *svr_username, const char *
 	kw[i] = NULL;
 	val[i] = NULL;
 
+	fb_register_wait_events();
+
+	firebirdWaitStart(FB_WAIT_CONNECT);
 	conn = FQconnectdbParams(kw, val);
+	firebirdWaitEnd();
 
 	if (FQstatus(conn) != CONNECTION_OK)
 		ereport(ERROR,
@@ -176,6 +228,90 @@ firebirdGetConnection(const char *dbpath, const char *svr_username, const char *
 }
 
 
+/**
+ * firebirdOpenConnection()
+ *
+ * Open a new connection to the foreign database using the foreign server
+ * and user mapping parameters. The connection is not cached, and
+ * transactions on it are not coordinated with the local transaction;
+ * the caller is responsible for closing it with FQfinish().
+ */
+FBconn *
+firebirdOpenConnection(ForeignServer *server, UserMapping *user)
+{
+	char *svr_address  = NULL;
+	char *svr_database = NULL;
+	int	  svr_port	   = FIREBIRD_DEFAULT_PORT;
+	char *svr_username = NULL;
+	char *svr_password = NULL;
+
+	char *dbpath;
+	FBconn *conn;
+
+	ListCell   *lc;
+
+	fbServerOptions server_options = fbServerOptions_init;
+
+	server_options.address.opt.strptr = &svr_address;
+	server_options.database.opt.strptr = &svr_database;
+	server_options.port.opt.intptr = &svr_port;
+
+	firebirdGetServerOptions(
+		server,
+		&server_options);
+
+	foreach (lc, user->options)
+	{
+		DefElem	   *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "username") == 0)
+			svr_username = defGetString(def);
+		if (strcmp(def->defname, "password") == 0)
+			svr_password = defGetString(def);
+	}
+
+	dbpath = firebirdDbPath(&svr_address, &svr_database, &svr_port);
+
+	conn = firebirdGetConnection(
+		dbpath,
+		svr_username,
+		svr_password
+	);
+
+	pfree(dbpath);
+
+	return conn;
+}
+
+
+/**
+ * firebirdCheckServerUsage()
+ *
+ * Check the current user has USAGE privilege on the foreign server, as
+ * required for functions which execute arbitrary statements on it.
+ */
+void
+firebirdCheckServerUsage(ForeignServer *server)
+{
+	AclResult	aclresult;
+
+#if (PG_VERSION_NUM >= 160000)
+	aclresult = object_aclcheck(ForeignServerRelationId, server->serverid, GetUserId(), ACL_USAGE);
+#else
+	aclresult = pg_foreign_server_aclcheck(server->serverid, GetUserId(), ACL_USAGE);
+#endif
+
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult,
+#if (PG_VERSION_NUM >= 110000)
+					   OBJECT_FOREIGN_SERVER,
+#else
+					   ACL_KIND_FOREIGN_SERVER,
+#endif
+					   server->servername);
+}
+
+
 /**
  * firebirdInstantiateConnection()
  *
@@ -224,54 +360,20 @@ firebirdInstantiateConnection(ForeignServer *server, UserMapping *user)
 		entry->conn = NULL;
 		entry->xact_depth = 0;
 		entry->have_error = false;
+		entry->reconnects = 0;
+		entry->prepared_statements = NIL;
 	}
 
 	if (entry->conn == NULL)
 	{
-		char *svr_address  = NULL;
-		char *svr_database = NULL;
-		int	  svr_port	   = FIREBIRD_DEFAULT_PORT;
-		char *svr_username = NULL;
-		char *svr_password = NULL;
-
-		char *dbpath;
-
-		ListCell   *lc;
-
-		fbServerOptions server_options = fbServerOptions_init;
-
 		elog(DEBUG2, "%s(): no cache entry found", __func__);
 
 		entry->xact_depth = 0;	/* just to be sure */
 		entry->have_error = false;
 
-		server_options.address.opt.strptr = &svr_address;
-		server_options.database.opt.strptr = &svr_database;
-		server_options.port.opt.intptr = &svr_port;
-
-		firebirdGetServerOptions(
-			server,
-			&server_options);
-
-		foreach (lc, user->options)
-		{
-			DefElem	   *def = (DefElem *) lfirst(lc);
-
-			if (strcmp(def->defname, "username") == 0)
-				svr_username = defGetString(def);
-			if (strcmp(def->defname, "password") == 0)
-				svr_password = defGetString(def);
-		}
-
-		dbpath = firebirdDbPath(&svr_address, &svr_database, &svr_port);
+		entry->conn = firebirdOpenConnection(server, user);
+		fb_reset_conn_stats(entry);
 
-		entry->conn = firebirdGetConnection(
-			dbpath,
-			svr_username,
-			svr_password
-		);
-
-		pfree(dbpath);
 		elog(DEBUG2, "%s(): new firebird_fdw connection %p for server \"%s\"",
 			 __func__, entry->conn, server->servername);
 	}
@@ -301,12 +403,18 @@ firebirdInstantiateConnection(ForeignServer *server, UserMapping *user)
 
 			FQfinish(entry->conn);
 			entry->conn = new_conn;
+			entry->reconnects++;
+			/* Statements prepared on the old connection are gone */
+			list_free_deep(entry->prepared_statements);
+			entry->prepared_statements = NIL;
 			ereport(NOTICE,
 					(errmsg("reconnected to Firebird server")));
 		}
 	}
 
 
+	entry->last_used = GetCurrentTimestamp();
+
 	pqsignal(SIGINT, fbSigInt);
 
 	/* Start a new transaction or subtransaction if needed */
@@ -347,7 +455,11 @@ fb_begin_remote_xact(ConnCacheEntry *entry)
 		elog(DEBUG2, "starting remote transaction on connection %p",
 			 entry->conn);
 
+		FIREBIRD_FDW_XACT_BEGIN(curlevel);
+
+		firebirdWaitStart(FB_WAIT_EXECUTE);
 		res = FQexec(entry->conn, "SET TRANSACTION SNAPSHOT");
+		firebirdWaitEnd();
 
 		if (FQresultStatus(res) != FBRES_TRANSACTION_START)
 		{
@@ -358,6 +470,8 @@ fb_begin_remote_xact(ConnCacheEntry *entry)
 		FQclear(res);
 
 		entry->xact_depth = 1;
+		entry->xact_start = entry->last_used;
+		entry->round_trips++;
 	}
 	else
 	{
@@ -379,7 +493,10 @@ fb_begin_remote_xact(ConnCacheEntry *entry)
 		char		sql[64];
 
 		snprintf(sql, sizeof(sql), "SAVEPOINT s%d", entry->xact_depth + 1);
+		firebirdWaitStart(FB_WAIT_EXECUTE);
 		res = FQexec(entry->conn, sql);
+		firebirdWaitEnd();
+		entry->round_trips++;
 		elog(DEBUG2, "savepoint:\n%s", sql);
 		elog(DEBUG2, "res is %s", FQresStatus(FQresultStatus(res)));
 		FQclear(res);
@@ -421,7 +538,12 @@ fb_xact_callback(XactEvent event, void *arg)
 				 __func__);
 			continue;
 		}
-		else if (entry->xact_depth == 0)
+
+		/* Release any statements left prepared by aborted modify operations */
+		if (event == XACT_EVENT_ABORT || event == XACT_EVENT_PARALLEL_ABORT)
+			fb_drop_prepared_statements(entry, 0);
+
+		if (entry->xact_depth == 0)
 		{
 			elog(DEBUG3, "%s(): no open transaction",
 				 __func__);
@@ -440,12 +562,17 @@ fb_xact_callback(XactEvent event, void *arg)
 		{
 			case XACT_EVENT_PRE_COMMIT:
 				elog(DEBUG2, "COMMIT");
+				firebirdWaitStart(FB_WAIT_COMMIT);
 				if (FQcommitTransaction(entry->conn) != TRANS_OK)
 				{
+					firebirdWaitEnd();
 					ereport(ERROR,
 							(errcode(ERRCODE_FDW_ERROR),
 							 errmsg("COMMIT failed")));
 				}
+				firebirdWaitEnd();
+
+				FIREBIRD_FDW_XACT_COMMIT();
 				break;
 			case XACT_EVENT_PRE_PREPARE:
 				/* XXX not sure how to handle this */
@@ -464,12 +591,16 @@ fb_xact_callback(XactEvent event, void *arg)
 				 * likely have had an implict ROLLBACK; need to verify this...
 				 */
 				elog(DEBUG2, "ROLLBACK");
+				firebirdWaitStart(FB_WAIT_COMMIT);
 				res = FQexec(entry->conn, "ROLLBACK");
+				firebirdWaitEnd();
 				if (FQresultStatus(res) != FBRES_TRANSACTION_ROLLBACK)
 				{
 					elog(DEBUG2, "transaction rollback failed");
 				}
 				FQclear(res);
+
+				FIREBIRD_FDW_XACT_ABORT();
 				break;
 			default:
 				elog(DEBUG2, "Unhandled unknown XactEvent");
@@ -477,6 +608,7 @@ fb_xact_callback(XactEvent event, void *arg)
 
 		/* Reset state to show we're out of a transaction */
 		entry->xact_depth = 0;
+		entry->round_trips++;
 	}
 	elog(DEBUG3, "leaving fb_xact_callback()");
 
@@ -536,18 +668,23 @@ fb_subxact_callback(SubXactEvent event,
 			/* Commit all remote subtransactions during pre-commit */
 			snprintf(sql, sizeof(sql), "RELEASE SAVEPOINT s%d", curlevel);
 			elog(DEBUG2, "%s(): %s", __func__, sql);
+			firebirdWaitStart(FB_WAIT_COMMIT);
 			res = FQexec(entry->conn, sql);
+			firebirdWaitEnd();
 			elog(DEBUG2, "%s(): res %i", __func__, FQresultStatus(res));
 		}
 		else
 		{
 			/* Assume we might have lost track of prepared statements */
 			entry->have_error = true;
+			fb_drop_prepared_statements(entry, curlevel);
 			/* Rollback all remote subtransactions during abort */
 			snprintf(sql, sizeof(sql),
 					 "ROLLBACK TO SAVEPOINT s%d",
 					 curlevel);
+			firebirdWaitStart(FB_WAIT_COMMIT);
 			res = FQexec(entry->conn, sql);
+			firebirdWaitEnd();
 			if (FQresultStatus(res) != FBRES_COMMAND_OK)
 			{
 				elog(WARNING, "%s(): unable to execute '%s'",
@@ -559,7 +696,9 @@ fb_subxact_callback(SubXactEvent event,
 				snprintf(sql, sizeof(sql),
 						 "RELEASE SAVEPOINT s%d",
 						 curlevel);
+				firebirdWaitStart(FB_WAIT_COMMIT);
 				res = FQexec(entry->conn, sql);
+				firebirdWaitEnd();
 				if (FQresultStatus(res) != FBRES_COMMAND_OK)
 				{
 					elog(WARNING, "%s(): unable to execute '%s'",
@@ -571,6 +710,7 @@ fb_subxact_callback(SubXactEvent event,
 
 		/* Leaving current subtransaction level */
 		entry->xact_depth--;
+		entry->round_trips++;
 	}
 }
 
@@ -601,6 +741,8 @@ firebirdCloseConnections(bool verbose)
 		elog(DEBUG2, "%s(): closing cached connection %p", __func__, entry->conn);
 		FQfinish(entry->conn);
 		entry->conn = NULL;
+		list_free_deep(entry->prepared_statements);
+		entry->prepared_statements = NIL;
 		elog(DEBUG2, "%s(): cached connection closed", __func__);
 		closed++;
 	}
@@ -638,6 +780,386 @@ firebirdCachedConnectionsCount(void)
 }
 
 
+/**
+ * firebirdConnectionInTransaction()
+ *
+ * Indicate whether the cached connection for the provided server and
+ * user mapping has a remote transaction open.
+ */
+bool
+firebirdConnectionInTransaction(ForeignServer *server, UserMapping *user)
+{
+	ConnCacheEntry *entry;
+	ConnCacheKey key;
+
+	if (ConnectionHash == NULL)
+		return false;
+
+	key.serverid = server->serverid;
+	key.userid = user->userid;
+
+	entry = hash_search(ConnectionHash, &key, HASH_FIND, NULL);
+
+	return entry != NULL && entry->conn != NULL && entry->xact_depth > 0;
+}
+
+
+/**
+ * firebirdConnectionNoteStatement()
+ *
+ * Record the execution of a statement on the cached connection "conn",
+ * which sent "bytes_sent" bytes of statement text and parameters and
+ * returned "res". Connections which are not cached are ignored.
+ */
+void
+firebirdConnectionNoteStatement(FBconn *conn, int64 bytes_sent, FBresult *res)
+{
+	ConnCacheEntry *entry = fb_get_conn_entry(conn);
+
+	if (entry == NULL)
+		return;
+
+	entry->statements++;
+	entry->round_trips++;
+	entry->bytes_sent += bytes_sent;
+	entry->bytes_received += firebirdResultBytes(res);
+	entry->last_used = GetCurrentTimestamp();
+}
+
+
+/**
+ * firebirdConnectionNotePrepared()
+ *
+ * Record the preparation of "query" as the statement "prepared" on the
+ * cached connection "conn", or, if "query" is NULL, the release of
+ * "prepared" by its owner.
+ *
+ * Statements still recorded when the (sub)transaction in which they were
+ * prepared aborts are released by the transaction callbacks.
+ */
+void
+firebirdConnectionNotePrepared(FBconn *conn, FBresult *prepared, const char *query)
+{
+	ConnCacheEntry *entry = fb_get_conn_entry(conn);
+	ListCell   *lc;
+
+	if (entry == NULL)
+		return;
+
+	if (query != NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		FbPreparedStatement *stmt = (FbPreparedStatement *) palloc(sizeof(FbPreparedStatement));
+
+		stmt->prepared = prepared;
+		stmt->level = GetCurrentTransactionNestLevel();
+		entry->prepared_statements = lappend(entry->prepared_statements, stmt);
+
+		MemoryContextSwitchTo(oldcontext);
+
+		entry->round_trips++;
+		entry->bytes_sent += strlen(query);
+		return;
+	}
+
+	foreach (lc, entry->prepared_statements)
+	{
+		FbPreparedStatement *stmt = (FbPreparedStatement *) lfirst(lc);
+
+		if (stmt->prepared == prepared)
+		{
+			entry->prepared_statements = list_delete_ptr(entry->prepared_statements, stmt);
+			pfree(stmt);
+			break;
+		}
+	}
+}
+
+
+/**
+ * firebirdResultBytes()
+ *
+ * Return the total length of the values in a query result.
+ */
+int64
+firebirdResultBytes(FBresult *res)
+{
+	int64		bytes = 0;
+	int			nrows;
+	int			nfields;
+	int			row;
+	int			field;
+
+	if (FQresultStatus(res) != FBRES_TUPLES_OK)
+		return 0;
+
+	nrows = FQntuples(res);
+	nfields = FQnfields(res);
+
+	for (row = 0; row < nrows; row++)
+	{
+		for (field = 0; field < nfields; field++)
+		{
+			if (!FQgetisnull(res, row, field))
+				bytes += FQgetlength(res, row, field);
+		}
+	}
+
+	return bytes;
+}
+
+
+/**
+ * fb_register_wait_events()
+ *
+ * From PostgreSQL 17, register the custom wait events. This is done
+ * before the first connection is established, as all waits for Firebird
+ * take place on a connection; registration requires shared memory
+ * access and must not be attempted in transaction callbacks.
+ */
+static void
+fb_register_wait_events(void)
+{
+#if (PG_VERSION_NUM >= 170000)
+	static bool registered = false;
+	int			i;
+
+	if (registered)
+		return;
+
+	for (i = 0; i < FB_WAIT_EVENT_COUNT; i++)
+		fbWaitEventIds[i] = WaitEventExtensionNew(fbWaitEventNames[i]);
+
+	registered = true;
+#endif
+}
+
+
+/**
+ * firebirdWaitEventInfo()
+ *
+ * Return the wait event to report while waiting for Firebird. From
+ * PostgreSQL 17, this is the custom wait event registered by
+ * fb_register_wait_events(); older versions report the generic
+ * "Extension" wait event.
+ */
+uint32
+firebirdWaitEventInfo(fbWaitEvent event)
+{
+#if (PG_VERSION_NUM >= 170000)
+	if (fbWaitEventIds[event] == 0)
+		return PG_WAIT_EXTENSION;
+
+	return fbWaitEventIds[event];
+#elif (PG_VERSION_NUM >= 90600)
+	return PG_WAIT_EXTENSION;
+#else
+	return 0;
+#endif
+}
+
+
+/**
+ * firebird_fdw_connections()
+ *
+ * Return a row for each connection in the current session's connection
+ * cache.
+ */
+Datum
+firebird_fdw_connections(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS fstat;
+	ConnCacheEntry *entry;
+
+	/* check to see if caller supports this function returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Switch into long-lived context to construct returned data structures */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for function's result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (ConnectionHash == NULL)
+		return (Datum) 0;
+
+	hash_seq_init(&fstat, ConnectionHash);
+	while ((entry = (ConnCacheEntry *) hash_seq_search(&fstat)) != NULL)
+	{
+		ForeignServer *server;
+		char	   *user_name = NULL;
+		Datum		values[13];
+		bool		nulls[13];
+
+		if (entry->conn == NULL)
+			continue;
+
+#if (PG_VERSION_NUM >= 110000)
+		/* The server may have been dropped in this session */
+		server = GetForeignServerExtended(entry->key.serverid, FSV_MISSING_OK);
+#else
+		server = GetForeignServer(entry->key.serverid);
+#endif
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		if (server != NULL)
+			values[0] = CStringGetTextDatum(server->servername);
+		else
+			nulls[0] = true;
+
+		/* InvalidOid denotes a PUBLIC user mapping */
+		if (OidIsValid(entry->key.userid))
+			user_name = GetUserNameFromId(entry->key.userid, true);
+		else
+			user_name = "public";
+
+		if (user_name != NULL)
+			values[1] = CStringGetTextDatum(user_name);
+		else
+			nulls[1] = true;
+
+		values[2] = TimestampTzGetDatum(entry->connected_at);
+		values[3] = TimestampTzGetDatum(entry->last_used);
+		values[4] = BoolGetDatum(FQisActiveTransaction(entry->conn));
+		values[5] = Int32GetDatum(entry->xact_depth);
+
+		if (entry->xact_depth > 0)
+			values[6] = TimestampTzGetDatum(entry->xact_start);
+		else
+			nulls[6] = true;
+
+		values[7] = Int64GetDatum(entry->statements);
+		values[8] = Int64GetDatum(entry->round_trips);
+		values[9] = Int64GetDatum(entry->bytes_sent);
+		values[10] = Int64GetDatum(entry->bytes_received);
+		values[11] = Int64GetDatum(entry->reconnects);
+		values[12] = Int32GetDatum(list_length(entry->prepared_statements));
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+
+/**
+ * fb_get_conn_entry()
+ *
+ * Return the connection cache entry for "conn", or NULL if it is not
+ * cached.
+ */
+static ConnCacheEntry *
+fb_get_conn_entry(FBconn *conn)
+{
+	HASH_SEQ_STATUS fstat;
+	ConnCacheEntry *entry;
+
+	if (ConnectionHash == NULL || conn == NULL)
+		return NULL;
+
+	hash_seq_init(&fstat, ConnectionHash);
+	while ((entry = (ConnCacheEntry *) hash_seq_search(&fstat)) != NULL)
+	{
+		if (entry->conn == conn)
+		{
+			hash_seq_term(&fstat);
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**
+ * fb_reset_conn_stats()
+ *
+ * Initialise the statistics of a newly established connection.
+ */
+static void
+fb_reset_conn_stats(ConnCacheEntry *entry)
+{
+	entry->connected_at = GetCurrentTimestamp();
+	entry->last_used = entry->connected_at;
+	entry->xact_start = 0;
+	entry->statements = 0;
+	entry->round_trips = 0;
+	entry->bytes_sent = 0;
+	entry->bytes_received = 0;
+	list_free_deep(entry->prepared_statements);
+	entry->prepared_statements = NIL;
+}
+
+
+/**
+ * fb_drop_prepared_statements()
+ *
+ * Release the statements still prepared on the connection at (sub)transaction
+ * level "level" or deeper. These have been left behind by modify operations
+ * which were aborted by an error before they could release them.
+ */
+static void
+fb_drop_prepared_statements(ConnCacheEntry *entry, int level)
+{
+	ListCell   *lc;
+	List	   *remaining = NIL;
+	MemoryContext oldcontext;
+
+	if (entry->prepared_statements == NIL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	foreach (lc, entry->prepared_statements)
+	{
+		FbPreparedStatement *stmt = (FbPreparedStatement *) lfirst(lc);
+
+		if (stmt->level < level)
+		{
+			remaining = lappend(remaining, stmt);
+			continue;
+		}
+
+		elog(DEBUG2, "%s(): releasing prepared statement %p",
+			 __func__, stmt->prepared);
+
+		FQdeallocatePrepared(entry->conn, stmt->prepared);
+		FQclear(stmt->prepared);
+		pfree(stmt);
+	}
+
+	list_free(entry->prepared_statements);
+	entry->prepared_statements = remaining;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+
 /**
  * firebirdDbPath()
  *
@@ -691,16 +1213,9 @@ firebirdDbPath(char **address, char **database, int *port)
 void
 fbfdw_report_error(int errlevel, int pg_errcode, FBresult *res, FBconn *conn, char *query)
 {
-	char *primary_message = FQresultErrorField(res, FB_DIAG_MESSAGE_PRIMARY);
-	char *detail_message = FQresultErrorField(res, FB_DIAG_MESSAGE_DETAIL);
-
 	PG_TRY();
 	{
-		ereport(errlevel,
-				(errcode(pg_errcode),
-				 errmsg("%s", primary_message),
-				 detail_message ? errdetail("%s", detail_message) : 0,
-				 query ? errcontext("remote SQL command: %s", query) : 0));
+		fbfdw_report_prepared_error(errlevel, pg_errcode, res, conn, query);
 	}
 	PG_CATCH();
 	{
@@ -709,3 +1224,23 @@ fbfdw_report_error(int errlevel, int pg_errcode, FBresult *res, FBconn *conn, ch
 	}
 	PG_END_TRY();
 }
+
+
+/**
+ * fbfdw_report_prepared_error()
+ *
+ * As fbfdw_report_error(), but for the result of executing a prepared
+ * statement, which belongs to the statement and is not freed.
+ */
+void
+fbfdw_report_prepared_error(int errlevel, int pg_errcode, FBresult *res, FBconn *conn, char *query)
+{
+	char *primary_message = FQresultErrorField(res, FB_DIAG_MESSAGE_PRIMARY);
+	char *detail_message = FQresultErrorField(res, FB_DIAG_MESSAGE_DETAIL);
+
+	ereport(errlevel,
+			(errcode(pg_errcode),
+			 errmsg("%s", primary_message),
+			 detail_message ? errdetail("%s", detail_message) : 0,
+			 query ? errcontext("remote SQL command: %s", query) : 0));
+}
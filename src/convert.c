@@ -29,6 +29,7 @@
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/transam.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_operator.h"
@@ -38,6 +39,9 @@
 #include "common/keywords.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
+#include "optimizer/paths.h"
+#include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #if (PG_VERSION_NUM >= 120000)
 #include "optimizer/optimizer.h"
 #else
@@ -57,9 +61,97 @@ typedef struct foreign_glob_cxt
 {
 	PlannerInfo *root;			/* global planner state */
 	RelOptInfo *foreignrel;		/* the foreign relation we are planning for */
+	Relids		relids;			/* relids of base relations in the underlying scan */
 	int firebird_version;		/* Firebird version integer provided by libfq (e.g. 20501) */
+	char	  **reject_reason;	/* if not NULL, set to the reason an expression
+								 * cannot be evaluated remotely */
 } foreign_glob_cxt;
 
+/*
+ * Functions which can be pushed down, with the Firebird version in which
+ * each became available. COALESCE() and SUBSTRING() are subject to
+ * further checks in foreign_expr_walker().
+ *
+ * NOTE: most of these functions were introduced in FB 2.1; some
+ *	 can be used to convert operators
+ *
+ * Not currently sending:
+ * BIN_AND()
+ * BIN_OR()
+ * BIN_XOR()
+ * EXTRACT()
+ * INITCAP()
+ * TO_CHAR()
+ * TO_DATE()
+ * TO_NUMBER()
+ * TO_TIMESTAMP()
+ * TRANSLATE()
+ *
+ * Not practical to push down these:
+ * IIF () - no equivalent in Pg, shorthand for a CASE construct
+ * LEFT() -> FB does not accept negative length
+ * RIGHT() -> FB does not accept negative length
+ *	 -> to handle these we'll need to examine the length value,
+ *		which is tricky
+ */
+typedef struct fbPushdownFunction
+{
+	const char *name;
+	int			firebird_version;	/* minimum Firebird version */
+} fbPushdownFunction;
+
+static const fbPushdownFunction pushdownFunctions[] =
+{
+	/* Firebird 1.5 or later */
+	{"coalesce", 10500},
+	{"concat", 10500},
+
+	/* Firebird 2.0 or later */
+	{"bit_length", 20000},
+	{"char_length", 20000},
+	{"character_length", 20000},
+	{"lower", 20000},
+	{"octet_length", 20000},
+	{"substring", 20000},
+	{"upper", 20000},
+
+	/* Firebird 2.1 or later */
+	{"abs", 20100},
+	{"acos", 20100},
+	{"asin", 20100},
+	{"atan", 20100},
+	{"atan2", 20100},
+	{"ceil", 20100},
+	{"ceiling", 20100},
+	{"cos", 20100},
+	{"cot", 20100},
+	{"exp", 20100},
+	{"floor", 20100},
+	{"ltrim", 20100},
+	{"length", 20100},
+	{"log", 20100},
+	{"mod", 20100},
+	{"nullif", 20100},
+	{"overlay", 20100},
+	{"position", 20100},
+	{"pow", 20100},
+	{"power", 20100},
+	{"reverse", 20100},
+	{"rtrim", 20100},
+	{"sign", 20100},
+	{"sin", 20100},
+	{"sqrt", 20100},
+	{"strpos", 20100},
+	{"tan", 20100},
+	{"trunc", 20100},
+
+	/* Firebird 2.5 or later */
+	{"lpad", 20500},
+	{"rpad", 20500},
+
+	{NULL, 0}
+};
+
 
 /*
  * Context for convertExpr
@@ -68,16 +160,23 @@ typedef struct convert_expr_cxt
 {
 	PlannerInfo *root;			/* global planner state */
 	RelOptInfo *foreignrel;		/* the foreign relation we are planning for */
+	RelOptInfo *scanrel;		/* the underlying scan relation; same as
+								 * foreignrel unless foreignrel is an upper
+								 * relation */
 	StringInfo	buf;			/* cumulative final output */
 	List	  **params_list;	/* exprs that will become remote Params */
 	int firebird_version;		/* Firebird version integer provided by libfq (e.g. 20501) */
 	bool check_implicit_bool;
+	bool qualify_col;			/* qualify column references with the relation alias */
 } convert_expr_cxt;
 
 static char *convertDatum(Datum datum, Oid type);
 
 
 static void convertRelation(StringInfo buf, FirebirdFdwState *fdw_state);
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+static void convertFromExprForRel(StringInfo buf, RelOptInfo *scanrel, convert_expr_cxt *context);
+#endif
 static void convertStringLiteral(StringInfo buf, const char *val);
 static void convertOperatorName(StringInfo buf, Form_pg_operator opform, char *left, char *right);
 static void convertReturningList(StringInfo buf,
@@ -92,7 +191,7 @@ static void convertTargetList(StringInfo buf,
 							  Relation rel,
 							  Bitmapset *attrs_used,
 							  bool for_select,
-							  int firebird_version,
+							  FirebirdFdwState *fdw_state,
 							  List **retrieved_attrs,
 							  bool *db_key_used);
 
@@ -110,17 +209,40 @@ static void convertScalarArrayOpExpr(ScalarArrayOpExpr *node, convert_expr_cxt *
 ;
 static void convertFunction(FuncExpr *node, convert_expr_cxt *context, char **result);
 static void convertVar(Var *node, convert_expr_cxt *context, char **result);
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+static void convertAggref(Aggref *node, convert_expr_cxt *context, char **result);
+#endif
 
 static char *convertFunctionConcat(FuncExpr *node, convert_expr_cxt *context);
 static char *convertFunctionPosition(FuncExpr *node, convert_expr_cxt *context);
 static char *convertFunctionSubstring(FuncExpr *node, convert_expr_cxt *context);
 static char *convertFunctionTrim(FuncExpr *node, convert_expr_cxt *context, char *where);
 
+static bool checkFirebirdExpr(PlannerInfo *root,
+							  RelOptInfo *baserel,
+							  Expr *expr,
+							  int firebird_version,
+							  char **reject_reason);
 static bool foreign_expr_walker(Node *node,
 					foreign_glob_cxt *glob_cxt);
-
-static bool canConvertOp(OpExpr *oe, int firebird_version);
+static bool foreign_expr_reject(foreign_glob_cxt *glob_cxt,
+								const char *reason,
+								const char *detail);
+static const char *unsupportedNodeName(Node *node);
+
+static bool canConvertOp(OpExpr *oe, foreign_glob_cxt *glob_cxt);
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+static bool canConvertAggref(Aggref *agg);
+static char *getAggregateName(Oid aggfnoid);
+#endif
 static bool is_builtin(Oid procid);
+static bool isParameterColumnReferenced(PlannerInfo *root, RelOptInfo *baserel,
+										AttrNumber attno, List *param_conds);
+static char *convertQueryPlaceholders(const char *query, char **names, char **values,
+									  int nvalues, List **positions);
+static bool ec_member_matches_parameter(PlannerInfo *root, RelOptInfo *rel,
+										EquivalenceClass *ec, EquivalenceMember *em,
+										void *arg);
 
 static const char *quote_fb_identifier_for_import(const char *ident);
 
@@ -149,7 +271,7 @@ buildSelectSql(StringInfo buf,
 	/* Construct SELECT list */
 	appendStringInfoString(buf, "SELECT ");
 	convertTargetList(buf, rte, baserel->relid, rel, attrs_used, true,
-					  fdw_state->firebird_version,
+					  fdw_state,
 					  retrieved_attrs, db_key_used);
 
 	/* Construct FROM clause */
@@ -160,6 +282,117 @@ buildSelectSql(StringInfo buf,
 }
 
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+/**
+ * buildSelectSqlForRel()
+ *
+ * Build a Firebird SELECT statement for a join relation or an upper
+ * relation, i.e. a join between foreign tables or an aggregation over
+ * a foreign table or join.
+ *
+ * The entries in "tlist" are emitted as the SELECT list in order, and
+ * each is retrieved into the correspondingly numbered column of the
+ * scan tuple. Conditions on the underlying scan relation are emitted
+ * as the WHERE clause; for an upper relation, the GROUP BY clause is
+ * generated from the sort/group references in "tlist".
+ */
+void
+buildSelectSqlForRel(StringInfo buf,
+					 PlannerInfo *root,
+					 RelOptInfo *foreignrel,
+					 List *tlist,
+					 List **retrieved_attrs)
+{
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *) foreignrel->fdw_private;
+	RelOptInfo *scanrel = IS_UPPER_REL(foreignrel) ? fdw_state->outerrel : foreignrel;
+	FirebirdFdwState *scan_state = (FirebirdFdwState *) scanrel->fdw_private;
+	convert_expr_cxt context;
+	ListCell   *lc;
+	bool		first;
+	int			i = 1;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	context.root = root;
+	context.foreignrel = foreignrel;
+	context.scanrel = scanrel;
+	context.buf = buf;
+	context.params_list = NULL;
+	context.firebird_version = fdw_state->firebird_version;
+	context.check_implicit_bool = true;
+	context.qualify_col = IS_JOIN_REL(scanrel);
+
+	*retrieved_attrs = NIL;
+
+	/* Construct SELECT list */
+	appendStringInfoString(buf, "SELECT ");
+
+	first = true;
+	foreach (lc, tlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		if (!first)
+			appendStringInfoString(buf, ", ");
+		else
+			first = false;
+
+		convertExpr(tle->expr, &context);
+		*retrieved_attrs = lappend_int(*retrieved_attrs, i++);
+	}
+
+	/* Avoid generating invalid syntax if the target list is empty */
+	if (first)
+		appendStringInfoString(buf, "NULL");
+
+	/* Construct FROM and WHERE clauses */
+	appendStringInfoString(buf, " FROM ");
+	convertFromExprForRel(buf, scanrel, &context);
+
+	first = true;
+	foreach (lc, scan_state->remote_conds)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		appendStringInfoString(buf, first ? " WHERE (" : " AND (");
+		convertExpr(ri->clause, &context);
+		appendStringInfoChar(buf, ')');
+		first = false;
+	}
+
+	if (!IS_UPPER_REL(foreignrel))
+	{
+		elog(DEBUG2, "%s: %s", __func__, buf->data);
+		return;
+	}
+
+	/* Construct GROUP BY clause */
+	first = true;
+	foreach (lc, root->parse->groupClause)
+	{
+		SortGroupClause *grp = (SortGroupClause *) lfirst(lc);
+		TargetEntry *tle = get_sortgroupref_tle(grp->tleSortGroupRef, tlist);
+
+		appendStringInfoString(buf, first ? " GROUP BY " : ", ");
+		convertExpr(tle->expr, &context);
+		first = false;
+	}
+
+	/* Construct HAVING clause */
+	first = true;
+	foreach (lc, fdw_state->having_conds)
+	{
+		appendStringInfoString(buf, first ? " HAVING (" : " AND (");
+		convertExpr((Expr *) lfirst(lc), &context);
+		appendStringInfoChar(buf, ')');
+		first = false;
+	}
+
+	elog(DEBUG2, "%s: %s", __func__, buf->data);
+}
+#endif
+
+
 /**
  * buildInsertSql()
  *
@@ -367,10 +600,12 @@ buildWhereClause(StringInfo output,
 	/* Set up context struct for recursion */
 	context.root = root;
 	context.foreignrel = baserel;
+	context.scanrel = baserel;
 	context.buf = output;
 	context.params_list = params;
 	context.firebird_version = fdw_state->firebird_version;
 	context.check_implicit_bool = true;
+	context.qualify_col = false;
 
 	foreach (lc, exprs)
 	{
@@ -394,6 +629,40 @@ buildWhereClause(StringInfo output,
 }
 
 
+/**
+ * buildLockingClause()
+ *
+ * Append the Firebird row locking clause corresponding to the row mark
+ * of a foreign table scanned by SELECT ... FOR UPDATE/SHARE.
+ *
+ * Firebird provides only an exclusive row lock ("WITH LOCK"), which is
+ * used for all lock strengths. "SKIP LOCKED" is available from
+ * Firebird 5.0; Firebird has no per-statement equivalent of NOWAIT.
+ */
+void
+buildLockingClause(StringInfo output,
+				   PlanRowMark *rowmark,
+				   int firebird_version)
+{
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (rowmark->waitPolicy == LockWaitError)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("NOWAIT is not supported for firebird_fdw foreign tables")));
+
+	if (rowmark->waitPolicy == LockWaitSkip && firebird_version < 50000)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("SKIP LOCKED requires Firebird 5.0 or later")));
+
+	appendStringInfoString(output, " FOR UPDATE WITH LOCK");
+
+	if (rowmark->waitPolicy == LockWaitSkip)
+		appendStringInfoString(output, " SKIP LOCKED");
+}
+
+
 /**
  * generateColumnMetadataQuery()
  *
@@ -798,7 +1067,34 @@ convertRelation(StringInfo buf, FirebirdFdwState *fdw_state)
 	else if (fdw_state->svr_query != NULL)
 	{
 		appendStringInfo(buf, "( %s )",
-						 fdw_state->svr_query);
+						 fdw_state->param_query != NULL
+						 ? fdw_state->param_query
+						 : fdw_state->svr_query);
+	}
+	else if (fdw_state->svr_procedure != NULL)
+	{
+		appendStringInfoString(buf,
+							   quote_fb_identifier(fdw_state->svr_procedure,
+												   fdw_state->quote_identifier));
+
+		if (fdw_state->param_args != NIL)
+		{
+			ListCell   *lc;
+			bool		first = true;
+
+			appendStringInfoChar(buf, '(');
+
+			foreach (lc, fdw_state->param_args)
+			{
+				if (first == false)
+					appendStringInfoString(buf, ", ");
+				first = false;
+
+				appendStringInfoString(buf, (char *) lfirst(lc));
+			}
+
+			appendStringInfoChar(buf, ')');
+		}
 	}
 	else
 	{
@@ -807,6 +1103,100 @@ convertRelation(StringInfo buf, FirebirdFdwState *fdw_state)
 }
 
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+/**
+ * convertFromExprForRel()
+ *
+ * Append the FROM clause item for the provided scan relation to 'buf'.
+ *
+ * For a join relation, the join of its outer and inner relations is
+ * emitted, with any nested joins enclosed in parentheses and each
+ * foreign table given the alias "r<relid>", which convertVar() uses to
+ * qualify column references. Conditions which apply to the join as a
+ * whole are emitted by the caller as the WHERE clause.
+ */
+static void
+convertFromExprForRel(StringInfo buf, RelOptInfo *scanrel, convert_expr_cxt *context)
+{
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *) scanrel->fdw_private;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (IS_JOIN_REL(scanrel))
+	{
+		ListCell   *lc;
+		bool		first = true;
+		const char *jointype;
+
+		switch (fdw_state->jointype)
+		{
+			case JOIN_INNER:
+				jointype = "INNER";
+				break;
+			case JOIN_LEFT:
+				jointype = "LEFT";
+				break;
+			case JOIN_RIGHT:
+				jointype = "RIGHT";
+				break;
+			case JOIN_FULL:
+				jointype = "FULL";
+				break;
+			default:
+				elog(ERROR, "unsupported join type %d", fdw_state->jointype);
+		}
+
+		if (IS_JOIN_REL(fdw_state->outerrel))
+		{
+			appendStringInfoChar(buf, '(');
+			convertFromExprForRel(buf, fdw_state->outerrel, context);
+			appendStringInfoChar(buf, ')');
+		}
+		else
+			convertFromExprForRel(buf, fdw_state->outerrel, context);
+
+		appendStringInfo(buf, " %s JOIN ", jointype);
+
+		if (IS_JOIN_REL(fdw_state->innerrel))
+		{
+			appendStringInfoChar(buf, '(');
+			convertFromExprForRel(buf, fdw_state->innerrel, context);
+			appendStringInfoChar(buf, ')');
+		}
+		else
+			convertFromExprForRel(buf, fdw_state->innerrel, context);
+
+		appendStringInfoString(buf, " ON ");
+
+		foreach (lc, fdw_state->joinclauses)
+		{
+			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+			if (!first)
+				appendStringInfoString(buf, " AND ");
+			else
+				first = false;
+
+			appendStringInfoChar(buf, '(');
+			convertExpr(ri->clause, context);
+			appendStringInfoChar(buf, ')');
+		}
+
+		/* Firebird requires a join condition */
+		if (first)
+			appendStringInfoString(buf, "(1 = 1)");
+	}
+	else
+	{
+		convertRelation(buf, fdw_state);
+
+		if (context->qualify_col)
+			appendStringInfo(buf, " r%d", scanrel->relid);
+	}
+}
+#endif
+
+
 const char *
 quote_fb_identifier(const char *ident, bool quote_ident)
 {
@@ -1055,6 +1445,12 @@ convertExprRecursor(Expr *node, convert_expr_cxt *context, char **result)
 			convertFunction((FuncExpr *)node, context, result);
 			break;
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+		case T_Aggref:
+			convertAggref((Aggref *)node, context, result);
+			break;
+#endif
+
 		default:
 			elog(ERROR, "unsupported expression type for convert: %d",
 				 (int) nodeTag(node));
@@ -1075,7 +1471,7 @@ convertVar(Var *node, convert_expr_cxt *context, char **result)
 	initStringInfo(&buf);
 	elog(DEBUG2, "entering function %s", __func__);
 
-	if (node->varno == context->foreignrel->relid &&
+	if (bms_is_member(node->varno, context->scanrel->relids) &&
 		node->varlevelsup == 0)
 	{
 		/* Var belongs to foreign table */
@@ -1096,6 +1492,10 @@ convertVar(Var *node, convert_expr_cxt *context, char **result)
 
 		firebirdGetServerOptions(server, &server_options);
 
+		/* In a join, qualify the column with the relation's alias */
+		if (context->qualify_col)
+			appendStringInfo(&buf, "r%d.", node->varno);
+
 		convertColumnRef(&buf,
 						 rte->relid, node->varattno,
 						 quote_identifier);
@@ -2046,7 +2446,7 @@ convertReturningList(StringInfo buf, RangeTblEntry *rte,
 
 		appendStringInfoString(buf, " RETURNING ");
 		convertTargetList(buf, rte, rtindex, rel, attrs_used, false,
-						  fdw_state->firebird_version,
+						  fdw_state,
 						  retrieved_attrs, &db_key_used);
 	}
 	else
@@ -2072,7 +2472,7 @@ convertTargetList(StringInfo buf,
 				  Relation rel,
 				  Bitmapset *attrs_used,
 				  bool for_select,
-				  int firebird_version,
+				  FirebirdFdwState *fdw_state,
 				  List **retrieved_attrs,
 				  bool *db_key_used)
 {
@@ -2117,6 +2517,15 @@ convertTargetList(StringInfo buf,
 		{
 			bool column_converted = false;
 
+			/*
+			 * A stored procedure's input parameters, or a query's
+			 * placeholders, are not part of its output; the scan returns
+			 * the value passed as the argument instead.
+			 */
+			if (for_select == true &&
+				bms_is_member(i, fdw_state->param_attrs))
+				continue;
+
 			if (first == false)
 				appendStringInfoString(buf, ", ");
 			else
@@ -2139,7 +2548,7 @@ convertTargetList(StringInfo buf,
 				 */
 				if (col_implicit_bool_type == true)
 				{
-					if (firebird_version >= 30000) {
+					if (fdw_state->firebird_version >= 30000) {
 						convertColumnRef(buf, rte->relid, i, quote_identifier);
 						appendStringInfoString(buf,
 											   " <> 0");
@@ -2249,93 +2658,811 @@ identifyRemoteConditions(PlannerInfo *root,
 
 
 /**
- * isFirebirdExpr()
+ * identifyParameterArguments()
  *
- * Returns true if given expr can be evaluate by Firebird.
+ * For a foreign table defined as a selectable stored procedure, or as a
+ * query containing named placeholders, identify the columns representing
+ * the procedure's input parameters (marked with the "procedure_parameter"
+ * option) or the query's placeholders (marked with the "query_parameter"
+ * option).
+ *
+ * The value of a parameter is provided by a condition comparing its
+ * column with a value not depending on the foreign table, such as a
+ * constant, a prepared statement parameter, or a column of another table
+ * in a join; see getParameterValue(). The column's value in each result
+ * row will be the value itself. The values are only determined when the
+ * plan is created, see identifyParameterValues(), as values provided by
+ * join conditions depend on the path chosen.
+ *
+ * Conditions referencing parameter columns must be evaluated locally, as
+ * the columns do not exist remotely. This is only possible if the
+ * parameter has a value, as otherwise the conditions would be applied to
+ * the result for a NULL or default argument; an error is raised if a
+ * parameter column is referenced by any condition, but no condition can
+ * provide its value. Parameters whose value can only be provided by join
+ * conditions are noted in "param_outer_attrs", as scans of the table
+ * must then be parameterized by the other tables.
  */
-bool
-isFirebirdExpr(PlannerInfo *root,
-			   RelOptInfo *baserel,
-			   Expr *expr,
-			   int firebird_version)
+void
+identifyParameterArguments(PlannerInfo *root,
+						   RelOptInfo *baserel,
+						   FirebirdFdwState *fdw_state)
 {
-	foreign_glob_cxt glob_cxt;
+	RangeTblEntry *rte = planner_rt_fetch(baserel->relid, root);
+	Relation	rel;
+	TupleDesc	tupdesc;
+	char	  **arg_names;
+	char	  **arg_colnames;
+	int		   *arg_attnos;
+	int			max_position = 0;
+	int			i;
+	Bitmapset  *value_attrs = NULL;
+	List	   *param_conds = NIL;
+	List	   *remote_conds = NIL;
+	ListCell   *lc;
 
 	elog(DEBUG2, "entering function %s", __func__);
 
+	fdw_state->param_attrs = NULL;
+	fdw_state->param_attnos = NIL;
+	fdw_state->param_names = NIL;
+	fdw_state->param_outer_attrs = NULL;
+	fdw_state->param_args = NIL;
+	fdw_state->param_query = NULL;
+
 	/*
-	 * Check that the expression consists of nodes that are safe to execute
-	 * remotely.
+	 * Core code already has some lock on each rel being planned, so we can
+	 * use NoLock here.
 	 */
-	glob_cxt.root = root;
-	glob_cxt.foreignrel = baserel;
-	glob_cxt.firebird_version = firebird_version;
+	rel = table_open(rte->relid, NoLock);
+	tupdesc = RelationGetDescr(rel);
 
-	if (!foreign_expr_walker((Node *) expr, &glob_cxt))
+	arg_attnos = palloc0(sizeof(int) * (tupdesc->natts + 1));
+	arg_names = palloc0(sizeof(char *) * (tupdesc->natts + 1));
+	arg_colnames = palloc0(sizeof(char *) * (tupdesc->natts + 1));
+
+	for (i = 1; i <= tupdesc->natts; i++)
 	{
-		elog(DEBUG2, "%s: not FB expression", __func__);
-		return false;
-	}
+#if (PG_VERSION_NUM >= 110000)
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i - 1);
+#else
+		Form_pg_attribute attr = tupdesc->attrs[i - 1];
+#endif
+		fbColumnOptions column_options = fbColumnOptions_init;
+		int			position = 0;
+		char	   *name = NULL;
 
-	/* OK to evaluate on the remote server */
-	return true;
-}
+		if (attr->attisdropped)
+			continue;
 
+		column_options.procedure_parameter = &position;
+		column_options.query_parameter = &name;
+		firebirdGetColumnOptions(rte->relid, i, &column_options);
 
-/**
- * foreign_expr_walker()
- *
- * Check if expression is safe to execute remotely, and return true if so.
- *
- * We must check that the expression contains only node types we can convert,
- * that all types/functions/operators are safe to send.
- *
- * Currently this only checks a subset of the more fundamental expressions,
- * and needs further testing to ensure we are only sending valid queries
- * to Firebird.
- *
- * Adapted from postgres_fdw
- */
-static bool
-foreign_expr_walker(Node *node,
-					foreign_glob_cxt *glob_cxt)
-{
-	/* Need do nothing for empty subexpressions */
-	if (node == NULL)
-		return true;
+		/* Placeholders are numbered in column order */
+		if (fdw_state->svr_query != NULL)
+		{
+			if (name == NULL)
+				continue;
 
-	elog(DEBUG2, "entering function %s", __func__);
+			position = max_position + 1;
+			arg_names[position] = name;
+		}
+		else if (fdw_state->svr_procedure == NULL || position < 1)
+			continue;
 
-	elog(DEBUG2, "Node is: %i", nodeTag(node));
+		if (position > tupdesc->natts || arg_attnos[position] != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FDW_INVALID_OPTION_INDEX),
+					 errmsg("invalid \"procedure_parameter\" value %i for column \"%s\"",
+							position, NameStr(attr->attname)),
+					 errdetail("Parameter positions must be unique and not exceed the number of columns.")));
 
-	/* TODO: handle collation */
+		arg_attnos[position] = i;
+		arg_colnames[position] = pstrdup(NameStr(attr->attname));
+		max_position = Max(max_position, position);
 
-	switch (nodeTag(node))
+		fdw_state->param_attrs = bms_add_member(fdw_state->param_attrs, i);
+	}
+
+	table_close(rel, NoLock);
+
+	if (max_position == 0)
+		return;
+
+	for (i = 1; i <= max_position; i++)
 	{
-		case T_Var:
-		{
-			Var		   *var = (Var *) node;
-			elog(DEBUG2, "%s: Node is var", __func__);
-			/* Var belongs to foreign table */
-			if (var->varno == glob_cxt->foreignrel->relid &&
-				var->varlevelsup == 0)
-			{
-				elog(DEBUG2, "%s: Var is foreign", __func__);
+		fdw_state->param_attnos = lappend_int(fdw_state->param_attnos, arg_attnos[i]);
+		fdw_state->param_names = lappend(fdw_state->param_names, arg_names[i]);
+	}
 
-				/* don't handle system columns */
-				if (var->varattno < 1)
-					return false;
+	/* Find the parameters whose value is provided by a restriction */
+	foreach (lc, baserel->baserestrictinfo)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+		AttrNumber	attno = getParameterValue(baserel, fdw_state, ri, NULL);
 
-				return true;
-			}
+		if (attno == InvalidAttrNumber)
+			continue;
 
-			return false;
-		}
+		value_attrs = bms_add_member(value_attrs, attno);
+		param_conds = lappend(param_conds, ri);
+	}
+
+	for (i = 1; i <= max_position; i++)
+	{
+		if (arg_attnos[i] == 0 ||
+			bms_is_member(arg_attnos[i], value_attrs) ||
+			!isParameterColumnReferenced(root, baserel, arg_attnos[i], param_conds))
+			continue;
+
+		if (getParameterJoinClauses(root, baserel, fdw_state, arg_attnos[i]) != NIL)
+		{
+			fdw_state->param_outer_attrs = bms_add_member(fdw_state->param_outer_attrs,
+														  arg_attnos[i]);
+			continue;
+		}
+
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("unable to determine a value for parameter column \"%s\" of foreign table \"%s\"",
+						arg_colnames[i],
+						get_rel_name(rte->relid)),
+				 errdetail("Parameter values can only be provided by an equality condition comparing the column with a value or with a column of another table.")));
+	}
+
+	/*
+	 * Ensure conditions referencing parameter columns, including those
+	 * which may provide their values, are evaluated locally.
+	 */
+	foreach (lc, fdw_state->remote_conds)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+		Bitmapset  *attrs = NULL;
+
+		pull_varattnos((Node *) ri->clause, baserel->relid, &attrs);
+
+		for (i = -1; (i = bms_next_member(attrs, i)) >= 0;)
+		{
+			if (bms_is_member(i + FirstLowInvalidHeapAttributeNumber,
+							  fdw_state->param_attrs))
+				break;
+		}
+
+		if (i >= 0)
+			fdw_state->local_conds = lappend(fdw_state->local_conds, ri);
+		else
+			remote_conds = lappend(remote_conds, ri);
+	}
+
+	fdw_state->remote_conds = remote_conds;
+}
+
+
+/**
+ * getParameterValue()
+ *
+ * If the condition "ri" can provide the value of one of the parameter
+ * columns of "baserel", return the column's attno, and set "value" (if
+ * provided) to the expression providing the value; otherwise return
+ * InvalidAttrNumber.
+ *
+ * This is the case for an equality condition comparing the column with
+ * an expression which does not reference the foreign table, and which
+ * can be evaluated once per scan; references to other tables are replaced
+ * by parameters of the scan. The value is evaluated when the scan is
+ * executed and passed to Firebird as a parameter of the remote query.
+ */
+AttrNumber
+getParameterValue(RelOptInfo *baserel,
+				  FirebirdFdwState *fdw_state,
+				  RestrictInfo *ri,
+				  Expr **value)
+{
+	OpExpr	   *oe;
+	Node	   *column;
+	Expr	   *expr;
+	char	   *opname;
+
+	if (!IsA(ri->clause, OpExpr))
+		return InvalidAttrNumber;
+
+	oe = (OpExpr *) ri->clause;
+
+	if (list_length(oe->args) != 2)
+		return InvalidAttrNumber;
+
+	opname = get_opname(oe->opno);
+
+	if (opname == NULL || strcmp(opname, "=") != 0 || !is_builtin(oe->opno))
+		return InvalidAttrNumber;
+
+	if (bms_equal(ri->left_relids, baserel->relids) &&
+		!bms_is_member(baserel->relid, ri->right_relids))
+	{
+		column = strip_implicit_coercions((Node *) linitial(oe->args));
+		expr = (Expr *) lsecond(oe->args);
+	}
+	else if (bms_equal(ri->right_relids, baserel->relids) &&
+			 !bms_is_member(baserel->relid, ri->left_relids))
+	{
+		column = strip_implicit_coercions((Node *) lsecond(oe->args));
+		expr = (Expr *) linitial(oe->args);
+	}
+	else
+		return InvalidAttrNumber;
+
+	if (!IsA(column, Var) ||
+		((Var *) column)->varno != baserel->relid ||
+		((Var *) column)->varlevelsup != 0 ||
+		!bms_is_member(((Var *) column)->varattno, fdw_state->param_attrs))
+		return InvalidAttrNumber;
+
+	if (contain_volatile_functions((Node *) expr) ||
+		contain_subplans((Node *) expr))
+		return InvalidAttrNumber;
+
+	if (value != NULL)
+		*value = expr;
+
+	return ((Var *) column)->varattno;
+}
+
+
+/**
+ * getParameterJoinClauses()
+ *
+ * Return the join conditions which can provide the value of the
+ * parameter column "attno" of "baserel" if the scan is parameterized by
+ * the other tables they reference, including conditions implied by
+ * equivalence classes.
+ */
+List *
+getParameterJoinClauses(PlannerInfo *root,
+						RelOptInfo *baserel,
+						FirebirdFdwState *fdw_state,
+						AttrNumber attno)
+{
+	List	   *clauses = NIL;
+	ListCell   *lc;
+
+	foreach (lc, baserel->joininfo)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		if (join_clause_is_movable_to(ri, baserel) &&
+			getParameterValue(baserel, fdw_state, ri, NULL) == attno)
+			clauses = lappend(clauses, ri);
+	}
+
+	if (baserel->has_eclass_joins)
+	{
+		List	   *ec_clauses;
+
+		ec_clauses = generate_implied_equalities_for_column(root,
+															baserel,
+															ec_member_matches_parameter,
+															(void *) &attno,
+															baserel->lateral_referencers);
+
+		foreach (lc, ec_clauses)
+		{
+			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+			if (join_clause_is_movable_to(ri, baserel) &&
+				getParameterValue(baserel, fdw_state, ri, NULL) == attno)
+				clauses = lappend(clauses, ri);
+		}
+	}
+
+	return clauses;
+}
+
+
+/**
+ * ec_member_matches_parameter()
+ *
+ * Callback for generate_implied_equalities_for_column(), identifying
+ * the equivalence class member for the parameter column passed as "arg".
+ */
+static bool
+ec_member_matches_parameter(PlannerInfo *root, RelOptInfo *rel,
+							EquivalenceClass *ec, EquivalenceMember *em,
+							void *arg)
+{
+	AttrNumber	attno = *((AttrNumber *) arg);
+	Node	   *expr = strip_implicit_coercions((Node *) em->em_expr);
+
+	return IsA(expr, Var) &&
+		((Var *) expr)->varno == rel->relid &&
+		((Var *) expr)->varlevelsup == 0 &&
+		((Var *) expr)->varattno == attno;
+}
+
+
+/**
+ * identifyParameterValues()
+ *
+ * Determine the values of the parameter columns of "baserel" from the
+ * conditions "scan_clauses" to be enforced by its scan, which include
+ * any join conditions of a parameterized scan.
+ *
+ * Returns the expressions providing the values, which are evaluated when
+ * the scan is executed. "param_conds" is set to the conditions providing
+ * the values, which need not be evaluated; "param_attnos" to the column
+ * each value is returned as; and "param_order" to the index of the value
+ * bound to each parameter of the remote query.
+ *
+ * For procedures, each argument with a value is passed as a parameter
+ * of the remote query; trailing arguments without a value are omitted,
+ * so Firebird will apply any defaults, and other arguments without a
+ * value are passed as NULL. For queries, each placeholder with a value
+ * is replaced by a parameter, and others by NULL; as a placeholder may
+ * occur several times, its value may be bound to several parameters.
+ */
+List *
+identifyParameterValues(RelOptInfo *baserel,
+						FirebirdFdwState *fdw_state,
+						List *scan_clauses,
+						List **param_conds,
+						List **param_attnos,
+						List **param_order)
+{
+	int			nparams = list_length(fdw_state->param_attnos);
+	Expr	  **values = palloc0(sizeof(Expr *) * (nparams + 1));
+	int			last_arg = 0;
+	int			position;
+	List	   *exprs = NIL;
+	ListCell   *lc;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	*param_conds = NIL;
+	*param_attnos = NIL;
+	*param_order = NIL;
+
+	foreach (lc, scan_clauses)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+		Expr	   *value;
+		AttrNumber	attno;
+
+		if (ri->pseudoconstant)
+			continue;
+
+		attno = getParameterValue(baserel, fdw_state, ri, &value);
+
+		if (attno == InvalidAttrNumber)
+			continue;
+
+		for (position = 1; position <= nparams; position++)
+		{
+			if (list_nth_int(fdw_state->param_attnos, position - 1) == attno)
+				break;
+		}
+
+		/* Another condition already provides this parameter's value */
+		if (values[position] != NULL)
+			continue;
+
+		values[position] = value;
+		*param_conds = lappend(*param_conds, ri);
+	}
+
+	for (position = 1; position <= nparams; position++)
+	{
+		if (values[position] == NULL)
+			continue;
+
+		exprs = lappend(exprs, values[position]);
+		*param_attnos = lappend_int(*param_attnos,
+									list_nth_int(fdw_state->param_attnos, position - 1));
+		last_arg = position;
+	}
+
+	fdw_state->param_args = NIL;
+	fdw_state->param_query = NULL;
+
+	if (fdw_state->svr_query != NULL)
+	{
+		char	  **names = palloc0(sizeof(char *) * (nparams + 1));
+		char	  **args = palloc0(sizeof(char *) * (nparams + 1));
+		int		   *value_nrs = palloc0(sizeof(int) * (nparams + 1));
+		int			value_nr = 0;
+		List	   *positions = NIL;
+
+		for (position = 1; position <= nparams; position++)
+		{
+			names[position] = (char *) list_nth(fdw_state->param_names, position - 1);
+
+			if (values[position] != NULL)
+			{
+				args[position] = "?";
+				value_nrs[position] = value_nr++;
+			}
+		}
+
+		fdw_state->param_query = convertQueryPlaceholders(fdw_state->svr_query,
+														  names,
+														  args,
+														  nparams,
+														  &positions);
+
+		foreach (lc, positions)
+			*param_order = lappend_int(*param_order, value_nrs[lfirst_int(lc)]);
+	}
+	else
+	{
+		int			value_nr = 0;
+
+		for (position = 1; position <= last_arg; position++)
+		{
+			if (values[position] == NULL)
+			{
+				fdw_state->param_args = lappend(fdw_state->param_args, "NULL");
+				continue;
+			}
+
+			fdw_state->param_args = lappend(fdw_state->param_args, "?");
+			*param_order = lappend_int(*param_order, value_nr++);
+		}
+	}
+
+	return exprs;
+}
+
+
+/**
+ * isParameterColumnReferenced()
+ *
+ * Determine whether the column "attno" of "baserel" is referenced by any
+ * restriction or join condition other than those in "param_conds",
+ * including join conditions represented by equivalence classes.
+ */
+static bool
+isParameterColumnReferenced(PlannerInfo *root, RelOptInfo *baserel,
+							AttrNumber attno, List *param_conds)
+{
+	int			attr = attno - FirstLowInvalidHeapAttributeNumber;
+	Bitmapset  *attrs = NULL;
+	ListCell   *lc;
+
+	foreach (lc, baserel->baserestrictinfo)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		if (list_member_ptr(param_conds, ri))
+			continue;
+
+		pull_varattnos((Node *) ri->clause, baserel->relid, &attrs);
+	}
+
+	foreach (lc, baserel->joininfo)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		pull_varattnos((Node *) ri->clause, baserel->relid, &attrs);
+	}
+
+	if (bms_is_member(attr, attrs))
+		return true;
+
+	if (baserel->has_eclass_joins == false)
+		return false;
+
+	/*
+	 * Equivalence classes containing a constant are represented by
+	 * restriction conditions; others with members from several relations
+	 * will produce join conditions.
+	 */
+	foreach (lc, root->eq_classes)
+	{
+		EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc);
+		ListCell   *lc_em;
+
+		if (ec->ec_has_const ||
+			!bms_is_member(baserel->relid, ec->ec_relids) ||
+			bms_membership(ec->ec_relids) != BMS_MULTIPLE)
+			continue;
+
+		foreach (lc_em, ec->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc_em);
+
+			if (!bms_is_member(baserel->relid, em->em_relids))
+				continue;
+
+			pull_varattnos((Node *) em->em_expr, baserel->relid, &attrs);
+		}
+	}
+
+	return bms_is_member(attr, attrs);
+}
+
+
+/**
+ * convertQueryPlaceholders()
+ *
+ * Return a copy of "query" with each named placeholder (":name") replaced
+ * by the corresponding value, or NULL if no value was provided. Names are
+ * compared case-insensitively; placeholders within string literals, quoted
+ * identifiers and comments are ignored, as are unknown names.
+ *
+ * The number of the placeholder replaced by each value is appended to
+ * "positions", in the order of the placeholders' occurrence.
+ */
+static char *
+convertQueryPlaceholders(const char *query, char **names, char **values,
+						 int nvalues, List **positions)
+{
+	StringInfoData buf;
+	const char *ptr = query;
+	char		quote = '\0';
+
+	initStringInfo(&buf);
+
+	while (*ptr != '\0')
+	{
+		const char *start;
+		int			i;
+
+		if (quote != '\0')
+		{
+			if (*ptr == quote)
+				quote = '\0';
+			appendStringInfoChar(&buf, *ptr++);
+			continue;
+		}
+
+		if (*ptr == '\'' || *ptr == '"')
+		{
+			quote = *ptr;
+			appendStringInfoChar(&buf, *ptr++);
+			continue;
+		}
+
+		/* Copy comments unchanged */
+		if (ptr[0] == '-' && ptr[1] == '-')
+		{
+			start = ptr;
+
+			while (*ptr != '\0' && *ptr != '\n')
+				ptr++;
+
+			appendBinaryStringInfo(&buf, start, ptr - start);
+			continue;
+		}
+
+		if (ptr[0] == '/' && ptr[1] == '*')
+		{
+			const char *end = strstr(ptr + 2, "*/");
+
+			start = ptr;
+			ptr = (end != NULL) ? end + 2 : start + strlen(start);
+
+			appendBinaryStringInfo(&buf, start, ptr - start);
+			continue;
+		}
+
+		if (*ptr != ':' ||
+			!(isalpha((unsigned char) ptr[1]) || ptr[1] == '_'))
+		{
+			appendStringInfoChar(&buf, *ptr++);
+			continue;
+		}
+
+		start = ++ptr;
+
+		while (isalnum((unsigned char) *ptr) || *ptr == '_' || *ptr == '$')
+			ptr++;
+
+		for (i = 1; i <= nvalues; i++)
+		{
+			if (strlen(names[i]) == (size_t) (ptr - start) &&
+				pg_strncasecmp(names[i], start, ptr - start) == 0)
+				break;
+		}
+
+		if (i > nvalues)
+			appendBinaryStringInfo(&buf, start - 1, ptr - start + 1);
+		else if (values[i] == NULL)
+			appendStringInfoString(&buf, "NULL");
+		else
+		{
+			appendStringInfoString(&buf, values[i]);
+			*positions = lappend_int(*positions, i);
+		}
+	}
+
+	elog(DEBUG2, "%s: %s", __func__, buf.data);
+
+	return buf.data;
+}
+
+
+/**
+ * isFirebirdExpr()
+ *
+ * Returns true if given expr can be evaluate by Firebird.
+ */
+bool
+isFirebirdExpr(PlannerInfo *root,
+			   RelOptInfo *baserel,
+			   Expr *expr,
+			   int firebird_version)
+{
+	elog(DEBUG2, "entering function %s", __func__);
+
+	return checkFirebirdExpr(root, baserel, expr, firebird_version, NULL);
+}
+
+
+/**
+ * getFirebirdExprRejectReason()
+ *
+ * Returns a description of the reason the given expr cannot be evaluated
+ * by Firebird, or NULL if it can.
+ */
+char *
+getFirebirdExprRejectReason(PlannerInfo *root,
+							RelOptInfo *baserel,
+							Expr *expr,
+							int firebird_version)
+{
+	char	   *reject_reason = NULL;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (checkFirebirdExpr(root, baserel, expr, firebird_version, &reject_reason))
+		return NULL;
+
+	if (reject_reason == NULL)
+		reject_reason = pstrdup("unsupported expression");
+
+	return reject_reason;
+}
+
+
+/**
+ * getLocalConditionReason()
+ *
+ * Returns a description of the reason the condition "expr" on the base
+ * relation "baserel" is evaluated locally rather than by Firebird.
+ */
+char *
+getLocalConditionReason(PlannerInfo *root,
+						RelOptInfo *baserel,
+						FirebirdFdwState *fdw_state,
+						Expr *expr)
+{
+	char	   *reject_reason;
+
+	if (fdw_state->disable_pushdowns == true)
+		return pstrdup("pushdowns disabled");
+
+	if (fdw_state->param_attrs != NULL)
+	{
+		Bitmapset  *attrs = NULL;
+		int			i;
+
+		pull_varattnos((Node *) expr, baserel->relid, &attrs);
+
+		for (i = -1; (i = bms_next_member(attrs, i)) >= 0;)
+		{
+			if (bms_is_member(i + FirstLowInvalidHeapAttributeNumber,
+							  fdw_state->param_attrs))
+				return pstrdup("references a parameter column");
+		}
+	}
+
+	reject_reason = getFirebirdExprRejectReason(root, baserel, expr,
+												fdw_state->firebird_version);
+
+	/* Should never happen */
+	if (reject_reason == NULL)
+		reject_reason = pstrdup("unknown");
+
+	return reject_reason;
+}
+
+
+/**
+ * checkFirebirdExpr()
+ *
+ * Returns true if given expr can be evaluated by Firebird; otherwise, if
+ * "reject_reason" is provided, it is set to the reason it cannot.
+ */
+static bool
+checkFirebirdExpr(PlannerInfo *root,
+				  RelOptInfo *baserel,
+				  Expr *expr,
+				  int firebird_version,
+				  char **reject_reason)
+{
+	foreign_glob_cxt glob_cxt;
+
+	/*
+	 * Check that the expression consists of nodes that are safe to execute
+	 * remotely.
+	 */
+	glob_cxt.root = root;
+	glob_cxt.foreignrel = baserel;
+	glob_cxt.firebird_version = firebird_version;
+	glob_cxt.reject_reason = reject_reason;
+
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+	/* For an upper relation, Vars belong to the underlying scan relation */
+	if (IS_UPPER_REL(baserel))
+		glob_cxt.relids = ((FirebirdFdwState *) baserel->fdw_private)->outerrel->relids;
+	else
+#endif
+		glob_cxt.relids = baserel->relids;
+
+	if (!foreign_expr_walker((Node *) expr, &glob_cxt))
+	{
+		elog(DEBUG2, "%s: not FB expression", __func__);
+		return false;
+	}
+
+	/* OK to evaluate on the remote server */
+	return true;
+}
+
+
+/**
+ * foreign_expr_walker()
+ *
+ * Check if expression is safe to execute remotely, and return true if so.
+ *
+ * We must check that the expression contains only node types we can convert,
+ * that all types/functions/operators are safe to send.
+ *
+ * Currently this only checks a subset of the more fundamental expressions,
+ * and needs further testing to ensure we are only sending valid queries
+ * to Firebird.
+ *
+ * Adapted from postgres_fdw
+ */
+static bool
+foreign_expr_walker(Node *node,
+					foreign_glob_cxt *glob_cxt)
+{
+	/* Need do nothing for empty subexpressions */
+	if (node == NULL)
+		return true;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	elog(DEBUG2, "Node is: %i", nodeTag(node));
+
+	/* TODO: handle collation */
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+		{
+			Var		   *var = (Var *) node;
+			elog(DEBUG2, "%s: Node is var", __func__);
+			/* Var belongs to foreign table */
+			if (bms_is_member(var->varno, glob_cxt->relids) &&
+				var->varlevelsup == 0)
+			{
+				elog(DEBUG2, "%s: Var is foreign", __func__);
+
+				/* don't handle system columns */
+				if (var->varattno < 1)
+					return foreign_expr_reject(glob_cxt, "system column", NULL);
+
+				return true;
+			}
+
+			return foreign_expr_reject(glob_cxt, "references another relation", NULL);
+		}
 		case T_Const:
 		{
 			Const *const_node = (Const *) node;
 			if (const_node->consttype == UUIDOID)
-				return false;
+				return foreign_expr_reject(glob_cxt, "type not convertible", "uuid");
 			return true;
 		}
 		case T_OpExpr:
@@ -2346,10 +3473,10 @@ foreign_expr_walker(Node *node,
 			if (!is_builtin(oe->opno))
 			{
 				elog(DEBUG2, "%s: not builtin", __func__);
-				return false;
+				return foreign_expr_reject(glob_cxt, "non-builtin operator", get_opname(oe->opno));
 			}
 
-			if (!canConvertOp(oe, glob_cxt->firebird_version))
+			if (!canConvertOp(oe, glob_cxt))
 			{
 				elog(DEBUG2, "%s: cannot translate op", __func__);
 				return false;
@@ -2419,7 +3546,7 @@ foreign_expr_walker(Node *node,
 
 			/* We only have a chance of converting builtins */
 			if (!is_builtin(oe->opno))
-				return false;
+				return foreign_expr_reject(glob_cxt, "non-builtin operator", get_opname(oe->opno));
 
 
 			/* get operator name, left argument type and schema */
@@ -2446,7 +3573,8 @@ foreign_expr_walker(Node *node,
 			/* Only permit IN and NOT IN expressions for pushdown */
 			if ((strcmp(oprname, "=") != 0 || ! oe->useOr)
 				&& (strcmp(oprname, "<>") != 0 || oe->useOr))
-				return false;
+				return foreign_expr_reject(glob_cxt, "unsupported operator",
+										   psprintf("%s %s", oprname, oe->useOr ? "ANY" : "ALL"));
 
 			elog(DEBUG2, "ScalarArrayOpExpr: leftargtype is %i", leftargtype);
 
@@ -2456,7 +3584,7 @@ foreign_expr_walker(Node *node,
 			 * expressed by "boolval IS NOT FALSE" etc.
 			 */
 			if (!canConvertPgType(leftargtype))
-				return false;
+				return foreign_expr_reject(glob_cxt, "type not convertible", format_type_be(leftargtype));
 
 			/* Recurse to input subexpressions */
 			if (!foreign_expr_walker((Node *) oe->args,
@@ -2471,12 +3599,14 @@ foreign_expr_walker(Node *node,
 			HeapTuple tuple;
 			char *oprname;
 			Oid schema;
+			const fbPushdownFunction *function;
 
 			elog(DEBUG2, "Func expr ------");
 			if (!canConvertPgType(func->funcresulttype))
 			{
 				elog(DEBUG2, "Cannot convert return type");
-				return false;
+				return foreign_expr_reject(glob_cxt, "type not convertible",
+										   format_type_be(func->funcresulttype));
 			}
 
 			if (func->funcformat == COERCE_IMPLICIT_CAST)
@@ -2502,72 +3632,60 @@ foreign_expr_walker(Node *node,
 
 			/* ignore functions not in pg_catalog */
 			if (schema != PG_CATALOG_NAMESPACE)
-				return false;
+				return foreign_expr_reject(glob_cxt, "non-builtin function", oprname);
 
 			/*
 			 * Only permit certain functions (and depending on the function
 			 * certain combination of parameters) to be passed
-			 *
-			 * NOTE: most of these functions were introduced in FB 2.1; some
-			 *	 can be used to convert operators
-			 *
-			 * Not currently sending:
-			 * BIN_AND()
-			 * BIN_OR()
-			 * BIN_XOR()
-			 * EXTRACT()
-			 * INITCAP()
-			 * TO_CHAR()
-			 * TO_DATE()
-			 * TO_NUMBER()
-			 * TO_TIMESTAMP()
-			 * TRANSLATE()
-			 *
-			 * Not practical to push down these:
-			 * IIF () - no equivalent in Pg, shorthand for a CASE construct
-			 * LEFT() -> FB does not accept negative length
-			 * RIGHT() -> FB does not accept negative length
-			 *	 -> to handle these we'll need to examine the length value,
-			 *		which is tricky
 			 */
 			elog(DEBUG2, "Func name is %s", oprname);
 
-			/* Firebird 1.5 or later */
-			if (glob_cxt->firebird_version >= 10500)
+			for (function = pushdownFunctions; function->name != NULL; function++)
 			{
-				if (strcmp(oprname, "concat") == 0)
-					return true;
-
-				/* Firebird's COALESCE() requires at least two arguments */
-				if ((strcmp(oprname, "coalesce") == 0 && list_length(func->args) >= 2))
-					return true;
+				if (strcmp(oprname, function->name) == 0)
+					break;
 			}
 
-			/* Firebird 2.0 or later */
-			if (glob_cxt->firebird_version >= 20000)
+			if (function->name == NULL)
+				return foreign_expr_reject(glob_cxt, "unsupported function", oprname);
+
+			if (glob_cxt->firebird_version < function->firebird_version)
+				return foreign_expr_reject(glob_cxt,
+										   psprintf("requires Firebird %i.%i",
+													function->firebird_version / 10000,
+													(function->firebird_version / 100) % 100),
+										   oprname);
+
+			/* Firebird's COALESCE() requires at least two arguments */
+			if (strcmp(oprname, "coalesce") == 0 && list_length(func->args) < 2)
+				return foreign_expr_reject(glob_cxt, "unsupported arguments", oprname);
+
+			/* SUBSTRING() is a special case: Firebird only accepts integers as the
+			   2nd and 3rd params, Pg variants such as SUBSTRING(string FROM pattern FOR escape)
+			   must not be pushed down.
+			*/
+			if (strcmp(oprname, "substring") == 0)
 			{
-				if (strcmp(oprname, "bit_length") == 0
-				 || strcmp(oprname, "char_length") == 0
-				 || strcmp(oprname, "character_length") == 0
-				 || strcmp(oprname, "lower") == 0
-				 || strcmp(oprname, "octet_length") == 0
-				 || strcmp(oprname, "upper") == 0)
-				{
-					return true;
-				}
+				ListCell *lc;
+				Const *arg;
+				bool can_handle = false;
 
-				/* SUBSTRING() is a special case: Firebird only accepts integers as the
-				   2nd and 3rd params, Pg variants such as SUBSTRING(string FROM pattern FOR escape)
-				   must not be pushed down.
-				*/
-				if (strcmp(oprname, "substring") == 0 && (list_length(func->args) == 2 || list_length(func->args) == 3))
-				{
-					ListCell *lc;
-					Const *arg;
-					bool can_handle = false;
+				if (list_length(func->args) != 2 && list_length(func->args) != 3)
+					return foreign_expr_reject(glob_cxt, "unsupported arguments", oprname);
+
+				lc = list_head(func->args);
 
-					lc = list_head(func->args);
+#if (PG_VERSION_NUM >= 130000)
+				lc = lnext(func->args, lc);
+#else
+				lc = lnext(lc);
+#endif
+				arg = lfirst(lc);
+				if (arg->consttype == INT4OID)
+					can_handle = true;
 
+				if (list_length(func->args) == 3)
+				{
 #if (PG_VERSION_NUM >= 130000)
 					lc = lnext(func->args, lc);
 #else
@@ -2576,71 +3694,13 @@ foreign_expr_walker(Node *node,
 					arg = lfirst(lc);
 					if (arg->consttype == INT4OID)
 						can_handle = true;
-
-					if (list_length(func->args) == 3)
-					{
-#if (PG_VERSION_NUM >= 130000)
-						lc = lnext(func->args, lc);
-#else
-						lc = lnext(lc);
-#endif
-						arg = lfirst(lc);
-						if (arg->consttype == INT4OID)
-							can_handle = true;
-					}
-
-					return can_handle;
-				}
-
-			}
-
-			/* Firebird 2.1 and later */
-			if (glob_cxt->firebird_version >= 20100)
-			{
-				if (strcmp(oprname, "abs") == 0
-				 || strcmp(oprname, "acos") == 0
-				 || strcmp(oprname, "asin") == 0
-				 || strcmp(oprname, "atan") == 0
-				 || strcmp(oprname, "atan2") == 0
-				 || strcmp(oprname, "ceil") == 0
-				 || strcmp(oprname, "ceiling") == 0
-				 || strcmp(oprname, "cos") == 0
-				 || strcmp(oprname, "cot") == 0
-				 || strcmp(oprname, "exp") == 0
-				 || strcmp(oprname, "floor") == 0
-				 || strcmp(oprname, "ltrim") == 0
-				 || strcmp(oprname, "length") == 0
-				 || strcmp(oprname, "log") == 0
-				 || strcmp(oprname, "mod") == 0
-				 || strcmp(oprname, "nullif") == 0
-				 || strcmp(oprname, "overlay") == 0
-				 || strcmp(oprname, "position") == 0
-				 || strcmp(oprname, "pow") == 0
-				 || strcmp(oprname, "power") == 0
-				 || strcmp(oprname, "reverse") == 0
-				 || strcmp(oprname, "rtrim") == 0
-				 || strcmp(oprname, "sign") == 0
-				 || strcmp(oprname, "sin") == 0
-				 || strcmp(oprname, "sqrt") == 0
-				 || strcmp(oprname, "strpos") == 0
-				 || strcmp(oprname, "tan") == 0
-				 || strcmp(oprname, "trunc") == 0)
-				{
-					return true;
 				}
-			}
 
-			/* Firebird 2.5 and later */
-			if (glob_cxt->firebird_version >= 20500)
-			{
-				if (strcmp(oprname, "lpad") == 0
-				 || strcmp(oprname, "rpad") == 0)
-				{
-					return true;
-				}
+				if (!can_handle)
+					return foreign_expr_reject(glob_cxt, "unsupported arguments", oprname);
 			}
 
-			return false;
+			return true;
 		}
 		case T_List:
 		{
@@ -2664,12 +3724,49 @@ foreign_expr_walker(Node *node,
 			return true;
 		}
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+		case T_Aggref:
+		{
+			Aggref	   *agg = (Aggref *) node;
+
+			/* Aggregates can only be pushed down as part of an upper relation */
+			if (!IS_UPPER_REL(glob_cxt->foreignrel))
+				return foreign_expr_reject(glob_cxt, "unsupported node type", "aggregate");
+
+			if (!canConvertAggref(agg))
+			{
+				elog(DEBUG2, "%s: cannot convert aggregate", __func__);
+				return foreign_expr_reject(glob_cxt, "unsupported aggregate", NULL);
+			}
+
+			/* Recurse to input arguments (a list of TargetEntry nodes) */
+			if (!foreign_expr_walker((Node *) agg->args,
+									 glob_cxt))
+				return false;
+
+			return true;
+		}
+
+		case T_TargetEntry:
+		{
+			TargetEntry *tle = (TargetEntry *) node;
+
+			return foreign_expr_walker((Node *) tle->expr,
+									   glob_cxt);
+		}
+#endif
+
 		default:
 
 			/* Assume any other types are unsafe */
 			elog(DEBUG1, "%s(): Unhandled node tag: %i", __func__, nodeTag(node));
 
-			return false;
+			/* COLLATE clauses are not yet handled */
+			if (IsA(node, CollateExpr))
+				return foreign_expr_reject(glob_cxt, "collation", "COLLATE clause");
+
+			return foreign_expr_reject(glob_cxt, "unsupported node type",
+									   unsupportedNodeName(node));
 	}
 
 	/* should never reach here */
@@ -2677,6 +3774,277 @@ foreign_expr_walker(Node *node,
 }
 
 
+/**
+ * foreign_expr_reject()
+ *
+ * Record why foreign_expr_walker() rejected an expression, if the caller
+ * wants to know, and return false. "detail", if provided, identifies the
+ * offending function, operator or type.
+ */
+static bool
+foreign_expr_reject(foreign_glob_cxt *glob_cxt,
+					const char *reason,
+					const char *detail)
+{
+	if (glob_cxt->reject_reason == NULL || *glob_cxt->reject_reason != NULL)
+		return false;
+
+	if (detail != NULL)
+		*glob_cxt->reject_reason = psprintf("%s (%s)", reason, detail);
+	else
+		*glob_cxt->reject_reason = pstrdup(reason);
+
+	return false;
+}
+
+
+/**
+ * unsupportedNodeName()
+ *
+ * Return a description of common expression node types which
+ * foreign_expr_walker() does not handle, or NULL.
+ */
+static const char *
+unsupportedNodeName(Node *node)
+{
+	switch (nodeTag(node))
+	{
+		case T_Param:
+			return "parameter";
+		case T_SubPlan:
+		case T_AlternativeSubPlan:
+			return "subquery";
+		case T_CaseExpr:
+			return "CASE";
+		case T_CoalesceExpr:
+			return "COALESCE";
+		case T_MinMaxExpr:
+			return "GREATEST/LEAST";
+		case T_NullIfExpr:
+			return "NULLIF";
+		case T_ArrayExpr:
+			return "array";
+		case T_RowExpr:
+			return "row";
+		case T_CoerceViaIO:
+		case T_ArrayCoerceExpr:
+			return "type coercion";
+		case T_WindowFunc:
+			return "window function";
+#if (PG_VERSION_NUM >= 100000)
+		case T_SQLValueFunction:
+			return "SQL value function";
+#endif
+		default:
+			return NULL;
+	}
+}
+
+
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+/**
+ * getAggregateName()
+ *
+ * Return the name of the provided aggregate function, or NULL if it is not
+ * a built-in function in pg_catalog.
+ */
+static char *
+getAggregateName(Oid aggfnoid)
+{
+	HeapTuple	tuple;
+	Form_pg_proc procform;
+	char	   *aggname = NULL;
+
+	if (!is_builtin(aggfnoid))
+		return NULL;
+
+	tuple = SearchSysCache1(PROCOID, ObjectIdGetDatum(aggfnoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for function %u", aggfnoid);
+
+	procform = (Form_pg_proc) GETSTRUCT(tuple);
+
+	if (procform->pronamespace == PG_CATALOG_NAMESPACE)
+		aggname = pstrdup(NameStr(procform->proname));
+
+	ReleaseSysCache(tuple);
+
+	return aggname;
+}
+
+
+/**
+ * canConvertAggref()
+ *
+ * Indicate whether an aggregate can be evaluated by Firebird.
+ *
+ * Only COUNT(), SUM(), MIN(), MAX() and AVG() are considered, and only
+ * where Firebird is guaranteed to return the same result as PostgreSQL:
+ *
+ *	 - MIN() and MAX() are restricted to numeric and date/time types,
+ *	   as the ordering of character data depends on the Firebird collation
+ *	 - AVG() is restricted to floating-point arguments, as Firebird
+ *	   truncates the average of integer and fixed-point values
+ *
+ * When performing partial aggregation (as used by partitionwise
+ * aggregation), each aggregate must return its transition state, which
+ * PostgreSQL will then combine and finalize. This is only possible where
+ * the state is a simple value which Firebird can produce, i.e. COUNT(),
+ * MIN(), MAX() and SUM() of types other than BIGINT and NUMERIC. AVG() of SMALLINT
+ * and INTEGER values is a special case: its transition state is an array
+ * containing the count and sum of the input values, which can be
+ * generated from COUNT() and SUM(); see convertAggref().
+ */
+static bool
+canConvertAggref(Aggref *agg)
+{
+	char	   *aggname;
+	Oid			argtype;
+	bool		partial;
+
+	/* Only plain aggregates without ORDER BY, FILTER or VARIADIC */
+	if (agg->aggkind != AGGKIND_NORMAL ||
+		agg->aggorder != NIL ||
+		agg->aggfilter != NULL ||
+		agg->aggvariadic)
+		return false;
+
+	/* Only full aggregation or the initial step of partial aggregation */
+	if (agg->aggsplit == AGGSPLIT_SIMPLE)
+		partial = false;
+	else if (agg->aggsplit == AGGSPLIT_INITIAL_SERIAL)
+		partial = true;
+	else
+		return false;
+
+	aggname = getAggregateName(agg->aggfnoid);
+
+	if (aggname == NULL)
+		return false;
+
+	if (agg->aggstar)
+		return strcmp(aggname, "count") == 0;
+
+	/* All supported aggregates take a single argument */
+	if (list_length(agg->args) != 1)
+		return false;
+
+	if (partial == true && agg->aggdistinct != NIL)
+		return false;
+
+	argtype = exprType((Node *) ((TargetEntry *) linitial(agg->args))->expr);
+
+	if (!canConvertPgType(argtype))
+		return false;
+
+	if (strcmp(aggname, "count") == 0)
+		return true;
+
+	if (strcmp(aggname, "min") == 0 || strcmp(aggname, "max") == 0)
+	{
+		switch (argtype)
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case FLOAT4OID:
+			case FLOAT8OID:
+			case NUMERICOID:
+			case DATEOID:
+			case TIMEOID:
+			case TIMESTAMPOID:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	if (strcmp(aggname, "sum") == 0)
+	{
+		switch (argtype)
+		{
+			case INT2OID:
+			case INT4OID:
+			case FLOAT4OID:
+			case FLOAT8OID:
+				return true;
+			case INT8OID:
+			case NUMERICOID:
+				/* transition state is "internal" */
+				return !partial;
+			default:
+				return false;
+		}
+	}
+
+	if (strcmp(aggname, "avg") == 0)
+	{
+		if (partial == true)
+			return argtype == INT2OID || argtype == INT4OID;
+
+		return argtype == FLOAT4OID || argtype == FLOAT8OID;
+	}
+
+	return false;
+}
+
+
+/**
+ * convertAggref()
+ *
+ * Convert an aggregate previously approved by canConvertAggref().
+ */
+static void
+convertAggref(Aggref *node, convert_expr_cxt *context, char **result)
+{
+	StringInfoData buf;
+	char	   *aggname = getAggregateName(node->aggfnoid);
+	char	   *arg = NULL;
+	char	   *p;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	initStringInfo(&buf);
+
+	if (node->aggstar)
+	{
+		appendStringInfoString(&buf, "COUNT(*)");
+		*result = pstrdup(buf.data);
+		return;
+	}
+
+	convertExprRecursor(((TargetEntry *) linitial(node->args))->expr,
+						context, &arg);
+
+	if (node->aggsplit != AGGSPLIT_SIMPLE && strcmp(aggname, "avg") == 0)
+	{
+		/*
+		 * The transition state of AVG(SMALLINT|INTEGER) is a BIGINT array
+		 * containing the count and sum of the input values; generate it in
+		 * PostgreSQL's array input format.
+		 */
+		appendStringInfo(&buf,
+						 "'{' || COUNT(%s) || ',' || COALESCE(SUM(%s), 0) || '}'",
+						 arg, arg);
+	}
+	else
+	{
+		for (p = aggname; *p; p++)
+			appendStringInfoChar(&buf, pg_toupper((unsigned char) *p));
+
+		appendStringInfoChar(&buf, '(');
+
+		if (node->aggdistinct != NIL)
+			appendStringInfoString(&buf, "DISTINCT ");
+
+		appendStringInfo(&buf, "%s)", arg);
+	}
+
+	*result = pstrdup(buf.data);
+}
+#endif
+
+
 /**
  * is_builtin()
  *
@@ -2720,9 +4088,12 @@ is_builtin(Oid oid)
  *	 http://ibexpert.net/ibe/index.php?n=Doc.ComparisonOperators
  *
  * Synchronize with convertOperatorName().
+ *
+ * If the operator cannot be converted, the reason is recorded in
+ * "glob_cxt".
  */
 static bool
-canConvertOp(OpExpr *oe, int firebird_version)
+canConvertOp(OpExpr *oe, foreign_glob_cxt *glob_cxt)
 {
 	HeapTuple	tuple;
 	Form_pg_operator form;
@@ -2741,7 +4112,7 @@ canConvertOp(OpExpr *oe, int firebird_version)
 
 	/* ignore operators in other than the pg_catalog schema */
 	if (schema != PG_CATALOG_NAMESPACE)
-		return false;
+		return foreign_expr_reject(glob_cxt, "non-builtin operator", oprname);
 
 	elog(DEBUG2, "canConvertOp(): oprname is '%s'", oprname);
 	if (  strcmp(oprname, "=") == 0
@@ -2761,19 +4132,18 @@ canConvertOp(OpExpr *oe, int firebird_version)
 	}
 
 	/* Some Pg operators have equivalent functions in Firebird */
-	if (firebird_version >= 20100)
+	if (strcmp(oprname, "<<") == 0
+	|| strcmp(oprname, ">>") == 0)
 	{
-		if (strcmp(oprname, "<<") == 0
-		|| strcmp(oprname, ">>") == 0)
+		if (glob_cxt->firebird_version >= 20100)
 		{
 			pfree(oprname);
 			return true;
 		}
-	}
-
 
-	pfree(oprname);
+		return foreign_expr_reject(glob_cxt, "requires Firebird 2.1", oprname);
+	}
 
-	return false;
+	return foreign_expr_reject(glob_cxt, "unsupported operator", oprname);
 }
 
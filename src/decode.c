@@ -0,0 +1,527 @@
+/*-------------------------------------------------------------------------
+ *
+ * Column-wise decoding of remote query results for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/decode.c
+ *
+ * Rows of a foreign scan's result are converted to PostgreSQL values a
+ * block at a time. Each block is decoded column by column into arrays
+ * of Datums and null flags, with the data type being examined once per
+ * column rather than once per value, and common types being converted
+ * directly rather than via their type input function. Tuples are then
+ * formed from the arrays one row at a time.
+ *
+ * Only the direct conversions, which cannot fail, are made in advance.
+ * Values needing the type input function are merely marked as pending
+ * and converted when their row is actually returned, so that a value
+ * which the input function rejects only raises an error if the scan
+ * gets as far as its row (e.g. not if a LIMIT is reached before it).
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "firebird_fdw.h"
+
+#include "utils/date.h"
+#include "utils/datetime.h"
+#include "utils/memutils.h"
+
+
+struct fbDecodeBlock
+{
+	TupleDesc	tupdesc;
+	AttInMetadata *attinmeta;
+	int		   *field_map;			/* result field of each tuple column, or -1 */
+	char	  **column_values;		/* value of each column without a result
+								 * field, or NULL */
+	bool		trusted_encoding;	/* copy varchar values without checking them */
+	MemoryContext cxt;				/* memory for decoded values, reset for each block */
+	Datum	  **values;				/* decoded values of each column */
+	bool	  **nulls;				/* null flags of each column */
+	bool	  **pending;			/* values still to be passed to the input function */
+	char	  **strings;			/* work space: values of the column being decoded */
+	int			start_row;			/* result row number of the block's first row */
+	int			nrows;				/* number of rows decoded; 0 if none */
+};
+
+static void fbDecodeBlockFill(fbDecodeBlock *block, FBresult *res, int start_row);
+static void fbDecodeColumn(fbDecodeBlock *block, FBresult *res, int attnum);
+static inline bool fbDecodeInt64(const char *str, int64 *result);
+static Datum fbDecodeWithInputFunction(fbDecodeBlock *block, FBresult *res,
+										int row, int attnum);
+static inline bool fbDecodeDate(const char *str, DateADT *result);
+
+
+/**
+ * firebirdDecodeBlockCreate()
+ *
+ * Set up decoding of rows into tuples with the descriptor "tupdesc";
+ * "field_map" contains, for each attribute, the number of the result
+ * field providing its value, or -1 if the attribute is not retrieved.
+ * The value of such an attribute is taken from "column_values", if
+ * provided and set for the attribute, and is otherwise NULL; the caller
+ * may change the values whenever the decoded rows are reset.
+ *
+ * All memory is allocated in the current memory context, which must
+ * last as long as the scan.
+ */
+fbDecodeBlock *
+firebirdDecodeBlockCreate(TupleDesc tupdesc, int *field_map, char **column_values,
+						  bool trusted_encoding)
+{
+	fbDecodeBlock *block = (fbDecodeBlock *) palloc0(sizeof(fbDecodeBlock));
+	int			i;
+
+	block->tupdesc = tupdesc;
+	block->attinmeta = TupleDescGetAttInMetadata(tupdesc);
+	block->field_map = field_map;
+	block->column_values = column_values;
+	block->trusted_encoding = trusted_encoding;
+	block->cxt = AllocSetContextCreate(CurrentMemoryContext,
+									   "firebird_fdw decoded rows",
+									   ALLOCSET_DEFAULT_SIZES);
+
+	block->values = (Datum **) palloc(sizeof(Datum *) * tupdesc->natts);
+	block->nulls = (bool **) palloc(sizeof(bool *) * tupdesc->natts);
+	block->pending = (bool **) palloc(sizeof(bool *) * tupdesc->natts);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		block->values[i] = (Datum *) palloc(sizeof(Datum) * FIREBIRD_DECODE_BLOCK_ROWS);
+		block->nulls[i] = (bool *) palloc(sizeof(bool) * FIREBIRD_DECODE_BLOCK_ROWS);
+		block->pending[i] = (bool *) palloc(sizeof(bool) * FIREBIRD_DECODE_BLOCK_ROWS);
+	}
+
+	block->strings = (char **) palloc(sizeof(char *) * FIREBIRD_DECODE_BLOCK_ROWS);
+
+	return block;
+}
+
+
+/**
+ * firebirdDecodeBlockReset()
+ *
+ * Discard the decoded rows, e.g. as the result they were decoded from
+ * has been released.
+ */
+void
+firebirdDecodeBlockReset(fbDecodeBlock *block)
+{
+	block->nrows = 0;
+}
+
+
+/**
+ * firebirdDecodeBlockGetTuple()
+ *
+ * Return a tuple containing row "row" of "res", decoding the block of
+ * rows beginning with it if necessary. Any of the row's values pending
+ * conversion by their type input function are converted now. The tuple
+ * is allocated in the current memory context.
+ */
+HeapTuple
+firebirdDecodeBlockGetTuple(fbDecodeBlock *block, FBresult *res, int row)
+{
+	int			natts = block->tupdesc->natts;
+	Datum	   *values = (Datum *) palloc(sizeof(Datum) * natts);
+	bool	   *nulls = (bool *) palloc(sizeof(bool) * natts);
+	HeapTuple	tuple;
+	int			offset;
+	int			i;
+
+	if (block->nrows == 0 ||
+		row < block->start_row ||
+		row >= block->start_row + block->nrows)
+		fbDecodeBlockFill(block, res, row);
+
+	offset = row - block->start_row;
+
+	for (i = 0; i < natts; i++)
+	{
+		if (block->pending[i][offset])
+			values[i] = fbDecodeWithInputFunction(block, res, row, i);
+		else
+			values[i] = block->values[i][offset];
+
+		nulls[i] = block->nulls[i][offset];
+	}
+
+	tuple = heap_form_tuple(block->tupdesc, values, nulls);
+
+	pfree(values);
+	pfree(nulls);
+
+	return tuple;
+}
+
+
+/**
+ * fbDecodeBlockFill()
+ *
+ * Decode up to FIREBIRD_DECODE_BLOCK_ROWS rows of "res", beginning
+ * with "start_row".
+ */
+static void
+fbDecodeBlockFill(fbDecodeBlock *block, FBresult *res, int start_row)
+{
+	MemoryContext oldcontext;
+	int			i;
+
+	MemoryContextReset(block->cxt);
+
+	block->start_row = start_row;
+	block->nrows = Min(FQntuples(res) - start_row, FIREBIRD_DECODE_BLOCK_ROWS);
+
+	elog(DEBUG2, "%s: decoding rows %i to %i", __func__,
+		 start_row, start_row + block->nrows - 1);
+
+	FIREBIRD_FDW_FETCH_BLOCK(start_row, block->nrows);
+
+	oldcontext = MemoryContextSwitchTo(block->cxt);
+
+	for (i = 0; i < block->tupdesc->natts; i++)
+		fbDecodeColumn(block, res, i);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+
+/**
+ * fbDecodeColumn()
+ *
+ * Decode the values of attribute "attnum" (zero-based) in the current
+ * block.
+ *
+ * Values of integer, floating point, date and string types are converted
+ * directly, falling back to the type input function for any value not
+ * in the expected format; values of other types (including domains)
+ * are passed to the type input function. Values for the type input
+ * function are only marked as pending here; see
+ * firebirdDecodeBlockGetTuple().
+ */
+static void
+fbDecodeColumn(fbDecodeBlock *block, FBresult *res, int attnum)
+{
+#if (PG_VERSION_NUM >= 110000)
+	Form_pg_attribute att = TupleDescAttr(block->tupdesc, attnum);
+#else
+	Form_pg_attribute att = block->tupdesc->attrs[attnum];
+#endif
+	Datum	   *values = block->values[attnum];
+	bool	   *nulls = block->nulls[attnum];
+	bool	   *pending = block->pending[attnum];
+	char	  **strings = block->strings;
+	int			field = block->field_map[attnum];
+	int			nrows = block->nrows;
+	int			row;
+
+	if (att->attisdropped)
+	{
+		for (row = 0; row < nrows; row++)
+		{
+			values[row] = (Datum) 0;
+			nulls[row] = true;
+			pending[row] = false;
+		}
+
+		return;
+	}
+
+	for (row = 0; row < nrows; row++)
+	{
+		if (field < 0)
+			strings[row] = block->column_values ? block->column_values[attnum] : NULL;
+		else if (FQgetisnull(res, block->start_row + row, field))
+			strings[row] = NULL;
+		else
+			strings[row] = FQgetvalue(res, block->start_row + row, field);
+
+		nulls[row] = (strings[row] == NULL);
+		values[row] = (Datum) 0;
+		pending[row] = false;
+	}
+
+/* Leave a value to the type input function */
+#define DECODE_WITH_INPUT_FUNCTION(row) \
+	(pending[(row)] = true)
+
+	switch (att->atttypid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			for (row = 0; row < nrows; row++)
+			{
+				int64		value;
+
+				if (nulls[row])
+					continue;
+
+				if (!fbDecodeInt64(strings[row], &value))
+					DECODE_WITH_INPUT_FUNCTION(row);
+				else if (att->atttypid == INT8OID)
+					values[row] = Int64GetDatum(value);
+				else if (att->atttypid == INT4OID && value >= PG_INT32_MIN && value <= PG_INT32_MAX)
+					values[row] = Int32GetDatum((int32) value);
+				else if (att->atttypid == INT2OID && value >= PG_INT16_MIN && value <= PG_INT16_MAX)
+					values[row] = Int16GetDatum((int16) value);
+				else
+					DECODE_WITH_INPUT_FUNCTION(row);
+			}
+			break;
+
+		case FLOAT4OID:
+		case FLOAT8OID:
+			for (row = 0; row < nrows; row++)
+			{
+				char	   *endptr;
+				double		value;
+
+				if (nulls[row])
+					continue;
+
+				errno = 0;
+#if (PG_VERSION_NUM >= 120000)
+				/* float4in() parses with strtof(), avoiding double rounding */
+				if (att->atttypid == FLOAT4OID)
+					value = (double) strtof(strings[row], &endptr);
+				else
+#endif
+					value = strtod(strings[row], &endptr);
+
+				/* Leave anything out of the ordinary to the input function */
+				if (errno != 0 || endptr == strings[row] || *endptr != '\0' ||
+					isinf(value) || isnan(value))
+					DECODE_WITH_INPUT_FUNCTION(row);
+				else if (att->atttypid == FLOAT8OID)
+					values[row] = Float8GetDatum(value);
+				else if (fabs(value) <= FLT_MAX && (value == 0.0 || fabs(value) >= FLT_MIN))
+					values[row] = Float4GetDatum((float4) value);
+				else
+					DECODE_WITH_INPUT_FUNCTION(row);
+			}
+			break;
+
+		case DATEOID:
+			for (row = 0; row < nrows; row++)
+			{
+				DateADT		value;
+
+				if (nulls[row])
+					continue;
+
+				if (fbDecodeDate(strings[row], &value))
+					values[row] = DateADTGetDatum(value);
+				else
+					DECODE_WITH_INPUT_FUNCTION(row);
+			}
+			break;
+
+		case TEXTOID:
+			/* textin() does nothing more than this */
+			for (row = 0; row < nrows; row++)
+			{
+				if (nulls[row])
+					continue;
+
+				values[row] = PointerGetDatum(cstring_to_text(strings[row]));
+			}
+			break;
+
+		case VARCHAROID:
+			{
+				/*
+				 * With "trusted_encoding", the value's encoding is not
+				 * checked. A value whose length in bytes does not exceed the
+				 * declared length in characters cannot exceed the latter;
+				 * any other value is left to varcharin() to check.
+				 */
+				int			maxlen = att->atttypmod - VARHDRSZ;
+
+				for (row = 0; row < nrows; row++)
+				{
+					int			len;
+
+					if (nulls[row])
+						continue;
+
+					if (!block->trusted_encoding)
+					{
+						DECODE_WITH_INPUT_FUNCTION(row);
+						continue;
+					}
+
+					if (field < 0)
+						len = strlen(strings[row]);
+					else
+						len = FQgetlength(res, block->start_row + row, field);
+
+					if (att->atttypmod < (int32) VARHDRSZ || len <= maxlen)
+						values[row] = PointerGetDatum(cstring_to_text_with_len(strings[row], len));
+					else
+						DECODE_WITH_INPUT_FUNCTION(row);
+				}
+			}
+			break;
+
+		case BPCHAROID:
+			{
+				/*
+				 * Firebird pads CHAR(n) values to their declared length; if
+				 * the value, trimmed of any trailing spaces beyond n characters,
+				 * has exactly the length of the PostgreSQL column, it can be
+				 * stored as-is. Character and byte lengths are only equivalent
+				 * in single-byte encodings.
+				 */
+				int			maxlen = att->atttypmod - VARHDRSZ;
+				bool		single_byte = (pg_database_encoding_max_length() == 1);
+
+				for (row = 0; row < nrows; row++)
+				{
+					int			len;
+
+					if (nulls[row])
+						continue;
+
+					len = strlen(strings[row]);
+
+					if (single_byte && maxlen > 0)
+					{
+						while (len > maxlen && strings[row][len - 1] == ' ')
+							len--;
+					}
+
+					if (single_byte && len == maxlen)
+						values[row] = PointerGetDatum(cstring_to_text_with_len(strings[row], len));
+					else
+						DECODE_WITH_INPUT_FUNCTION(row);
+				}
+			}
+			break;
+
+		default:
+			/* Called even for NULL values, to support domains */
+			for (row = 0; row < nrows; row++)
+				DECODE_WITH_INPUT_FUNCTION(row);
+			break;
+	}
+
+#undef DECODE_WITH_INPUT_FUNCTION
+}
+
+
+/**
+ * fbDecodeWithInputFunction()
+ *
+ * Convert the value of attribute "attnum" (zero-based) in row "row" of
+ * "res" with the attribute's type input function. As with the fast
+ * paths, this is done even for NULL values, to support domains. The
+ * value is allocated in the current memory context.
+ */
+static Datum
+fbDecodeWithInputFunction(fbDecodeBlock *block, FBresult *res, int row, int attnum)
+{
+	AttInMetadata *attinmeta = block->attinmeta;
+	int			field = block->field_map[attnum];
+	char	   *string = NULL;
+
+	if (field < 0)
+		string = block->column_values ? block->column_values[attnum] : NULL;
+	else if (!FQgetisnull(res, row, field))
+		string = FQgetvalue(res, row, field);
+
+	return InputFunctionCall(&attinmeta->attinfuncs[attnum],
+							 string,
+							 attinmeta->attioparams[attnum],
+							 attinmeta->atttypmods[attnum]);
+}
+
+
+/**
+ * fbDecodeInt64()
+ *
+ * Parse a plain decimal integer of up to 18 digits, which cannot
+ * overflow; returns false for anything else.
+ */
+static inline bool
+fbDecodeInt64(const char *str, int64 *result)
+{
+	const char *ptr = str;
+	bool		neg = false;
+	int64		value = 0;
+
+	if (*ptr == '-')
+	{
+		neg = true;
+		ptr++;
+	}
+
+	if (*ptr == '\0')
+		return false;
+
+	for (; *ptr != '\0'; ptr++)
+	{
+		if (*ptr < '0' || *ptr > '9' || ptr - str >= 18 + (neg ? 1 : 0))
+			return false;
+
+		value = value * 10 + (*ptr - '0');
+	}
+
+	*result = neg ? -value : value;
+
+	return true;
+}
+
+
+/**
+ * fbDecodeDate()
+ *
+ * Parse a date in Firebird's "YYYY-MM-DD" output format; returns false
+ * for anything else.
+ */
+static inline bool
+fbDecodeDate(const char *str, DateADT *result)
+{
+	int			year;
+	int			month;
+	int			day;
+	int			i;
+
+	for (i = 0; i < 10; i++)
+	{
+		if (i == 4 || i == 7)
+		{
+			if (str[i] != '-')
+				return false;
+		}
+		else if (str[i] < '0' || str[i] > '9')
+			return false;
+	}
+
+	if (str[10] != '\0')
+		return false;
+
+	year = (str[0] - '0') * 1000 + (str[1] - '0') * 100 + (str[2] - '0') * 10 + (str[3] - '0');
+	month = (str[5] - '0') * 10 + (str[6] - '0');
+	day = (str[8] - '0') * 10 + (str[9] - '0');
+
+	if (year < 1 || month < 1 || month > MONTHS_PER_YEAR ||
+		day < 1 || day > day_tab[isleap(year)][month - 1])
+		return false;
+
+	*result = date2j(year, month, day) - POSTGRES_EPOCH_JDATE;
+
+	return true;
+}
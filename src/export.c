@@ -0,0 +1,295 @@
+/*-------------------------------------------------------------------------
+ *
+ * Bulk export of remote query results for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/export.c
+ *
+ * firebird_fdw_export() writes the result of a Firebird query directly
+ * to a server-side file in COPY's CSV or text format. The values
+ * returned by Firebird are written as-is, without forming PostgreSQL
+ * tuples or calling any datatype input/output functions.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "firebird_fdw.h"
+
+#if (PG_VERSION_NUM >= 110000)
+#include "catalog/pg_authid.h"
+#endif
+#include "utils/acl.h"
+#include "utils/builtins.h"
+
+
+typedef enum fbExportFormat
+{
+	FB_EXPORT_CSV,
+	FB_EXPORT_TEXT
+} fbExportFormat;
+
+extern Datum firebird_fdw_export(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(firebird_fdw_export);
+
+static void fbExportAppendCSV(StringInfo buf, const char *value);
+static void fbExportAppendText(StringInfo buf, const char *value);
+
+
+/**
+ * firebird_fdw_export()
+ *
+ * Execute a query on the named server and write its result to the
+ * specified file, returning the number of rows written.
+ */
+Datum
+firebird_fdw_export(PG_FUNCTION_ARGS)
+{
+	char	   *server_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	char	   *path = text_to_cstring(PG_GETARG_TEXT_PP(2));
+	char	   *format_name = text_to_cstring(PG_GETARG_TEXT_PP(3));
+	bool		header = PG_GETARG_BOOL(4);
+	fbExportFormat format;
+	ForeignServer *server;
+	UserMapping *user;
+	FBconn	   *conn;
+	FBresult   *res;
+	FILE	   *file;
+	StringInfoData buf;
+	int			nfields;
+	int			nrows;
+	int			row;
+	int			field;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (pg_strcasecmp(format_name, "csv") == 0)
+		format = FB_EXPORT_CSV;
+	else if (pg_strcasecmp(format_name, "text") == 0)
+		format = FB_EXPORT_TEXT;
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("export format \"%s\" not recognized", format_name),
+				 errhint("Valid formats are \"csv\" and \"text\".")));
+
+	if (header == true && format != FB_EXPORT_CSV)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("header is only available in CSV format")));
+
+	/* Same permission requirements as COPY ... TO 'filename' */
+#if (PG_VERSION_NUM >= 110000)
+#if (PG_VERSION_NUM >= 140000)
+	if (!has_privs_of_role(GetUserId(), ROLE_PG_WRITE_SERVER_FILES))
+#else
+	if (!has_privs_of_role(GetUserId(), DEFAULT_ROLE_WRITE_SERVER_FILES))
+#endif
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser or a member of the pg_write_server_files role to export to a file")));
+#else
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to export to a file")));
+#endif
+
+	if (!is_absolute_path(path))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_NAME),
+				 errmsg("relative path not allowed for export to file")));
+
+	server = GetForeignServerByName(server_name, false);
+	firebirdCheckServerUsage(server);
+
+	user = GetUserMapping(GetUserId(), server->serverid);
+	conn = firebirdInstantiateConnection(server, user);
+
+	elog(DEBUG1, "export query:\n%s", query);
+
+	/*
+	 * libfq has no cursor-based fetch, so the whole result is materialized
+	 * by FQexec(); the user must divide very large exports into parts.
+	 */
+
+	res = FQexec(conn, query);
+
+	if (FQresultStatus(res) != FBRES_TUPLES_OK)
+		fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, query);
+
+	nfields = FQnfields(res);
+	nrows = FQntuples(res);
+
+	file = AllocateFile(path, PG_BINARY_W);
+
+	if (file == NULL)
+	{
+		int			save_errno = errno;
+
+		FQclear(res);
+		errno = save_errno;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\" for writing: %m",
+						path)));
+	}
+
+	initStringInfo(&buf);
+
+	PG_TRY();
+	{
+		if (header == true)
+		{
+			for (field = 0; field < nfields; field++)
+			{
+				if (field > 0)
+					appendStringInfoChar(&buf, ',');
+				fbExportAppendCSV(&buf, FQfname(res, field));
+			}
+			appendStringInfoChar(&buf, '\n');
+		}
+
+		for (row = 0; row < nrows; row++)
+		{
+			for (field = 0; field < nfields; field++)
+			{
+				if (field > 0)
+					appendStringInfoChar(&buf, format == FB_EXPORT_CSV ? ',' : '\t');
+
+				if (FQgetisnull(res, row, field))
+				{
+					/* CSV represents NULL as an unquoted empty string */
+					if (format == FB_EXPORT_TEXT)
+						appendStringInfoString(&buf, "\\N");
+				}
+				else if (format == FB_EXPORT_CSV)
+					fbExportAppendCSV(&buf, FQgetvalue(res, row, field));
+				else
+					fbExportAppendText(&buf, FQgetvalue(res, row, field));
+			}
+
+			appendStringInfoChar(&buf, '\n');
+
+			/* Write out in reasonably-sized chunks */
+			if (buf.len >= 65536 || row == nrows - 1)
+			{
+				if (fwrite(buf.data, 1, buf.len, file) != (size_t) buf.len)
+					ereport(ERROR,
+							(errcode_for_file_access(),
+							 errmsg("could not write to file \"%s\": %m",
+									path)));
+				resetStringInfo(&buf);
+			}
+
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		/* header only */
+		if (buf.len > 0 &&
+			fwrite(buf.data, 1, buf.len, file) != (size_t) buf.len)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							path)));
+	}
+	PG_CATCH();
+	{
+		FQclear(res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	FQclear(res);
+	pfree(buf.data);
+
+	if (FreeFile(file))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m",
+						path)));
+
+	PG_RETURN_INT64((int64) nrows);
+}
+
+
+/**
+ * fbExportAppendCSV()
+ *
+ * Append a value to "buf" in CSV format, quoting it if it contains the
+ * delimiter, quote character or a line break, or is an empty string.
+ */
+static void
+fbExportAppendCSV(StringInfo buf, const char *value)
+{
+	const char *ptr;
+
+	if (value[0] != '\0' && strpbrk(value, ",\"\r\n") == NULL)
+	{
+		appendStringInfoString(buf, value);
+		return;
+	}
+
+	appendStringInfoChar(buf, '"');
+
+	for (ptr = value; *ptr != '\0'; ptr++)
+	{
+		if (*ptr == '"')
+			appendStringInfoChar(buf, '"');
+		appendStringInfoChar(buf, *ptr);
+	}
+
+	appendStringInfoChar(buf, '"');
+}
+
+
+/**
+ * fbExportAppendText()
+ *
+ * Append a value to "buf" in COPY's text format, escaping backslashes
+ * and control characters which would otherwise be misinterpreted.
+ */
+static void
+fbExportAppendText(StringInfo buf, const char *value)
+{
+	const char *ptr;
+	const char *start = value;
+
+	for (ptr = value; *ptr != '\0'; ptr++)
+	{
+		char		escape;
+
+		switch (*ptr)
+		{
+			case '\\':
+				escape = '\\';
+				break;
+			case '\t':
+				escape = 't';
+				break;
+			case '\n':
+				escape = 'n';
+				break;
+			case '\r':
+				escape = 'r';
+				break;
+			default:
+				continue;
+		}
+
+		appendBinaryStringInfo(buf, start, ptr - start);
+		appendStringInfoChar(buf, '\\');
+		appendStringInfoChar(buf, escape);
+		start = ptr + 1;
+	}
+
+	appendStringInfoString(buf, start);
+}
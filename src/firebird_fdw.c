@@ -34,12 +34,14 @@
 #include "catalog/pg_type.h"
 #include "commands/explain.h"
 #include "commands/vacuum.h"
+#include "executor/executor.h"
 #include "executor/spi.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
 #include "miscadmin.h"
 #include "mb/pg_wchar.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #if (PG_VERSION_NUM >= 140000)
 #include "optimizer/appendinfo.h"
 #endif
@@ -49,7 +51,9 @@
 #endif
 #include "optimizer/pathnode.h"
 #include "optimizer/planmain.h"
+#include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #if (PG_VERSION_NUM >= 120000)
 #include "optimizer/optimizer.h"
 #else
@@ -67,7 +71,9 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/selfuncs.h"
 #include "utils/snapmgr.h"
+#include "utils/tuplestore.h"
 
 #include "firebird_fdw.h"
 
@@ -82,6 +88,11 @@ PG_MODULE_MAGIC;
  *
  * 1) SELECT statement text to be sent to the remote server
  * 2) Integer list of attribute numbers retrieved by the SELECT
+ * 3) Whether RDB$DB_KEY is retrieved by the SELECT
+ * 4) Reasons the conditions evaluated locally could not be sent
+ * 5) Integer list of the parameter columns returning the values of
+ *	  fdw_exprs (stored procedure arguments or query placeholders)
+ * 6) Integer list of the fdw_exprs values bound to the remote parameters
  *
  * These items are indexed with the enum FdwScanPrivateIndex, so an item
  * can be fetched with list_nth().	For example, to get the SELECT statement:
@@ -94,7 +105,13 @@ enum FdwScanPrivateIndex
 	/* Integer list of attribute numbers retrieved by the remote SELECT */
 	FdwScanPrivateRetrievedAttrs,
 	/* Indicates whether RDB$DB_KEY retrieved by the remote SELECT */
-	FdwScanDbKeyUsed
+	FdwScanDbKeyUsed,
+	/* List of String nodes: why each local condition was not sent */
+	FdwScanPrivateLocalReasons,
+	/* Integer list: parameter column returning each fdw_exprs value */
+	FdwScanPrivateParamAttnos,
+	/* Integer list: fdw_exprs value bound to each remote query parameter */
+	FdwScanPrivateParamOrder
 };
 
 /*
@@ -121,6 +138,7 @@ extern Datum firebird_fdw_close_connections(PG_FUNCTION_ARGS);
 extern Datum firebird_fdw_server_options(PG_FUNCTION_ARGS);
 extern Datum firebird_fdw_diag(PG_FUNCTION_ARGS);
 extern Datum firebird_version(PG_FUNCTION_ARGS);
+extern Datum firebird_fdw_cache_invalidate(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(firebird_fdw_handler);
 PG_FUNCTION_INFO_V1(firebird_fdw_version);
@@ -128,6 +146,7 @@ PG_FUNCTION_INFO_V1(firebird_fdw_close_connections);
 PG_FUNCTION_INFO_V1(firebird_fdw_server_options);
 PG_FUNCTION_INFO_V1(firebird_fdw_diag);
 PG_FUNCTION_INFO_V1(firebird_version);
+PG_FUNCTION_INFO_V1(firebird_fdw_cache_invalidate);
 
 extern void _PG_init(void);
 
@@ -160,6 +179,23 @@ static void firebirdReScanForeignScan(ForeignScanState *node);
 
 static void firebirdEndForeignScan(ForeignScanState *node);
 
+#ifdef HAVE_JOIN_PUSHDOWN
+static void firebirdGetForeignJoinPaths(PlannerInfo *root,
+										RelOptInfo *joinrel,
+										RelOptInfo *outerrel,
+										RelOptInfo *innerrel,
+										JoinType jointype,
+										JoinPathExtraData *extra);
+#endif
+
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+static void firebirdGetForeignUpperPaths(PlannerInfo *root,
+										 UpperRelationKind stage,
+										 RelOptInfo *input_rel,
+										 RelOptInfo *output_rel,
+										 void *extra);
+#endif
+
 static int	firebirdIsForeignRelUpdatable(Relation rel);
 
 
@@ -243,7 +279,6 @@ firebirdEndForeignInsert(EState *estate,
 /* Internal functions */
 
 static void exitHook(int code, Datum arg);
-static FirebirdFdwState *getFdwState(Oid foreigntableid);
 
 static FirebirdFdwModifyState *
 create_foreign_modify(EState *estate,
@@ -259,6 +294,40 @@ create_foreign_modify(EState *estate,
 
 static void firebirdEstimateCosts(PlannerInfo *root, RelOptInfo *baserel,  Oid foreigntableid);
 
+static int firebirdGetScanCacheTTL(ForeignScan *fsplan, EState *estate, List **relids);
+static void firebirdReleaseScanResult(FirebirdFdwScanState *fdw_state);
+static void firebirdInitScanDecoding(ForeignScanState *node, FirebirdFdwScanState *fdw_state);
+static bool firebirdEvalScanParams(ForeignScanState *node, FirebirdFdwScanState *fdw_state);
+static ForeignPath *firebirdCreateScanPath(PlannerInfo *root, RelOptInfo *baserel,
+										   double rows, Relids required_outer);
+static void firebirdAddParameterizedPaths(PlannerInfo *root, RelOptInfo *baserel,
+										  FirebirdFdwState *fdw_state);
+
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+static void firebirdAddForeignGroupingPaths(PlannerInfo *root,
+											RelOptInfo *input_rel,
+											RelOptInfo *grouped_rel,
+											GroupPathExtraData *extra,
+											bool partial);
+static bool firebirdGroupingIsSafe(PlannerInfo *root,
+								   RelOptInfo *grouped_rel,
+								   PathTarget *grouping_target,
+								   List *having_qual);
+static ForeignScan *firebirdGetForeignPushdownPlan(PlannerInfo *root,
+												   RelOptInfo *foreignrel,
+												   List *tlist,
+												   Plan *outer_plan);
+#endif
+
+#ifdef HAVE_JOIN_PUSHDOWN
+static bool firebirdJoinIsSafe(PlannerInfo *root,
+							   RelOptInfo *joinrel,
+							   JoinType jointype,
+							   RelOptInfo *outerrel,
+							   RelOptInfo *innerrel,
+							   JoinPathExtraData *extra);
+#endif
+
 static const char **convert_prep_stmt_params(FirebirdFdwModifyState *fmstate,
 											 ItemPointer tupleid,
 											 ItemPointer tupleid2,
@@ -275,6 +344,15 @@ create_tuple_from_result(FBresult *res,
 						   List *retrieved_attrs,
 						   MemoryContext temp_context);
 
+static FBresult *
+execute_foreign_modify(FirebirdFdwModifyState *fmstate,
+					   const char * const *p_values,
+					   const int *paramFormats,
+					   fbWaitEvent wait_event);
+
+static void
+release_foreign_modify(FirebirdFdwModifyState *fmstate);
+
 static void
 store_returning_result(FirebirdFdwModifyState *fmstate,
 					   TupleTableSlot *slot, FBresult *res);
@@ -331,6 +409,22 @@ firebird_fdw_close_connections(PG_FUNCTION_ARGS)
 }
 
 
+/**
+ * firebird_fdw_cache_invalidate()
+ *
+ * Remove cached results of queries on the specified foreign table,
+ * or all cached results if NULL is provided, and return the number
+ * of results removed.
+ */
+Datum
+firebird_fdw_cache_invalidate(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_ARGISNULL(0) ? InvalidOid : PG_GETARG_OID(0);
+
+	PG_RETURN_INT32(firebirdCacheInvalidate(relid));
+}
+
+
 /**
  * firebird_fdw_server_options()
  *
@@ -651,6 +745,20 @@ firebird_fdw_diag(PG_FUNCTION_ARGS)
 	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 	pfree(setting.data);
 
+	/* number of cached query results */
+	memset(values, 0, sizeof(values));
+	memset(nulls, 0, sizeof(nulls));
+
+	initStringInfo(&setting);
+	appendStringInfo(&setting,
+					 "%i", firebirdCachedResultsCount());
+
+	values[0] = CStringGetTextDatum("cached_result_count");
+	values[1] = CStringGetTextDatum(setting.data);
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	pfree(setting.data);
+
 	return (Datum) 0;
 }
 
@@ -802,6 +910,16 @@ firebird_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->ReScanForeignScan = firebirdReScanForeignScan;
 	fdwroutine->EndForeignScan = firebirdEndForeignScan;
 
+#ifdef HAVE_JOIN_PUSHDOWN
+	/* support for join pushdown */
+	fdwroutine->GetForeignJoinPaths = firebirdGetForeignJoinPaths;
+#endif
+
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+	/* support for aggregate pushdown */
+	fdwroutine->GetForeignUpperPaths = firebirdGetForeignUpperPaths;
+#endif
+
 	/* support for ANALYZE */
 	fdwroutine->AnalyzeForeignTable = firebirdAnalyzeForeignTable;
 
@@ -848,6 +966,10 @@ void
 _PG_init(void)
 {
 	on_proc_exit(&exitHook, PointerGetDatum(NULL));
+
+	firebirdStatInit();
+	firebirdCacheInit();
+	firebirdLogInit();
 }
 
 
@@ -919,6 +1041,7 @@ getFdwState(Oid foreigntableid)
 	/* Table-level options */
 	fdw_state->svr_query = NULL;
 	fdw_state->svr_table = NULL;
+	fdw_state->svr_procedure = NULL;
 	fdw_state->estimated_row_count = -1;
 	fdw_state->quote_identifier = false;
 #if (PG_VERSION_NUM >= 140000)
@@ -943,6 +1066,7 @@ getFdwState(Oid foreigntableid)
 	 */
 	table_options.query.opt.strptr = &fdw_state->svr_query;
 	table_options.table_name.opt.strptr = &fdw_state->svr_table;
+	table_options.procedure.opt.strptr = &fdw_state->svr_procedure;
 	table_options.estimated_row_count.opt.intptr = &fdw_state->estimated_row_count;
 	table_options.quote_identifier.opt.boolptr = &fdw_state->quote_identifier;
 #if (PG_VERSION_NUM >= 140000)
@@ -1073,6 +1197,24 @@ firebirdGetForeignRelSize(PlannerInfo *root,
 							 fdw_state->disable_pushdowns,
 							 fdw_state->firebird_version);
 
+	/*
+	 * For a stored procedure or a query with placeholders, identify the
+	 * parameter columns, whose values are provided by conditions.
+	 */
+	if (fdw_state->svr_procedure != NULL || fdw_state->svr_query != NULL)
+		identifyParameterArguments(root, baserel, fdw_state);
+
+	/*
+	 * The relation can be used as input for a join or aggregate pushdown
+	 * only if all of its conditions can be evaluated remotely. Stored
+	 * procedures and parameterized queries are never used, as their
+	 * parameter columns do not exist remotely.
+	 */
+	fdw_state->pushdown_safe = (fdw_state->disable_pushdowns == false &&
+								fdw_state->local_conds == NIL &&
+								fdw_state->svr_procedure == NULL &&
+								fdw_state->param_attrs == NULL);
+
 	/*
 	 * Identify which attributes will need to be retrieved from the remote
 	 * server.	These include all attrs needed for joins or final output, plus
@@ -1100,6 +1242,16 @@ firebirdGetForeignRelSize(PlannerInfo *root,
 		elog(DEBUG2, "estimated_row_count: %i", fdw_state->estimated_row_count);
 		baserel->rows = fdw_state->estimated_row_count;
 	}
+	/*
+	 * Executing a stored procedure merely to count its rows could be
+	 * expensive, or even have side-effects, so fall back to a fixed
+	 * estimate; the same applies to a query with placeholders, whose
+	 * values are only known when the scan is executed.
+	 */
+	else if (fdw_state->svr_procedure != NULL || fdw_state->param_attrs != NULL)
+	{
+		baserel->rows = FIREBIRD_PROCEDURE_DEFAULT_ROWS;
+	}
 	/*
 	 * do a brute-force SELECT COUNT(*); Firebird doesn't provide any other
 	 * way of estimating table size (see http://www.firebirdfaq.org/faq376/ )
@@ -1122,7 +1274,9 @@ firebirdGetForeignRelSize(PlannerInfo *root,
 		pfree(query.data);
 		elog(DEBUG1, "%s", fdw_state->query);
 
+		firebirdWaitStart(FB_WAIT_EXECUTE);
 		res = FQexec(fdw_state->conn, fdw_state->query);
+		firebirdWaitEnd();
 
 		if (FQresultStatus(res) != FBRES_TUPLES_OK)
 		{
@@ -1220,48 +1374,154 @@ firebirdGetForeignPaths(PlannerInfo *root,
 	/* Estimate costs */
 	firebirdEstimateCosts(root, baserel, foreigntableid);
 
-	/* Create a ForeignPath node and add it as only possible path */
+	/*
+	 * If the value of a parameter column referenced by a join condition
+	 * can only be provided by the join, the scan must be parameterized by
+	 * the other tables; otherwise create a single unparameterized path.
+	 */
+	if (fdw_state->param_outer_attrs != NULL)
+		firebirdAddParameterizedPaths(root, baserel, fdw_state);
+	else
+		add_path(baserel, (Path *) firebirdCreateScanPath(root, baserel,
+														  baserel->rows,
+														  NULL));
+}
+
+
+/**
+ * firebirdCreateScanPath()
+ *
+ * Create a ForeignPath node for a scan of "baserel", parameterized by
+ * the relations "required_outer", if not NULL.
+ */
+static ForeignPath *
+firebirdCreateScanPath(PlannerInfo *root, RelOptInfo *baserel,
+					   double rows, Relids required_outer)
+{
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *)baserel->fdw_private;
 
 #if (PG_VERSION_NUM >= 180000)
-	add_path(baserel, (Path *)
-			 create_foreignscan_path(root, baserel,
-									 NULL,		/* default pathtarget */
-									 baserel->rows,
-									 0,			/* disabled nodes */
-									 fdw_state->startup_cost,
-									 fdw_state->total_cost,
-									 NIL,		/* no pathkeys */
-									 NULL,		/* no outer rel either */
-									 NULL,		/* no extra plan */
-									 NIL,   /* no fdw_restrictinfo list */
-									 NIL));		/* no fdw_private data */
+	return create_foreignscan_path(root, baserel,
+								   NULL,		/* default pathtarget */
+								   rows,
+								   0,			/* disabled nodes */
+								   fdw_state->startup_cost,
+								   fdw_state->total_cost,
+								   NIL,		/* no pathkeys */
+								   required_outer,
+								   NULL,		/* no extra plan */
+								   NIL,   /* no fdw_restrictinfo list */
+								   NIL);		/* no fdw_private data */
 #elif (PG_VERSION_NUM >= 170000)
-	add_path(baserel, (Path *)
-			 create_foreignscan_path(root, baserel,
-									 NULL,		/* default pathtarget */
-									 baserel->rows,
-									 fdw_state->startup_cost,
-									 fdw_state->total_cost,
-									 NIL,		/* no pathkeys */
-									 NULL,		/* no outer rel either */
-									 NULL,		/* no extra plan */
-									 NIL,   /* no fdw_restrictinfo list */
-									 NIL));		/* no fdw_private data */
+	return create_foreignscan_path(root, baserel,
+								   NULL,		/* default pathtarget */
+								   rows,
+								   fdw_state->startup_cost,
+								   fdw_state->total_cost,
+								   NIL,		/* no pathkeys */
+								   required_outer,
+								   NULL,		/* no extra plan */
+								   NIL,   /* no fdw_restrictinfo list */
+								   NIL);		/* no fdw_private data */
 #else
-	add_path(baserel, (Path *)
-			 create_foreignscan_path(root, baserel,
-									 NULL,		/* default pathtarget */
-									 baserel->rows,
-									 fdw_state->startup_cost,
-									 fdw_state->total_cost,
-									 NIL,		/* no pathkeys */
-									 NULL,		/* no outer rel either */
-									 NULL,		/* no extra plan */
-									 NIL));		/* no fdw_private data */
+	return create_foreignscan_path(root, baserel,
+								   NULL,		/* default pathtarget */
+								   rows,
+								   fdw_state->startup_cost,
+								   fdw_state->total_cost,
+								   NIL,		/* no pathkeys */
+								   required_outer,
+								   NULL,		/* no extra plan */
+								   NIL);		/* no fdw_private data */
 #endif
 }
 
 
+/**
+ * firebirdAddParameterizedPaths()
+ *
+ * Add paths for a scan of a stored procedure or a query with placeholders
+ * parameterized by the relations whose columns provide parameter values
+ * in join conditions, e.g. for a nested loop calling the procedure or
+ * executing the query for each row of the other relation.
+ *
+ * A path is created for the relations referenced by each such join
+ * condition, and for all of them together, as parameters may be
+ * provided by different relations; paths which do not provide the
+ * values of all parameter columns in "param_outer_attrs" are ignored.
+ */
+static void
+firebirdAddParameterizedPaths(PlannerInfo *root, RelOptInfo *baserel,
+							  FirebirdFdwState *fdw_state)
+{
+	List	   *required_outers = NIL;
+	Relids		all_outer = NULL;
+	AttrNumber	attno = -1;
+	ListCell   *lc;
+
+	while ((attno = bms_next_member(fdw_state->param_outer_attrs, attno)) >= 0)
+	{
+		foreach (lc, getParameterJoinClauses(root, baserel, fdw_state, attno))
+		{
+			RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+			Relids		required_outer;
+
+			required_outer = bms_union(ri->clause_relids, baserel->lateral_relids);
+			required_outer = bms_del_member(required_outer, baserel->relid);
+
+			if (bms_is_empty(required_outer))
+				continue;
+
+			required_outers = lappend(required_outers, required_outer);
+			all_outer = bms_add_members(all_outer, required_outer);
+		}
+	}
+
+	if (!bms_is_empty(all_outer))
+		required_outers = lappend(required_outers, all_outer);
+
+	foreach (lc, required_outers)
+	{
+		Relids		required_outer = (Relids) lfirst(lc);
+		ParamPathInfo *param_info;
+		Bitmapset  *value_attrs = NULL;
+		ListCell   *lc_prev;
+		ListCell   *lc_clause;
+
+		/* Skip duplicates */
+		foreach (lc_prev, required_outers)
+		{
+			if (lc_prev == lc || bms_equal((Relids) lfirst(lc_prev), required_outer))
+				break;
+		}
+
+		if (lc_prev != lc)
+			continue;
+
+		param_info = get_baserel_parampathinfo(root, baserel, required_outer);
+
+		foreach (lc_clause, param_info->ppi_clauses)
+		{
+			AttrNumber	value_attno = getParameterValue(baserel, fdw_state,
+														(RestrictInfo *) lfirst(lc_clause),
+														NULL);
+
+			if (value_attno != InvalidAttrNumber)
+				value_attrs = bms_add_member(value_attrs, value_attno);
+		}
+
+		if (!bms_is_subset(fdw_state->param_outer_attrs, value_attrs))
+			continue;
+
+		elog(DEBUG2, "%s: adding parameterized path", __func__);
+
+		add_path(baserel, (Path *) firebirdCreateScanPath(root, baserel,
+														  param_info->ppi_rows,
+														  required_outer));
+	}
+}
+
+
 /**
  * firebirdGetForeignPlan()
  *
@@ -1307,14 +1567,38 @@ firebirdGetForeignPlan(PlannerInfo *root,
 	StringInfoData sql;
 	List	   *fdw_private;
 	List	   *local_exprs = NIL;
+	List	   *local_reasons = NIL;
 	List	   *remote_conds = NIL;
 	List	   *params_list = NIL;
 	List	   *retrieved_attrs;
+	Bitmapset  *attrs_used = fdw_state->attrs_used;
+	PlanRowMark *rowmark = NULL;
+	List	   *fdw_exprs = NIL;
+	List	   *param_conds = NIL;
+	List	   *param_attnos = NIL;
+	List	   *param_order = NIL;
 
 	bool db_key_used;
 
 	ListCell   *lc;
 	elog(DEBUG2, "entering function %s", __func__);
+
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+	if (IS_UPPER_REL(baserel) || IS_JOIN_REL(baserel))
+		return firebirdGetForeignPushdownPlan(root, baserel, tlist, outer_plan);
+#endif
+
+	/*
+	 * For a stored procedure or a query with placeholders, determine the
+	 * parameter values, which are evaluated by the executor.
+	 */
+	if (fdw_state->param_attrs != NULL)
+		fdw_exprs = identifyParameterValues(baserel, fdw_state,
+											scan_clauses,
+											&param_conds,
+											&param_attnos,
+											&param_order);
+
 	foreach (lc, scan_clauses)
 	{
 		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
@@ -1327,7 +1611,11 @@ firebirdGetForeignPlan(PlannerInfo *root,
 			continue;
 		}
 
-		if (list_member_ptr(fdw_state->remote_conds, rinfo))
+		if (list_member_ptr(param_conds, rinfo))
+		{
+			elog(DEBUG1, " - parameter value");
+		}
+		else if (list_member_ptr(fdw_state->remote_conds, rinfo))
 		{
 			elog(DEBUG1, " - remote");
 			remote_conds = lappend(remote_conds, rinfo);
@@ -1338,43 +1626,88 @@ firebirdGetForeignPlan(PlannerInfo *root,
 		{
 			elog(DEBUG1, " - local");
 			local_exprs = lappend(local_exprs, rinfo->clause);
+			local_reasons = lappend(local_reasons,
+									makeString(getLocalConditionReason(root,
+																	   baserel,
+																	   fdw_state,
+																	   rinfo->clause)));
 		}
 		else
 		{
-			Assert(isFirebirdExpr(root, baserel, rinfo->clause, fdw_state->firebird_version));
-			elog(DEBUG1, " - remote, but not a member of fdw_state->remote_conds");
-			remote_conds = lappend(remote_conds, rinfo);
+			/*
+			 * A join condition of a parameterized scan, which references
+			 * other relations and must be evaluated locally.
+			 */
+			elog(DEBUG1, " - join condition, local");
+			local_exprs = lappend(local_exprs, rinfo->clause);
+			local_reasons = lappend(local_reasons,
+									makeString(getLocalConditionReason(root,
+																	   baserel,
+																	   fdw_state,
+																	   rinfo->clause)));
 		}
 	}
 
+	/*
+	 * SELECT ... FOR UPDATE/SHARE: lock the remote rows with "WITH LOCK",
+	 * which Firebird supports only for a single table. RDB$DB_KEY is
+	 * retrieved so each row identifies the locked Firebird row. Rows of
+	 * a query or procedure result can't be locked.
+	 */
+	rowmark = get_plan_rowmark(root->rowMarks, baserel->relid);
+
+	if (rowmark != NULL && rowmark->strength != LCS_NONE)
+	{
+		if (fdw_state->svr_procedure != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("unable to lock rows of a foreign table defined as a procedure")));
+
+		if (fdw_state->svr_query != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("unable to lock rows of a foreign table defined as a query")));
+
+		attrs_used = bms_add_member(bms_copy(attrs_used),
+									SelfItemPointerAttributeNumber - FirstLowInvalidHeapAttributeNumber);
+	}
+	else
+		rowmark = NULL;
+
 	rte = planner_rt_fetch(baserel->relid, root);
 	/* Build query */
 	initStringInfo(&sql);
-	buildSelectSql(&sql, rte, fdw_state, baserel, fdw_state->attrs_used,
+	buildSelectSql(&sql, rte, fdw_state, baserel, attrs_used,
 				   &retrieved_attrs, &db_key_used);
 
 	if (remote_conds)
 		buildWhereClause(&sql, root, baserel, remote_conds, true, &params_list);
 
+	if (rowmark != NULL)
+		buildLockingClause(&sql, rowmark, fdw_state->firebird_version);
+
 	elog(DEBUG2, "db_key_used? %c", db_key_used == true ? 'Y' : 'N');
 
 	/*
 	 * Build the fdw_private list which will be available to the executor.
 	 * Items in the list must match enum FdwScanPrivateIndex, above.
 	 */
-	fdw_private = list_make3(makeString(sql.data),
+	fdw_private = list_make4(makeString(sql.data),
 							 retrieved_attrs,
 #if (PG_VERSION_NUM >= 150000)
-							 makeBoolean(db_key_used));
+							 makeBoolean(db_key_used),
 #else
-							 makeInteger(db_key_used));
+							 makeInteger(db_key_used),
 #endif
+							 local_reasons);
+	fdw_private = lappend(fdw_private, param_attnos);
+	fdw_private = lappend(fdw_private, param_order);
 
 /* Create the ForeignScan node */
 	return make_foreignscan(tlist,
 							local_exprs,
 							scan_relid,
-							NIL,	/* no expressions to evaluate */
+							fdw_exprs,
 							fdw_private,
 							NIL,	/* no custom tlist */
 							NIL,	/* no remote quals */
@@ -1382,6 +1715,68 @@ firebirdGetForeignPlan(PlannerInfo *root,
 }
 
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+/**
+ * firebirdGetForeignPushdownPlan()
+ *
+ * Create a ForeignScan plan node for a pushed-down join or aggregation.
+ *
+ * For an aggregation, the scan tuple is described by the target list
+ * generated by firebirdGroupingIsSafe(); for a join, it consists of the
+ * columns required from the joined relations.
+ */
+static ForeignScan *
+firebirdGetForeignPushdownPlan(PlannerInfo *root,
+							   RelOptInfo *foreignrel,
+							   List *tlist,
+							   Plan *outer_plan)
+{
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *) foreignrel->fdw_private;
+	List	   *fdw_scan_tlist;
+	List	   *fdw_private;
+	List	   *retrieved_attrs;
+	StringInfoData sql;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (IS_UPPER_REL(foreignrel))
+		fdw_scan_tlist = fdw_state->grouped_tlist;
+	else
+		fdw_scan_tlist = add_to_flat_tlist(NIL,
+										   pull_var_clause((Node *) foreignrel->reltarget->exprs,
+														   PVC_RECURSE_PLACEHOLDERS));
+
+	initStringInfo(&sql);
+	buildSelectSqlForRel(&sql, root, foreignrel, fdw_scan_tlist,
+						 &retrieved_attrs);
+
+	/*
+	 * Build the fdw_private list which will be available to the executor.
+	 * Items in the list must match enum FdwScanPrivateIndex, above.
+	 */
+	fdw_private = list_make4(makeString(sql.data),
+							 retrieved_attrs,
+#if (PG_VERSION_NUM >= 150000)
+							 makeBoolean(false),
+#else
+							 makeInteger(false),
+#endif
+							 NIL);
+	fdw_private = lappend(fdw_private, NIL);
+	fdw_private = lappend(fdw_private, NIL);
+
+	return make_foreignscan(tlist,
+							NIL,	/* all conditions evaluated remotely */
+							0,		/* no base relation */
+							NIL,	/* no expressions to evaluate */
+							fdw_private,
+							fdw_scan_tlist,
+							NIL,	/* no remote quals */
+							outer_plan);
+}
+#endif
+
+
 /**
  * firebirdExplainForeignScan()
  *
@@ -1413,7 +1808,24 @@ firebirdExplainForeignScan(ForeignScanState *node,
 		}
 		else
 			ExplainPropertyText("Firebird plan", "no plan available", es);
+
+		/* Show why any conditions are evaluated locally */
+		if (fdw_state->local_conds > 0)
+		{
+			ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+			List	   *reasons = NIL;
+			ListCell   *lc;
+
+			foreach (lc, (List *) list_nth(fsplan->fdw_private,
+										   FdwScanPrivateLocalReasons))
+				reasons = lappend(reasons, strVal(lfirst(lc)));
+
+			ExplainPropertyList("Local filter reason", reasons, es);
+		}
 	}
+
+	if (es->analyze && fdw_state->instr != NULL)
+		firebirdInstrExplain(fdw_state->instr, es);
 }
 
 
@@ -1451,7 +1863,7 @@ firebirdBeginForeignScan(ForeignScanState *node,
 
 	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
 	FirebirdFdwScanState *fdw_state;
-	Oid		 foreigntableid = RelationGetRelid(node->ss.ss_currentRelation);
+	Oid		 foreigntableid;
 
 	Relation rel;
 	TupleDesc tupdesc;
@@ -1459,6 +1871,7 @@ firebirdBeginForeignScan(ForeignScanState *node,
 
 	EState	   *estate = node->ss.ps.state;
 	RangeTblEntry *rte;
+	int			rtindex;
 	Oid			userid;
 	ForeignTable *table;
 	ForeignServer *server;
@@ -1466,17 +1879,34 @@ firebirdBeginForeignScan(ForeignScanState *node,
 
 	ListCell *lc;
 	fbTableOptions table_options = fbTableOptions_init;
+	fbServerOptions server_options = fbServerOptions_init;
+	bool		trusted_encoding = false;
 
 	elog(DEBUG2, "entering function %s", __func__);
 
-	rte = rt_fetch(fsplan->scan.scanrelid, estate->es_range_table);
+	/*
+	 * For a pushed-down join or aggregation, scanrelid is zero; use the
+	 * first relation in the underlying scan to identify the server and
+	 * user mapping.
+	 */
+	if (fsplan->scan.scanrelid > 0)
+		rtindex = fsplan->scan.scanrelid;
+	else
+#if (PG_VERSION_NUM >= 160000)
+		rtindex = bms_next_member(fsplan->fs_base_relids, -1);
+#else
+		rtindex = bms_next_member(fsplan->fs_relids, -1);
+#endif
+
+	rte = rt_fetch(rtindex, estate->es_range_table);
 #if (PG_VERSION_NUM >= 160000)
 	userid = OidIsValid(fsplan->checkAsUser) ? fsplan->checkAsUser : GetUserId();
 #else
 	userid = OidIsValid(rte->checkAsUser) ? rte->checkAsUser : GetUserId();
 #endif
 
-	table = GetForeignTable(RelationGetRelid(node->ss.ss_currentRelation));
+	foreigntableid = rte->relid;
+	table = GetForeignTable(foreigntableid);
 	server = GetForeignServer(table->serverid);
 	user = GetUserMapping(userid, server->serverid);
 
@@ -1486,14 +1916,69 @@ firebirdBeginForeignScan(ForeignScanState *node,
 
 	firebirdGetTableOptions(table, &table_options);
 
+	server_options.trusted_encoding.opt.boolptr = &trusted_encoding;
+	firebirdGetServerOptions(server, &server_options);
+
 	/* Initialise FDW state */
 	fdw_state = (FirebirdFdwScanState *) palloc0(sizeof(FirebirdFdwScanState));
 	node->fdw_state = (void *) fdw_state;
 
 	fdw_state->conn = firebirdInstantiateConnection(server, user);
+	fdw_state->trusted_encoding = trusted_encoding;
 
 	fdw_state->row = 0;
 	fdw_state->result = NULL;
+	fdw_state->instr = firebirdInstrCreate(&node->ss.ps, fdw_state->conn);
+
+	/* Determine whether the result can be cached */
+	fdw_state->serverid = server->serverid;
+	fdw_state->userid = user->userid;
+	fdw_state->cache_ref = NULL;
+	fdw_state->cached_result = NULL;
+	fdw_state->cache_ttl = firebirdGetScanCacheTTL(fsplan, estate, &fdw_state->relids);
+
+	/*
+	 * Within a read-only query, scans issuing identical remote queries
+	 * can share a single result.
+	 */
+	if (estate->es_plannedstmt->commandType == CMD_SELECT &&
+		estate->es_plannedstmt->rowMarks == NIL)
+		fdw_state->share_estate = estate;
+	else
+		fdw_state->share_estate = NULL;
+
+	/*
+	 * EXEC_FLAG_REWIND indicates the scan may be rescanned without any
+	 * parameter changes, e.g. as the inner side of an unparameterized nested
+	 * loop; fetched rows can then be retained and replayed, see
+	 * firebirdIterateForeignScan().
+	 */
+	fdw_state->rewind = (eflags & EXEC_FLAG_REWIND) && !(eflags & EXEC_FLAG_EXPLAIN_ONLY);
+	fdw_state->tuplestore = NULL;
+	fdw_state->replay_slot = NULL;
+	fdw_state->fetched_all = false;
+
+	fdw_state->query = strVal(list_nth(fsplan->fdw_private,
+									   FdwScanPrivateSelectSql));
+
+	fdw_state->retrieved_attrs = (List *) list_nth(fsplan->fdw_private,
+												   FdwScanPrivateRetrievedAttrs);
+
+	fdw_state->local_conds = list_length((List *) list_nth(fsplan->fdw_private,
+														   FdwScanPrivateLocalReasons));
+
+	/*
+	 * For a pushed-down join or aggregation, the result columns map
+	 * directly to the scan tuple, so no table information is needed.
+	 */
+	if (fsplan->scan.scanrelid == 0)
+	{
+		fdw_state->table = NULL;
+		fdw_state->db_key_used = false;
+
+		elog(DEBUG2, "leaving function %s", __func__);
+		return;
+	}
 
 	/* Get information about table */
 
@@ -1543,7 +2028,7 @@ firebirdBeginForeignScan(ForeignScanState *node,
 
 	/* Construct query */
 
-	if (svr_query)
+	if (svr_table == NULL)
 	{
 		fdw_state->db_key_used = false;
 	}
@@ -1558,11 +2043,56 @@ firebirdBeginForeignScan(ForeignScanState *node,
 #endif
 	}
 
-	fdw_state->query = strVal(list_nth(fsplan->fdw_private,
-									   FdwScanPrivateSelectSql));
+	/* Rows fetched for modification must never come from the cache */
+	if (fdw_state->db_key_used)
+	{
+		fdw_state->cache_ttl = 0;
+		fdw_state->share_estate = NULL;
+	}
 
-	fdw_state->retrieved_attrs = (List *) list_nth(fsplan->fdw_private,
-												   FdwScanPrivateRetrievedAttrs);
+	/*
+	 * Prepare the evaluation of the values of stored procedure arguments
+	 * or query placeholders. As the remote query's text does not include
+	 * the values, its result can't be cached or shared with other scans.
+	 */
+	if (fsplan->fdw_exprs != NIL)
+	{
+		int			natts = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor->natts;
+
+#if (PG_VERSION_NUM >= 100000)
+		fdw_state->param_exprs = ExecInitExprList(fsplan->fdw_exprs,
+												  (PlanState *) node);
+#else
+		fdw_state->param_exprs = (List *) ExecInitExpr((Expr *) fsplan->fdw_exprs,
+													   (PlanState *) node);
+#endif
+		fdw_state->param_flinfo = (FmgrInfo *) palloc0(sizeof(FmgrInfo) *
+														list_length(fsplan->fdw_exprs));
+
+		i = 0;
+		foreach (lc, fsplan->fdw_exprs)
+		{
+			Oid			typoutput;
+			bool		typisvarlena;
+
+			getTypeOutputInfo(exprType((Node *) lfirst(lc)),
+							  &typoutput, &typisvarlena);
+			fmgr_info(typoutput, &fdw_state->param_flinfo[i++]);
+		}
+
+		fdw_state->param_attnos = (List *) list_nth(fsplan->fdw_private,
+													FdwScanPrivateParamAttnos);
+		fdw_state->param_order = (List *) list_nth(fsplan->fdw_private,
+												   FdwScanPrivateParamOrder);
+		fdw_state->num_params = list_length(fdw_state->param_order);
+		fdw_state->column_values = (char **) palloc0(sizeof(char *) * natts);
+		fdw_state->param_cxt = AllocSetContextCreate(estate->es_query_cxt,
+													 "firebird_fdw parameter values",
+													 ALLOCSET_SMALL_SIZES);
+
+		fdw_state->cache_ttl = 0;
+		fdw_state->share_estate = NULL;
+	}
 
 	/* Mark columns used in the query */
 	foreach (lc, fdw_state->retrieved_attrs)
@@ -1610,17 +2140,12 @@ firebirdIterateForeignScan(ForeignScanState *node)
 {
 	FirebirdFdwScanState *fdw_state = (FirebirdFdwScanState *) node->fdw_state;
 	TupleTableSlot	 *slot = node->ss.ss_ScanTupleSlot;
+	fbInstrumentation *instr = fdw_state->instr;
+	instr_time		  convert_start_time;
 
-	char			**values;
 	HeapTuple		  tuple;
-	AttInMetadata	 *attinmeta;
-	TupleDesc		  tupledesc;
 
 	int row_total	= 0;
-	int field_nr	= 0;
-	int pg_field_nr = 0;
-	int pg_column_total = 0;
-	int field_total = 0;
 	int last_field = 0;
 
 	uint32_t key_ctid_part = 0;
@@ -1628,90 +2153,187 @@ firebirdIterateForeignScan(ForeignScanState *node)
 
 	elog(DEBUG2, "entering function %s", __func__);
 
-	/* execute query, if this is the first run */
-	if (!fdw_state->result)
+	/*
+	 * Set up retention of fetched rows, if the scan may be rescanned. This
+	 * is not possible if RDB$DB_KEY is retrieved, as it is stored in
+	 * the tuple header, which the tuplestore does not preserve.
+	 */
+	if (fdw_state->rewind == true && fdw_state->db_key_used == false &&
+		fdw_state->tuplestore == NULL && fdw_state->row == 0)
 	{
-		elog(DEBUG1, "remote query:\n%s", fdw_state->query);
+		MemoryContext oldcontext = MemoryContextSwitchTo(node->ss.ps.state->es_query_cxt);
 
-		fdw_state->result = FQexec(fdw_state->conn, fdw_state->query);
-
-		elog(DEBUG1, "query result: %s", FQresStatus(FQresultStatus(fdw_state->result)));
-
-		if (FQresultStatus(fdw_state->result) != FBRES_TUPLES_OK)
-		{
-			fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR,
-							   fdw_state->result,
-							   fdw_state->conn,
-							   fdw_state->query);
-		}
+		fdw_state->tuplestore = tuplestore_begin_heap(false, false, work_mem);
+#if (PG_VERSION_NUM >= 120000)
+		fdw_state->replay_slot = MakeSingleTupleTableSlot(slot->tts_tupleDescriptor,
+														  &TTSOpsMinimalTuple);
+#else
+		fdw_state->replay_slot = MakeSingleTupleTableSlot(slot->tts_tupleDescriptor);
+#endif
+		MemoryContextSwitchTo(oldcontext);
 	}
 
-	row_total = FQntuples(fdw_state->result);
-
-	ExecClearTuple(slot);
-
-	/* The FDW API requires that we return NULL if no more rows are available */
-	if (fdw_state->row == row_total)
+	/* Replay any rows retained from a previous scan */
+	if (fdw_state->tuplestore != NULL && !tuplestore_ateof(fdw_state->tuplestore))
 	{
-		elog(DEBUG2, "%s: no more rows available (%i fetched)", __func__, row_total);
-		return NULL;
-	}
-
-	tupledesc = node->ss.ss_currentRelation->rd_att;
-	elog(DEBUG2, "tuple has %i atts", tupledesc->natts);
+		if (tuplestore_gettupleslot(fdw_state->tuplestore, true, false,
+									fdw_state->replay_slot))
+			return ExecCopySlot(slot, fdw_state->replay_slot);
 
-	/* include/funcapi.h */
-	attinmeta = TupleDescGetAttInMetadata(tupledesc);
-
-	last_field = field_total = FQnfields(fdw_state->result);
+		/* All retained rows replayed; continue with any not yet fetched */
+	}
 
-	if (fdw_state->db_key_used == true)
-		field_total--;
+	if (fdw_state->fetched_all == true)
+		return ExecClearTuple(slot);
 
-	pg_column_total = fdw_state->table->pg_column_total;
+	if (instr != NULL && !fdw_state->result && fdw_state->row == 0)
+		INSTR_TIME_SET_CURRENT(instr->start_time);
 
-	/* Build the tuple */
-	values = (char **) palloc0(sizeof(char *) * pg_column_total);
-	elog(DEBUG2, " pg_column_total %i", pg_column_total);
+	/* The reference to cached and shared results is reused for each rescan */
+	if (fdw_state->cache_ref == NULL &&
+		(fdw_state->cache_ttl > 0 || fdw_state->share_estate != NULL))
+		fdw_state->cache_ref = firebirdCacheRefCreate(node->ss.ps.state);
 
-	for (pg_field_nr = field_nr = 0; pg_field_nr < pg_column_total; pg_field_nr++)
+	/* use a cached result, if available */
+	if (!fdw_state->result && fdw_state->cache_ttl > 0)
 	{
-		/* Ignore dropped columns */
-		if (fdw_state->table->columns[pg_field_nr]->isdropped == true)
+		if (firebirdCacheLookup(fdw_state->cache_ref,
+								fdw_state->serverid,
+								fdw_state->userid,
+								fdw_state->query))
 		{
-			values[pg_field_nr] = NULL;
-			continue;
+			fdw_state->cached_result = fdw_state->cache_ref;
+			fdw_state->result = firebirdCacheGetResult(fdw_state->cached_result);
 		}
+	}
 
-		/* Ignore columns not used in the query */
-		if (fdw_state->table->columns[pg_field_nr]->used == false)
+	/* use the result of an identical scan in the same query, if available */
+	if (!fdw_state->result && fdw_state->cache_ttl == 0 && fdw_state->share_estate != NULL)
+	{
+		if (firebirdSharedResultLookup(fdw_state->cache_ref,
+									   fdw_state->share_estate,
+									   fdw_state->conn,
+									   fdw_state->query))
 		{
-			elog(DEBUG2, " pg_column %i not used", pg_field_nr);
-			values[pg_field_nr] = NULL;
-			continue;
+			fdw_state->cached_result = fdw_state->cache_ref;
+			fdw_state->result = firebirdCacheGetResult(fdw_state->cached_result);
 		}
+	}
+
+	/* execute query, if this is the first run */
+	if (!fdw_state->result)
+	{
+		instr_time	start_time;
+		instr_time	stat_start_time;
 
-		/* All result columns retrieved */
-		if (field_nr >= field_total)
+		/*
+		 * Evaluate any parameter values; as the condition providing a value
+		 * can't be satisfied by NULL, there are no rows in that case.
+		 */
+		if (fdw_state->param_exprs != NIL &&
+			firebirdEvalScanParams(node, fdw_state) == false)
 		{
-			values[pg_field_nr] = NULL;
-			continue;
+			elog(DEBUG2, "%s: parameter value is NULL", __func__);
+			fdw_state->fetched_all = true;
+			return ExecClearTuple(slot);
 		}
 
-		if (FQgetisnull(fdw_state->result, fdw_state->row, field_nr))
+		elog(DEBUG1, "remote query:\n%s", fdw_state->query);
+
+		if (instr != NULL)
+			firebirdInstrStartRemote(instr, &start_time);
+
+		firebirdStatStart(&stat_start_time);
+
+		FIREBIRD_FDW_STATEMENT_START(fdw_state->query);
+
+		firebirdWaitStart(FB_WAIT_EXECUTE);
+
+		if (fdw_state->num_params > 0)
+			fdw_state->result = FQexecParams(fdw_state->conn,
+											 fdw_state->query,
+											 fdw_state->num_params,
+											 NULL,
+											 fdw_state->param_values,
+											 NULL,
+											 NULL,
+											 0);
+		else
+			fdw_state->result = FQexec(fdw_state->conn, fdw_state->query);
+
+		firebirdWaitEnd();
+
+		firebirdConnectionNoteStatement(fdw_state->conn, strlen(fdw_state->query), fdw_state->result);
+
+		/* libfq fetches all result rows before returning */
+		if (instr != NULL)
+			firebirdInstrEndRemote(instr, &start_time);
+
+		elog(DEBUG1, "query result: %s", FQresStatus(FQresultStatus(fdw_state->result)));
+
+		if (FQresultStatus(fdw_state->result) != FBRES_TUPLES_OK)
 		{
-			elog(DEBUG2, " retrieved value (%i): NULL", pg_field_nr);
-			values[pg_field_nr] = NULL;
+			fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR,
+							   fdw_state->result,
+							   fdw_state->conn,
+							   fdw_state->query);
 		}
-		else
+
+		FIREBIRD_FDW_STATEMENT_DONE(fdw_state->query, FQntuples(fdw_state->result));
+
+		firebirdStatEnd(fdw_state->serverid, fdw_state->query, fdw_state->local_conds,
+						&stat_start_time, fdw_state->result);
+		firebirdLogRemoteStatement(fdw_state->conn, fdw_state->query,
+								   fdw_state->num_params, fdw_state->param_values,
+								   &stat_start_time, fdw_state->result);
+
+		if (fdw_state->cache_ttl > 0)
+		{
+			if (firebirdCacheStore(fdw_state->cache_ref,
+								   fdw_state->serverid,
+								   fdw_state->userid,
+								   fdw_state->query,
+								   fdw_state->relids,
+								   fdw_state->cache_ttl,
+								   fdw_state->result))
+				fdw_state->cached_result = fdw_state->cache_ref;
+		}
+		else if (fdw_state->share_estate != NULL)
+		{
+			firebirdSharedResultStore(fdw_state->cache_ref,
+									  fdw_state->share_estate,
+									  fdw_state->conn,
+									  fdw_state->query,
+									  fdw_state->result);
+			fdw_state->cached_result = fdw_state->cache_ref;
+		}
+	}
+
+	row_total = FQntuples(fdw_state->result);
+
+	ExecClearTuple(slot);
+
+	/* The FDW API requires that we return NULL if no more rows are available */
+	if (fdw_state->row == row_total)
+	{
+		elog(DEBUG2, "%s: no more rows available (%i fetched)", __func__, row_total);
+
+		/* All rows are retained, so the remote result is no longer needed */
+		if (fdw_state->tuplestore != NULL)
 		{
-			values[pg_field_nr] = FQgetvalue(fdw_state->result, fdw_state->row, field_nr);
-			elog(DEBUG2, " retrieved value (%i): %s", pg_field_nr, values[pg_field_nr]);
+			fdw_state->fetched_all = true;
+			firebirdReleaseScanResult(fdw_state);
 		}
 
-		field_nr++;
+		return NULL;
 	}
 
+	/* Set up decoding of the result into tuples, if not already done */
+	if (fdw_state->decode_block == NULL)
+		firebirdInitScanDecoding(node, fdw_state);
+
+	last_field = FQnfields(fdw_state->result);
+
 	if (fdw_state->db_key_used)
 	{
 		/* Final field contains the RDB$DB_KEY value - split into two
@@ -1724,11 +2346,35 @@ firebirdIterateForeignScan(ForeignScanState *node)
 
 	}
 
-	tuple = BuildTupleFromCStrings(
-		attinmeta,
-		values);
+	if (instr != NULL)
+		INSTR_TIME_SET_CURRENT(convert_start_time);
+	else
+		INSTR_TIME_SET_ZERO(convert_start_time);
 
-	pfree(values);
+	FIREBIRD_FDW_TUPLE_CONVERT_START(fdw_state->row);
+
+	tuple = firebirdDecodeBlockGetTuple(fdw_state->decode_block,
+										fdw_state->result,
+										fdw_state->row);
+
+	FIREBIRD_FDW_TUPLE_CONVERT_DONE(fdw_state->row);
+
+	if (instr != NULL)
+	{
+		instr_time	end_time;
+
+		INSTR_TIME_SET_CURRENT(end_time);
+		INSTR_TIME_ACCUM_DIFF(instr->conversion_time, end_time, convert_start_time);
+
+		firebirdInstrCountRow(instr, fdw_state->result, fdw_state->row);
+
+		if (instr->have_first_row == false)
+		{
+			instr->first_row_time = end_time;
+			INSTR_TIME_SUBTRACT(instr->first_row_time, instr->start_time);
+			instr->have_first_row = true;
+		}
+	}
 
 	if (fdw_state->db_key_used)
 	{
@@ -1746,90 +2392,869 @@ firebirdIterateForeignScan(ForeignScanState *node)
 #endif
 	fdw_state->row++;
 
-	elog(DEBUG2, "leaving function %s", __func__);
+	if (fdw_state->tuplestore != NULL)
+	{
+		tuplestore_puttupleslot(fdw_state->tuplestore, slot);
+
+		/*
+		 * If the rows no longer fit in work_mem, stop retaining them;
+		 * rescans will then execute the remote query again.
+		 */
+		if (!tuplestore_in_memory(fdw_state->tuplestore))
+		{
+			elog(DEBUG2, "%s: row retention exceeds work_mem", __func__);
+
+			tuplestore_end(fdw_state->tuplestore);
+			fdw_state->tuplestore = NULL;
+			fdw_state->rewind = false;
+		}
+	}
+
+	elog(DEBUG2, "leaving function %s", __func__);
+
+	return slot;
+}
+
+
+/**
+ * convertDbKeyValue()
+ *
+ * Split the 8-byte RDB$DB_KEY value into two unsigned 32 bit integers
+ *
+ * Trivial note: from a Firebird point of view it would be more logical
+ * to pass the first four bytes of the RDB$DB_KEY value as the XMAX, and
+ * the last four bytes as the CTID, as RDB$DB_KEY appears to be
+ * formatted as a table / row identifier, but that's a purely academic
+ * point.
+ */
+
+void
+convertDbKeyValue(char *p, uint32_t *key_ctid_part, uint32_t *key_xmax_part)
+{
+	unsigned char *t;
+	uint64_t db_key = 0;
+
+	for (t = (unsigned char *) p;  t < (unsigned char *) p + 8; t++)
+	{
+		db_key += (uint8_t)*t;
+
+		if (t < (unsigned char *) p + 7)
+			db_key = db_key << 8;
+	}
+
+	*key_ctid_part = (uint32_t) (db_key >> 32);
+	*key_xmax_part = (uint32_t) db_key;
+}
+
+
+/**
+ * firebirdInitScanDecoding()
+ *
+ * Determine which result field provides the value of each column of the
+ * scan tuple, and set up decoding of the result with that mapping; as
+ * the remote query is the same for each execution of the scan, this
+ * only needs to be done once.
+ */
+static void
+firebirdInitScanDecoding(ForeignScanState *node, FirebirdFdwScanState *fdw_state)
+{
+	TupleDesc	tupledesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+	MemoryContext oldcontext = MemoryContextSwitchTo(node->ss.ps.state->es_query_cxt);
+	int		   *field_map = (int *) palloc(sizeof(int) * tupledesc->natts);
+	int			field_total = FQnfields(fdw_state->result);
+	int			field_nr = 0;
+	int			pg_field_nr;
+
+	elog(DEBUG2, "tuple has %i atts", tupledesc->natts);
+
+	if (fdw_state->db_key_used == true)
+		field_total--;
+
+	for (pg_field_nr = 0; pg_field_nr < tupledesc->natts; pg_field_nr++)
+	{
+		/*
+		 * For a pushed-down join or aggregation there is no table information;
+		 * each result column corresponds to the respective scan tuple column.
+		 */
+		if (fdw_state->table == NULL)
+		{
+			field_map[pg_field_nr] = (pg_field_nr < field_total) ? pg_field_nr : -1;
+			continue;
+		}
+
+		/* Ignore dropped columns, columns not used in the query, and any
+		 * columns remaining after all result columns are retrieved */
+		if (pg_field_nr >= fdw_state->table->pg_column_total ||
+			fdw_state->table->columns[pg_field_nr]->isdropped == true ||
+			fdw_state->table->columns[pg_field_nr]->used == false ||
+			field_nr >= field_total)
+		{
+			field_map[pg_field_nr] = -1;
+			continue;
+		}
+
+		field_map[pg_field_nr] = field_nr++;
+	}
+
+	fdw_state->decode_block = firebirdDecodeBlockCreate(tupledesc,
+														field_map,
+														fdw_state->column_values,
+														fdw_state->trusted_encoding);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+
+/**
+ * firebirdEvalScanParams()
+ *
+ * Evaluate the values of the scan's stored procedure arguments or query
+ * placeholders, converting them to text both for binding to the remote
+ * query's parameters and for returning as the values of the parameter
+ * columns. The values last until they are next evaluated. Returns false
+ * if any value is NULL.
+ */
+static bool
+firebirdEvalScanParams(ForeignScanState *node, FirebirdFdwScanState *fdw_state)
+{
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	MemoryContext oldcontext;
+	char	  **values;
+	ListCell   *lc;
+	ListCell   *lc_attno;
+	int			i = 0;
+
+	MemoryContextReset(fdw_state->param_cxt);
+	oldcontext = MemoryContextSwitchTo(fdw_state->param_cxt);
+
+	values = (char **) palloc(sizeof(char *) * list_length(fdw_state->param_exprs));
+
+	forboth (lc, fdw_state->param_exprs, lc_attno, fdw_state->param_attnos)
+	{
+		ExprState  *expr_state = (ExprState *) lfirst(lc);
+		Datum		value;
+		bool		isnull;
+
+#if (PG_VERSION_NUM >= 100000)
+		value = ExecEvalExpr(expr_state, econtext, &isnull);
+#else
+		value = ExecEvalExpr(expr_state, econtext, &isnull, NULL);
+#endif
+
+		if (isnull)
+		{
+			MemoryContextSwitchTo(oldcontext);
+			return false;
+		}
+
+		values[i] = OutputFunctionCall(&fdw_state->param_flinfo[i], value);
+		fdw_state->column_values[lfirst_int(lc_attno) - 1] = values[i];
+		i++;
+	}
+
+	fdw_state->param_values = (const char **) palloc(sizeof(char *) *
+													 (fdw_state->num_params + 1));
+	i = 0;
+	foreach (lc, fdw_state->param_order)
+		fdw_state->param_values[i++] = values[lfirst_int(lc)];
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return true;
+}
+
+
+/**
+ * firebirdReScanForeignScan()
+ *
+ * Restart the scan from the beginning. Note that any parameters the scan
+ * depends on may have changed value, so the new scan does not necessarily
+ * return exactly the same rows.
+ */
+static void
+firebirdReScanForeignScan(ForeignScanState *node)
+{
+	FirebirdFdwScanState *fdw_state = (FirebirdFdwScanState *) node->fdw_state;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	/*
+	 * If no parameters have changed, the query would return the same rows;
+	 * replay those already fetched, then continue with the remaining rows
+	 * of the current result, if any.
+	 */
+	if (fdw_state->tuplestore != NULL)
+	{
+		if (node->ss.ps.chgParam == NULL)
+		{
+			elog(DEBUG2, "%s: replaying retained rows", __func__);
+			tuplestore_rescan(fdw_state->tuplestore);
+			return;
+		}
+
+		tuplestore_clear(fdw_state->tuplestore);
+	}
+
+	fdw_state->fetched_all = false;
+
+	/* Clean up current query */
+	firebirdReleaseScanResult(fdw_state);
+
+	/* Begin new query */
+	fdw_state->row = 0;
+}
+
+
+/**
+ * firebirdEndForeignScan()
+ *
+ * End the scan and release external resources
+ */
+static void
+firebirdEndForeignScan(ForeignScanState *node)
+{
+	FirebirdFdwScanState *fdw_state = (FirebirdFdwScanState *) node->fdw_state;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	firebirdReleaseScanResult(fdw_state);
+
+	if (fdw_state->tuplestore != NULL)
+	{
+		tuplestore_end(fdw_state->tuplestore);
+		fdw_state->tuplestore = NULL;
+	}
+
+	if (fdw_state->replay_slot != NULL)
+		ExecDropSingleTupleTableSlot(fdw_state->replay_slot);
+
+	elog(DEBUG2, "leaving function %s", __func__);
+}
+
+
+/**
+ * firebirdReleaseScanResult()
+ *
+ * Release the scan's remote query result, which is either owned by the
+ * scan, referenced from the result cache, or shared with identical scans
+ * in the same query.
+ */
+static void
+firebirdReleaseScanResult(FirebirdFdwScanState *fdw_state)
+{
+	if (fdw_state->cached_result != NULL)
+	{
+		firebirdCacheRelease(fdw_state->cached_result);
+		fdw_state->cached_result = NULL;
+	}
+	else if (fdw_state->result)
+	{
+		FQclear(fdw_state->result);
+	}
+
+	fdw_state->result = NULL;
+
+	if (fdw_state->decode_block != NULL)
+		firebirdDecodeBlockReset(fdw_state->decode_block);
+}
+
+
+/**
+ * firebirdGetScanCacheTTL()
+ *
+ * Return the number of seconds for which the scan's result may be cached,
+ * i.e. the lowest "cache_ttl" value of the foreign tables scanned, and
+ * store the OIDs of those tables in "relids". Zero is returned if any
+ * table does not have "cache_ttl" set.
+ */
+static int
+firebirdGetScanCacheTTL(ForeignScan *fsplan, EState *estate, List **relids)
+{
+	Bitmapset  *scan_relids;
+	int			rtindex = -1;
+	int			ttl = -1;
+
+	*relids = NIL;
+
+	if (fsplan->scan.scanrelid > 0)
+		scan_relids = bms_make_singleton(fsplan->scan.scanrelid);
+	else
+#if (PG_VERSION_NUM >= 160000)
+		scan_relids = fsplan->fs_base_relids;
+#else
+		scan_relids = fsplan->fs_relids;
+#endif
+
+	while ((rtindex = bms_next_member(scan_relids, rtindex)) >= 0)
+	{
+		RangeTblEntry *rte = rt_fetch(rtindex, estate->es_range_table);
+		fbTableOptions table_options = fbTableOptions_init;
+		int			table_ttl = 0;
+
+		table_options.cache_ttl.opt.intptr = &table_ttl;
+
+		firebirdGetTableOptions(GetForeignTable(rte->relid), &table_options);
+
+		if (ttl == -1 || table_ttl < ttl)
+			ttl = table_ttl;
+
+		*relids = lappend_oid(*relids, rte->relid);
+	}
+
+	return Max(ttl, 0);
+}
+
+
+#ifdef HAVE_JOIN_PUSHDOWN
+/**
+ * firebirdGetForeignJoinPaths()
+ *
+ * Add a path for performing the join between "outerrel" and "innerrel"
+ * in Firebird, if possible.
+ *
+ * This is also called for each pair of matching partitions when
+ * enable_partitionwise_join is set, so joins between partitions
+ * which are foreign tables on the same Firebird server are executed
+ * by Firebird.
+ */
+static void
+firebirdGetForeignJoinPaths(PlannerInfo *root,
+							RelOptInfo *joinrel,
+							RelOptInfo *outerrel,
+							RelOptInfo *innerrel,
+							JoinType jointype,
+							JoinPathExtraData *extra)
+{
+	FirebirdFdwState *fdw_state;
+	FirebirdFdwState *outer_state;
+	FirebirdFdwState *inner_state;
+	ForeignPath *joinpath;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	/* Join relation already processed */
+	if (joinrel->fdw_private != NULL)
+		return;
+
+	/*
+	 * Row locking, and UPDATE/DELETE operations, require each row to be
+	 * identified individually by RDB$DB_KEY, which is not possible
+	 * for a pushed-down join.
+	 */
+	if (root->parse->commandType != CMD_SELECT || root->rowMarks != NIL)
+		return;
+
+	/*
+	 * Create an empty state, so that a join which cannot be pushed down
+	 * is not considered again, nor used as input for an aggregate pushdown.
+	 */
+	fdw_state = (FirebirdFdwState *) palloc0(sizeof(FirebirdFdwState));
+	fdw_state->pushdown_safe = false;
+	joinrel->fdw_private = (void *) fdw_state;
+
+	if (!firebirdJoinIsSafe(root, joinrel, jointype, outerrel, innerrel, extra))
+		return;
+
+	fdw_state->pushdown_safe = true;
+
+	/*
+	 * The join is executed in a single query, and Firebird needs to read
+	 * the rows of both input relations, but only the joined rows need to
+	 * be transferred, which is what firebirdEstimateCosts() considers to
+	 * be the dominant cost.
+	 */
+	outer_state = (FirebirdFdwState *) outerrel->fdw_private;
+	inner_state = (FirebirdFdwState *) innerrel->fdw_private;
+
+	fdw_state->startup_cost = Max(outer_state->startup_cost, inner_state->startup_cost);
+	fdw_state->total_cost = fdw_state->startup_cost
+		+ (outerrel->rows + innerrel->rows) * cpu_tuple_cost
+		+ joinrel->rows;
+
+#if (PG_VERSION_NUM >= 180000)
+	joinpath = create_foreign_join_path(root,
+										joinrel,
+										NULL,		/* default pathtarget */
+										joinrel->rows,
+										0,			/* disabled nodes */
+										fdw_state->startup_cost,
+										fdw_state->total_cost,
+										NIL,		/* no pathkeys */
+										NULL,		/* no outer rel either */
+										NULL,		/* no extra plan */
+										NIL,		/* no fdw_restrictinfo list */
+										NIL);		/* no fdw_private data */
+#elif (PG_VERSION_NUM >= 170000)
+	joinpath = create_foreign_join_path(root,
+										joinrel,
+										NULL,		/* default pathtarget */
+										joinrel->rows,
+										fdw_state->startup_cost,
+										fdw_state->total_cost,
+										NIL,		/* no pathkeys */
+										NULL,		/* no outer rel either */
+										NULL,		/* no extra plan */
+										NIL,		/* no fdw_restrictinfo list */
+										NIL);		/* no fdw_private data */
+#elif (PG_VERSION_NUM >= 120000)
+	joinpath = create_foreign_join_path(root,
+										joinrel,
+										NULL,		/* default pathtarget */
+										joinrel->rows,
+										fdw_state->startup_cost,
+										fdw_state->total_cost,
+										NIL,		/* no pathkeys */
+										NULL,		/* no outer rel either */
+										NULL,		/* no extra plan */
+										NIL);		/* no fdw_private data */
+#else
+	joinpath = create_foreignscan_path(root,
+									   joinrel,
+									   NULL,		/* default pathtarget */
+									   joinrel->rows,
+									   fdw_state->startup_cost,
+									   fdw_state->total_cost,
+									   NIL,		/* no pathkeys */
+									   NULL,		/* no outer rel either */
+									   NULL,		/* no extra plan */
+									   NIL);		/* no fdw_private data */
+#endif
+
+	add_path(joinrel, (Path *) joinpath);
+}
+
+
+/**
+ * firebirdJoinIsSafe()
+ *
+ * Determine whether the join represented by "joinrel" can be performed
+ * by Firebird; if so, the join's conditions are sorted into those which
+ * belong in the ON clause ("joinclauses"), and those which are applied
+ * to the join result ("remote_conds").
+ *
+ * Conditions on the input relations are pulled up into the join, except
+ * that conditions on the nullable side of an outer join must be applied
+ * in its ON clause. As no local evaluation is possible, all conditions
+ * must be evaluable by Firebird.
+ *
+ * Adapted from postgres_fdw
+ */
+static bool
+firebirdJoinIsSafe(PlannerInfo *root,
+				   RelOptInfo *joinrel,
+				   JoinType jointype,
+				   RelOptInfo *outerrel,
+				   RelOptInfo *innerrel,
+				   JoinPathExtraData *extra)
+{
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *) joinrel->fdw_private;
+	FirebirdFdwState *outer_state = (FirebirdFdwState *) outerrel->fdw_private;
+	FirebirdFdwState *inner_state = (FirebirdFdwState *) innerrel->fdw_private;
+	Relids		relids;
+	List	   *vars;
+	ListCell   *lc;
+
+	/* Semi and anti joins are not supported */
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_RIGHT && jointype != JOIN_FULL)
+		return false;
+
+	/* Both input relations must be suitable for pushdown */
+	if (outer_state == NULL || outer_state->pushdown_safe == false ||
+		inner_state == NULL || inner_state->pushdown_safe == false)
+		return false;
+
+	fdw_state->outerrel = outerrel;
+	fdw_state->innerrel = innerrel;
+	fdw_state->jointype = jointype;
+	fdw_state->conn = outer_state->conn;
+	fdw_state->firebird_version = outer_state->firebird_version;
+	fdw_state->disable_pushdowns = false;
+	fdw_state->implicit_bool_type = outer_state->implicit_bool_type;
+	fdw_state->quote_identifier = outer_state->quote_identifier;
+
+	foreach (lc, extra->restrictlist)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		if (ri->pseudoconstant)
+			return false;
+
+		if (!isFirebirdExpr(root, joinrel, ri->clause, fdw_state->firebird_version))
+			return false;
+
+		if (jointype == JOIN_INNER || !RINFO_IS_PUSHED_DOWN(ri, joinrel->relids))
+			fdw_state->joinclauses = lappend(fdw_state->joinclauses, ri);
+		else
+			fdw_state->remote_conds = lappend(fdw_state->remote_conds, ri);
+	}
+
+	/*
+	 * A placeholder evaluated at this join would need to be computed
+	 * locally; see postgres_fdw's foreign_join_ok() for details.
+	 */
+	relids = IS_OTHER_REL(joinrel) ? joinrel->top_parent_relids : joinrel->relids;
+
+	foreach (lc, root->placeholder_list)
+	{
+		PlaceHolderInfo *phinfo = (PlaceHolderInfo *) lfirst(lc);
+
+		if (bms_is_subset(phinfo->ph_eval_at, relids) &&
+			bms_nonempty_difference(relids, phinfo->ph_eval_at))
+			return false;
+	}
+
+	/*
+	 * The columns to be retrieved must be plain columns; an implicit
+	 * boolean column would be converted to an expression which Firebird
+	 * 2.5 does not accept in the select list.
+	 */
+	vars = pull_var_clause((Node *) joinrel->reltarget->exprs,
+						   PVC_INCLUDE_PLACEHOLDERS);
+
+	foreach (lc, vars)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var))
+			return false;
+
+		if (!isFirebirdExpr(root, joinrel, (Expr *) var, fdw_state->firebird_version))
+			return false;
+
+		if (var->vartype == BOOLOID && fdw_state->implicit_bool_type == true)
+			return false;
+	}
+
+	/* Pull up the conditions of the input relations */
+	switch (jointype)
+	{
+		case JOIN_INNER:
+			fdw_state->remote_conds = list_concat(fdw_state->remote_conds,
+												  list_copy(outer_state->remote_conds));
+			fdw_state->remote_conds = list_concat(fdw_state->remote_conds,
+												  list_copy(inner_state->remote_conds));
+			break;
+
+		case JOIN_LEFT:
+			fdw_state->joinclauses = list_concat(fdw_state->joinclauses,
+												 list_copy(inner_state->remote_conds));
+			fdw_state->remote_conds = list_concat(fdw_state->remote_conds,
+												  list_copy(outer_state->remote_conds));
+			break;
+
+		case JOIN_RIGHT:
+			fdw_state->joinclauses = list_concat(fdw_state->joinclauses,
+												 list_copy(outer_state->remote_conds));
+			fdw_state->remote_conds = list_concat(fdw_state->remote_conds,
+												  list_copy(inner_state->remote_conds));
+			break;
+
+		case JOIN_FULL:
+			/* Conditions on either side cannot be pulled up */
+			if (outer_state->remote_conds != NIL || inner_state->remote_conds != NIL)
+				return false;
+			break;
 
-	return slot;
+		default:
+			/* should never reach here */
+			return false;
+	}
+
+	return true;
 }
+#endif
 
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
 /**
- * convertDbKeyValue()
+ * firebirdGetForeignUpperPaths()
  *
- * Split the 8-byte RDB$DB_KEY value into two unsigned 32 bit integers
+ * Create possible paths for post-scan processing which can be performed
+ * by Firebird.
  *
- * Trivial note: from a Firebird point of view it would be more logical
- * to pass the first four bytes of the RDB$DB_KEY value as the XMAX, and
- * the last four bytes as the CTID, as RDB$DB_KEY appears to be
- * formatted as a table / row identifier, but that's a purely academic
- * point.
+ * Currently only aggregation is supported, either as a full aggregation
+ * (UPPERREL_GROUP_AGG), or as the partial aggregation step
+ * (UPPERREL_PARTIAL_GROUP_AGG) used by partitionwise aggregation when
+ * the grouping does not match the partition key. In the latter case
+ * Firebird calculates the transition state of each aggregate for its
+ * partition, and PostgreSQL combines and finalizes the results.
  */
-
-void
-convertDbKeyValue(char *p, uint32_t *key_ctid_part, uint32_t *key_xmax_part)
+static void
+firebirdGetForeignUpperPaths(PlannerInfo *root,
+							 UpperRelationKind stage,
+							 RelOptInfo *input_rel,
+							 RelOptInfo *output_rel,
+							 void *extra)
 {
-	unsigned char *t;
-	uint64_t db_key = 0;
+	FirebirdFdwState *input_state = (FirebirdFdwState *) input_rel->fdw_private;
+	FirebirdFdwState *fdw_state;
 
-	for (t = (unsigned char *) p;  t < (unsigned char *) p + 8; t++)
-	{
-		db_key += (uint8_t)*t;
+	elog(DEBUG2, "entering function %s", __func__);
 
-		if (t < (unsigned char *) p + 7)
-			db_key = db_key << 8;
-	}
+	if (stage != UPPERREL_GROUP_AGG && stage != UPPERREL_PARTIAL_GROUP_AGG)
+		return;
 
-	*key_ctid_part = (uint32_t) (db_key >> 32);
-	*key_xmax_part = (uint32_t) db_key;
+	/* Input relation must be suitable for pushdown */
+	if (input_state == NULL || input_state->pushdown_safe == false)
+		return;
+
+	/* Relation already processed */
+	if (output_rel->fdw_private != NULL)
+		return;
+
+	fdw_state = (FirebirdFdwState *) palloc0(sizeof(FirebirdFdwState));
+	fdw_state->pushdown_safe = false;
+	output_rel->fdw_private = (void *) fdw_state;
+
+	firebirdAddForeignGroupingPaths(root,
+									input_rel,
+									output_rel,
+									(GroupPathExtraData *) extra,
+									stage == UPPERREL_PARTIAL_GROUP_AGG);
 }
 
 
 /**
- * firebirdReScanForeignScan()
+ * firebirdAddForeignGroupingPaths()
  *
- * Restart the scan from the beginning. Note that any parameters the scan
- * depends on may have changed value, so the new scan does not necessarily
- * return exactly the same rows.
+ * Add a path for performing the aggregation represented by "grouped_rel"
+ * in Firebird, if possible.
  */
 static void
-firebirdReScanForeignScan(ForeignScanState *node)
+firebirdAddForeignGroupingPaths(PlannerInfo *root,
+								RelOptInfo *input_rel,
+								RelOptInfo *grouped_rel,
+								GroupPathExtraData *extra,
+								bool partial)
 {
-	FirebirdFdwScanState *fdw_state = (FirebirdFdwScanState *) node->fdw_state;
+	Query	   *parse = root->parse;
+	FirebirdFdwState *input_state = (FirebirdFdwState *) input_rel->fdw_private;
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *) grouped_rel->fdw_private;
+	ForeignPath *grouppath;
+	double		num_groups;
+	Cost		startup_cost;
+	Cost		total_cost;
 
 	elog(DEBUG2, "entering function %s", __func__);
 
-	/* Clean up current query */
+	/* Nothing to be done if there is no grouping or aggregation */
+	if (!parse->groupClause && !parse->groupingSets && !parse->hasAggs &&
+		!root->hasHavingQual)
+		return;
+
+	fdw_state->outerrel = input_rel;
+	fdw_state->conn = input_state->conn;
+	fdw_state->firebird_version = input_state->firebird_version;
+	fdw_state->disable_pushdowns = input_state->disable_pushdowns;
+	fdw_state->implicit_bool_type = input_state->implicit_bool_type;
+	fdw_state->quote_identifier = input_state->quote_identifier;
+
+	/*
+	 * HAVING conditions are only applied after the final aggregation
+	 * step, so must be ignored for partial aggregation.
+	 */
+	if (!firebirdGroupingIsSafe(root,
+								grouped_rel,
+								grouped_rel->reltarget,
+								partial ? NIL : (List *) extra->havingQual))
+		return;
 
-	if (fdw_state->result)
+	fdw_state->pushdown_safe = true;
+
+	/* Estimate the number of groups */
+	if (parse->groupClause)
 	{
-		FQclear(fdw_state->result);
-		fdw_state->result = NULL;
+		List	   *group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+														  fdw_state->grouped_tlist);
+
+#if (PG_VERSION_NUM >= 140000)
+		num_groups = estimate_num_groups(root, group_exprs, input_rel->rows,
+										 NULL, NULL);
+#else
+		num_groups = estimate_num_groups(root, group_exprs, input_rel->rows,
+										 NULL);
+#endif
 	}
+	else
+		num_groups = 1;
 
-	/* Begin new query */
-	fdw_state->row = 0;
+	/*
+	 * Firebird still needs to read all input rows, but only the aggregated
+	 * rows need to be transferred, which is what firebirdEstimateCosts()
+	 * considers to be the dominant cost.
+	 */
+	startup_cost = input_state->startup_cost + input_rel->rows * cpu_tuple_cost;
+	total_cost = startup_cost + num_groups;
+
+	fdw_state->startup_cost = startup_cost;
+	fdw_state->total_cost = total_cost;
+
+#if (PG_VERSION_NUM >= 180000)
+	grouppath = create_foreign_upper_path(root,
+										  grouped_rel,
+										  grouped_rel->reltarget,
+										  num_groups,
+										  0,		/* disabled nodes */
+										  startup_cost,
+										  total_cost,
+										  NIL,		/* no pathkeys */
+										  NULL,		/* no extra plan */
+										  NIL,		/* no fdw_restrictinfo list */
+										  NIL);		/* no fdw_private data */
+#elif (PG_VERSION_NUM >= 170000)
+	grouppath = create_foreign_upper_path(root,
+										  grouped_rel,
+										  grouped_rel->reltarget,
+										  num_groups,
+										  startup_cost,
+										  total_cost,
+										  NIL,		/* no pathkeys */
+										  NULL,		/* no extra plan */
+										  NIL,		/* no fdw_restrictinfo list */
+										  NIL);		/* no fdw_private data */
+#elif (PG_VERSION_NUM >= 120000)
+	grouppath = create_foreign_upper_path(root,
+										  grouped_rel,
+										  grouped_rel->reltarget,
+										  num_groups,
+										  startup_cost,
+										  total_cost,
+										  NIL,		/* no pathkeys */
+										  NULL,		/* no extra plan */
+										  NIL);		/* no fdw_private data */
+#else
+	grouppath = create_foreignscan_path(root,
+										grouped_rel,
+										grouped_rel->reltarget,
+										num_groups,
+										startup_cost,
+										total_cost,
+										NIL,		/* no pathkeys */
+										NULL,		/* no outer rel either */
+										NULL,		/* no extra plan */
+										NIL);		/* no fdw_private data */
+#endif
+
+	add_path(grouped_rel, (Path *) grouppath);
 }
 
 
 /**
- * firebirdEndForeignScan()
+ * firebirdGroupingIsSafe()
  *
- * End the scan and release external resources
+ * Determine whether the aggregation represented by "grouped_rel" can be
+ * performed by Firebird; if so, the target list to be retrieved is stored
+ * in the relation's "grouped_tlist", and any HAVING conditions in
+ * "having_conds".
+ *
+ * Adapted from postgres_fdw
  */
-static void
-firebirdEndForeignScan(ForeignScanState *node)
+static bool
+firebirdGroupingIsSafe(PlannerInfo *root,
+					   RelOptInfo *grouped_rel,
+					   PathTarget *grouping_target,
+					   List *having_qual)
 {
-	FirebirdFdwScanState *fdw_state = (FirebirdFdwScanState *) node->fdw_state;
+	Query	   *query = root->parse;
+	FirebirdFdwState *fdw_state = (FirebirdFdwState *) grouped_rel->fdw_private;
+	FirebirdFdwState *input_state = (FirebirdFdwState *) fdw_state->outerrel->fdw_private;
+	List	   *tlist = NIL;
+	ListCell   *lc;
+	int			i;
 
-	elog(DEBUG2, "entering function %s", __func__);
+	/* Grouping sets are not supported by Firebird */
+	if (query->groupingSets)
+		return false;
 
-	if (fdw_state->result)
+	i = 0;
+	foreach (lc, grouping_target->exprs)
 	{
-		FQclear(fdw_state->result);
-		fdw_state->result = NULL;
+		Expr	   *expr = (Expr *) lfirst(lc);
+		Index		sgref = get_pathtarget_sortgroupref(grouping_target, i);
+
+		i++;
+
+		if (sgref && get_sortgroupref_clause_noerr(sgref, query->groupClause))
+		{
+			TargetEntry *tle;
+			List	   *vars;
+			ListCell   *vlc;
+
+			/*
+			 * Firebird treats an integer literal in GROUP BY as a column
+			 * position, so grouping by a constant can't be expressed.
+			 */
+			if (IsA(strip_implicit_coercions((Node *) expr), Const))
+				return false;
+
+			/* Grouping expression must be evaluable by Firebird */
+			if (!isFirebirdExpr(root, grouped_rel, expr, fdw_state->firebird_version))
+				return false;
+
+			/*
+			 * An implicit boolean column would be converted to an expression,
+			 * which is not something we can group by.
+			 */
+			if (input_state->implicit_bool_type == true)
+			{
+				vars = pull_var_clause((Node *) expr, 0);
+
+				foreach (vlc, vars)
+				{
+					if (((Var *) lfirst(vlc))->vartype == BOOLOID)
+						return false;
+				}
+			}
+
+			tle = makeTargetEntry(expr, list_length(tlist) + 1, NULL, false);
+			tle->ressortgroupref = sgref;
+			tlist = lappend(tlist, tle);
+		}
+		else if (isFirebirdExpr(root, grouped_rel, expr, fdw_state->firebird_version))
+		{
+			tlist = add_to_flat_tlist(tlist, list_make1(expr));
+		}
+		else
+		{
+			/*
+			 * The expression as a whole can't be evaluated remotely, but
+			 * any aggregates it contains may be; the expression itself
+			 * will then be evaluated locally.
+			 */
+			List	   *aggvars = pull_var_clause((Node *) expr,
+												  PVC_INCLUDE_AGGREGATES);
+			ListCell   *alc;
+
+			foreach (alc, aggvars)
+			{
+				Expr	   *aggvar = (Expr *) lfirst(alc);
+
+				if (!isFirebirdExpr(root, grouped_rel, aggvar, fdw_state->firebird_version))
+					return false;
+
+				if (IsA(aggvar, Aggref))
+					tlist = add_to_flat_tlist(tlist, list_make1(aggvar));
+			}
+		}
 	}
 
-	elog(DEBUG2, "leaving function %s", __func__);
+	/* All HAVING conditions must be evaluable by Firebird */
+	foreach (lc, having_qual)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (!isFirebirdExpr(root, grouped_rel, expr, fdw_state->firebird_version))
+			return false;
+
+		fdw_state->having_conds = lappend(fdw_state->having_conds, expr);
+	}
+
+	fdw_state->grouped_tlist = tlist;
+
+	return true;
 }
+#endif
 
 
 /**
@@ -1840,6 +3265,22 @@ firebirdEndForeignScan(ForeignScanState *node)
  */
 static int
 firebirdIsForeignRelUpdatable(Relation rel)
+{
+	elog(DEBUG2, "entering function %s", __func__);
+
+	return firebirdIsTableUpdatable(RelationGetRelid(rel)) ?
+		(1 << CMD_INSERT) | (1 << CMD_UPDATE) | (1 << CMD_DELETE) : 0;
+}
+
+
+/**
+ * firebirdIsTableUpdatable()
+ *
+ * Determine whether the foreign table is updatable, based on the
+ * "updatable" option of the table or, if not set, of its server.
+ */
+bool
+firebirdIsTableUpdatable(Oid foreigntableid)
 {
 	ForeignServer *server;
 	ForeignTable  *table;
@@ -1849,7 +3290,7 @@ firebirdIsForeignRelUpdatable(Relation rel)
 
 	elog(DEBUG2, "entering function %s", __func__);
 
-	table = GetForeignTable(RelationGetRelid(rel));
+	table = GetForeignTable(foreigntableid);
 	server = GetForeignServer(table->serverid);
 
 	/* Get server setting, if available */
@@ -1870,8 +3311,7 @@ firebirdIsForeignRelUpdatable(Relation rel)
 
 	elog(DEBUG2, "exiting function %s", __func__);
 
-	return updatable ?
-		(1 << CMD_INSERT) | (1 << CMD_UPDATE) | (1 << CMD_DELETE) : 0;
+	return updatable;
 }
 
 
@@ -2064,6 +3504,11 @@ firebirdPlanForeignModify(PlannerInfo *root,
 	relid = RelationGetRelid(rel);
 	fdw_state = getFdwState(relid);
 
+	if (fdw_state->svr_procedure != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("unable to modify a foreign table defined as a procedure")));
+
 	if (fdw_state->svr_table == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
@@ -2242,6 +3687,10 @@ create_foreign_modify(EState *estate,
 	user = GetUserMapping(userid, server->serverid);
 
 	fmstate->conn = firebirdInstantiateConnection(server, user);
+	fmstate->serverid = server->serverid;
+
+	/* Cached results of queries on this table will no longer be valid */
+	firebirdCacheNoteModification(RelationGetRelid(rel));
 
 	if (FQstatus(fmstate->conn) != CONNECTION_OK)
 		ereport(ERROR,
@@ -2458,6 +3907,7 @@ firebirdBeginForeignModify(ModifyTableState *mtstate,
 	/* Deconstruct fdw_private data. */
 	/* this is the list returned by firebirdPlanForeignModify() */
 
+	fmstate->instr = firebirdInstrCreate(&mtstate->ps, fmstate->conn);
 
 	resultRelInfo->ri_FdwState = fmstate;
 }
@@ -2531,44 +3981,17 @@ firebirdExecForeignInsert(EState *estate,
 	}
 #endif
 
-	result = FQexecParams(fmstate->conn,
-						  fmstate->query,
-						  fmstate->p_nums,
-						  NULL,
-						  p_values,
-						  NULL,
-						  NULL,
-						  0);
+	result = execute_foreign_modify(fmstate, p_values, NULL, FB_WAIT_EXECUTE);
 
 	elog(DEBUG2, " result status: %s", FQresStatus(FQresultStatus(result)));
 	elog(DEBUG1, " returned rows: %i", FQntuples(result));
 
-	switch(FQresultStatus(result))
-	{
-		case FBRES_EMPTY_QUERY:
-		case FBRES_BAD_RESPONSE:
-		case FBRES_NONFATAL_ERROR:
-		case FBRES_FATAL_ERROR:
-			fbfdw_report_error(ERROR,
-							   ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION,
-							   result,
-							   fmstate->conn,
-							   fmstate->query);
-			/* fbfdw_report_error() will never return here, but break anyway */
-			break;
-		default:
-			elog(DEBUG1, "Query OK");
-	}
-
 	if (fmstate->has_returning)
 	{
 		if (FQntuples(result) > 0)
 			store_returning_result(fmstate, slot, result);
 	}
 
-	if (result)
-		FQclear(result);
-
 	MemoryContextReset(fmstate->temp_cxt);
 
 	return slot;
@@ -2598,10 +4021,10 @@ firebirdExecForeignBatchInsert(EState *estate,
 	fmstate = (FirebirdFdwModifyState *) resultRelInfo->ri_FdwState;
 	elog(DEBUG1, "Executing: %s", fmstate->query);
 
-	result = FQprepare(fmstate->conn,
-					   fmstate->query,
-					   fmstate->p_nums,
-					   NULL);
+	if (fmstate->instr != NULL)
+		fmstate->instr->batches++;
+
+	FIREBIRD_FDW_BATCH_FLUSH_START(fmstate->query, *numSlots);
 
 	for (i = 0; i < *numSlots; i++)
 	{
@@ -2612,20 +4035,13 @@ firebirdExecForeignBatchInsert(EState *estate,
 											NULL,
 											slots[i]);
 
-		result = FQexecPrepared(fmstate->conn,
-								result,
-								fmstate->p_nums,
-								p_values,
-								NULL,
-								NULL,
-								0);
+		result = execute_foreign_modify(fmstate, p_values, NULL, FB_WAIT_BATCH_FLUSH);
 
 		elog(DEBUG2, " result status: %s", FQresStatus(FQresultStatus(result)));
 		elog(DEBUG1, " returned rows: %i", FQntuples(result));
 	}
 
-	FQdeallocatePrepared(fmstate->conn, result);
-	FQclear(result);
+	FIREBIRD_FDW_BATCH_FLUSH_DONE(fmstate->query, *numSlots);
 
 	return slots;
 }
@@ -2731,43 +4147,16 @@ firebirdExecForeignUpdate(EState *estate,
 
 	elog(DEBUG1, "Executing:\n%s; p_nums: %i", fmstate->query, fmstate->p_nums);
 
-	result = FQexecParams(fmstate->conn,
-						  fmstate->query,
-						  fmstate->p_nums,
-						  NULL,
-						  p_values,
-						  NULL,
-						  paramFormats,
-						  0);
+	result = execute_foreign_modify(fmstate, p_values, paramFormats, FB_WAIT_EXECUTE);
 
 	elog(DEBUG1, "Result status: %s", FQresStatus(FQresultStatus(result)));
 
-	switch(FQresultStatus(result))
-	{
-		case FBRES_EMPTY_QUERY:
-		case FBRES_BAD_RESPONSE:
-		case FBRES_NONFATAL_ERROR:
-		case FBRES_FATAL_ERROR:
-			fbfdw_report_error(ERROR,
-							   ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION,
-							   result,
-							   fmstate->conn,
-							   fmstate->query);
-			/* fbfdw_report_error() will never return here, but break anyway */
-			break;
-		default:
-			elog(DEBUG1, "Query OK");
-	}
-
 	if (fmstate->has_returning)
 	{
 		if (FQntuples(result) > 0)
 			store_returning_result(fmstate, slot, result);
 	}
 
-	if (result)
-		FQclear(result);
-
 	MemoryContextReset(fmstate->temp_cxt);
 
 	return slot;
@@ -2840,43 +4229,17 @@ firebirdExecForeignDelete(EState *estate,
 
 	elog(DEBUG1, "Executing: %s", fmstate->query);
 
-	result = FQexecParams(fmstate->conn,
-						  fmstate->query,
-						  fmstate->p_nums,
-						  NULL,
-						  p_values,
-						  NULL,
-						  paramFormats,
-						  0);
+	result = execute_foreign_modify(fmstate, p_values, paramFormats, FB_WAIT_EXECUTE);
 
 	elog(DEBUG2, " result status: %s", FQresStatus(FQresultStatus(result)));
 	elog(DEBUG1, " returned rows: %i", FQntuples(result));
 
-	switch(FQresultStatus(result))
+	if (fmstate->has_returning)
 	{
-		case FBRES_EMPTY_QUERY:
-		case FBRES_BAD_RESPONSE:
-		case FBRES_NONFATAL_ERROR:
-		case FBRES_FATAL_ERROR:
-			fbfdw_report_error(ERROR,
-							   ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION,
-							   result,
-							   fmstate->conn,
-							   fmstate->query);
-			/* fbfdw_report_error() will never return here, but break anyway */
-			break;
-		default:
-			elog(DEBUG2, "Query OK");
-			if (fmstate->has_returning)
-			{
-				if (FQntuples(result) > 0)
-					store_returning_result(fmstate, slot, result);
-			}
+		if (FQntuples(result) > 0)
+			store_returning_result(fmstate, slot, result);
 	}
 
-	if (result)
-		FQclear(result);
-
 	MemoryContextReset(fmstate->temp_cxt);
 
 	return slot;
@@ -2901,6 +4264,8 @@ firebirdEndForeignModify(EState *estate,
 
 	if (fm_state == NULL)
 		return;
+
+	release_foreign_modify(fm_state);
 }
 
 
@@ -2943,6 +4308,14 @@ firebirdExplainForeignModify(ModifyTableState *mtstate,
 			ExplainPropertyInteger("Batch Size", NULL, resultRelInfo->ri_BatchSize, es);
 	}
 #endif
+
+	if (es->analyze && resultRelInfo->ri_FdwState != NULL)
+	{
+		FirebirdFdwModifyState *fmstate = (FirebirdFdwModifyState *) resultRelInfo->ri_FdwState;
+
+		if (fmstate->instr != NULL)
+			firebirdInstrExplain(fmstate->instr, es);
+	}
 }
 
 #if (PG_VERSION_NUM >= 140000)
@@ -3014,6 +4387,7 @@ static void firebirdExecForeignTruncate(List *rels,
 
 		bool truncatable = true;
 		bool updatable = true;
+		char *svr_procedure = NULL;
 
 		char **p_values = (char **) palloc0(sizeof(char *));
 		FBresult   *res = NULL;
@@ -3048,6 +4422,7 @@ static void firebirdExecForeignTruncate(List *rels,
 			&server_options);
 
 		table_options.query.opt.strptr = &fdw_state->svr_query;
+		table_options.procedure.opt.strptr = &svr_procedure;
 		table_options.quote_identifier.opt.boolptr =  &fdw_state->quote_identifier;
 		table_options.truncatable.opt.boolptr = &truncatable;
 		table_options.updatable.opt.boolptr = &updatable;
@@ -3056,6 +4431,10 @@ static void firebirdExecForeignTruncate(List *rels,
 			table,
 			&table_options);
 
+		/* Foreign tables defined as procedures are never updatable */
+		if (svr_procedure != NULL)
+			updatable = false;
+
 		/*
 		 * Check the server/table options allow the table to be truncated.
 		 * Foreign tables defined as queries are automatically considered as
@@ -3143,6 +4522,9 @@ static void firebirdExecForeignTruncate(List *rels,
 
 		FBresult   *res = NULL;
 		StringInfoData delete_query;
+		instr_time	stat_start_time;
+
+		firebirdCacheNoteModification(relid);
 
 		initStringInfo(&delete_query);
 
@@ -3152,9 +4534,13 @@ static void firebirdExecForeignTruncate(List *rels,
 		elog(DEBUG3, "truncate query is: %s", delete_query.data);
 
 
+		firebirdStatStart(&stat_start_time);
+
+		firebirdWaitStart(FB_WAIT_EXECUTE);
 		res = FQexec(conn, delete_query.data);
+		firebirdWaitEnd();
 
-		pfree(delete_query.data);
+		firebirdConnectionNoteStatement(conn, strlen(delete_query.data), res);
 
 		if (FQresultStatus(res) != FBRES_COMMAND_OK)
 		{
@@ -3179,6 +4565,11 @@ static void firebirdExecForeignTruncate(List *rels,
 					 errdetail("%s", detail.data)));
 		}
 
+		firebirdStatEnd(server->serverid, delete_query.data, 0, &stat_start_time, res);
+		firebirdLogRemoteStatement(conn, delete_query.data, 0, NULL, &stat_start_time, res);
+
+		pfree(delete_query.data);
+
 		FQclear(res);
 	}
 
@@ -3343,6 +4734,8 @@ firebirdBeginForeignInsert(ModifyTableState *mtstate,
 									retrieved_attrs != NIL,
 									retrieved_attrs);
 
+	fmstate->instr = firebirdInstrCreate(&mtstate->ps, fmstate->conn);
+
 	resultRelInfo->ri_FdwState = fmstate;
 }
 
@@ -3352,6 +4745,8 @@ firebirdEndForeignInsert(EState *estate,
 {
 	FirebirdFdwModifyState *fm_state = (FirebirdFdwModifyState *)resultRelInfo->ri_FdwState;
 
+	release_foreign_modify(fm_state);
+
 	MemoryContextDelete(fm_state->temp_cxt);
 }
 
@@ -3431,6 +4826,7 @@ fbAcquireSampleRowsFunc(Relation relation, int elevel,
 	ForeignTable *table;
 	ForeignServer *server;
 	UserMapping *user;
+	instr_time	stat_start_time;
 
 	elog(DEBUG2, "entering function %s", __func__);
 
@@ -3481,7 +4877,13 @@ fbAcquireSampleRowsFunc(Relation relation, int elevel,
 	fdw_state->query = analyze_query.data;
 	elog(DEBUG1, "analyze query is: %s", fdw_state->query);
 
+	firebirdStatStart(&stat_start_time);
+
+	firebirdWaitStart(FB_WAIT_EXECUTE);
 	res = FQexec(fdw_state->conn, fdw_state->query);
+	firebirdWaitEnd();
+
+	firebirdConnectionNoteStatement(fdw_state->conn, strlen(fdw_state->query), res);
 
 	if (FQresultStatus(res) != FBRES_TUPLES_OK)
 	{
@@ -3491,6 +4893,9 @@ fbAcquireSampleRowsFunc(Relation relation, int elevel,
 				 errmsg("unable to analyze remote table \"%s\"", fdw_state->svr_table)));
 	}
 
+	firebirdStatEnd(server->serverid, fdw_state->query, 0, &stat_start_time, res);
+	firebirdLogRemoteStatement(fdw_state->conn, fdw_state->query, 0, NULL, &stat_start_time, res);
+
 	result_rows = FQntuples(res);
 
 	elog(DEBUG1, "%i rows returned", result_rows);
@@ -4273,6 +5678,170 @@ get_stmt_param_formats(FirebirdFdwModifyState *fmstate,
 }
 
 
+/**
+ * execute_foreign_modify()
+ *
+ * Execute the modify operation's statement with the provided parameters.
+ *
+ * The statement is prepared on first execution and the prepared statement
+ * is reused for every subsequent row, so Firebird does not need to parse
+ * it again and libfq can reuse the statement's parameter and result
+ * buffers. The returned result belongs to the prepared statement and
+ * must not be freed by the caller; an error is raised if execution
+ * fails.
+ *
+ * The prepared statement is recorded against the connection, so it can
+ * be released if an error aborts the operation before
+ * release_foreign_modify() is reached.
+ *
+ * "wait_event" is reported while waiting for Firebird to execute the
+ * statement.
+ */
+static FBresult *
+execute_foreign_modify(FirebirdFdwModifyState *fmstate,
+					   const char * const *p_values,
+					   const int *paramFormats,
+					   fbWaitEvent wait_event)
+{
+	fbInstrumentation *instr = fmstate->instr;
+	instr_time	start_time;
+	instr_time	end_time;
+	instr_time	stat_start_time;
+	int64		bytes_sent = 0;
+	FBresult   *result;
+	int			i;
+
+	if (fmstate->prepared == NULL)
+	{
+		elog(DEBUG2, "preparing statement:\n%s", fmstate->query);
+
+		if (instr != NULL)
+			INSTR_TIME_SET_CURRENT(start_time);
+
+		firebirdWaitStart(FB_WAIT_EXECUTE);
+		fmstate->prepared = FQprepare(fmstate->conn,
+									  fmstate->query,
+									  fmstate->p_nums,
+									  NULL);
+		firebirdWaitEnd();
+
+		if (instr != NULL)
+		{
+			INSTR_TIME_SET_CURRENT(end_time);
+			INSTR_TIME_ACCUM_DIFF(instr->prepare_time, end_time, start_time);
+		}
+
+		switch(FQresultStatus(fmstate->prepared))
+		{
+			case FBRES_EMPTY_QUERY:
+			case FBRES_BAD_RESPONSE:
+			case FBRES_NONFATAL_ERROR:
+			case FBRES_FATAL_ERROR:
+				{
+					FBresult   *result = fmstate->prepared;
+
+					/* fbfdw_report_error() frees the result */
+					fmstate->prepared = NULL;
+
+					fbfdw_report_error(ERROR,
+									   ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION,
+									   result,
+									   fmstate->conn,
+									   fmstate->query);
+				}
+				break;
+			default:
+				break;
+		}
+
+		firebirdConnectionNotePrepared(fmstate->conn, fmstate->prepared, fmstate->query);
+	}
+
+	if (instr != NULL)
+		firebirdInstrStartRemote(instr, &start_time);
+
+	firebirdStatStart(&stat_start_time);
+
+	FIREBIRD_FDW_STATEMENT_START(fmstate->query);
+
+	firebirdWaitStart(wait_event);
+	result = FQexecPrepared(fmstate->conn,
+							fmstate->prepared,
+							fmstate->p_nums,
+							p_values,
+							NULL,
+							paramFormats,
+							0);
+	firebirdWaitEnd();
+
+	for (i = 0; i < fmstate->p_nums; i++)
+	{
+		if (p_values[i] != NULL)
+			bytes_sent += strlen(p_values[i]);
+	}
+
+	firebirdConnectionNoteStatement(fmstate->conn, bytes_sent, result);
+
+	if (instr != NULL)
+	{
+		firebirdInstrEndRemote(instr, &start_time);
+
+		instr->bytes_sent += bytes_sent;
+
+		if (FQresultStatus(result) == FBRES_TUPLES_OK)
+		{
+			for (i = 0; i < FQntuples(result); i++)
+				firebirdInstrCountRow(instr, result, i);
+		}
+	}
+
+	switch(FQresultStatus(result))
+	{
+		case FBRES_EMPTY_QUERY:
+		case FBRES_BAD_RESPONSE:
+		case FBRES_NONFATAL_ERROR:
+		case FBRES_FATAL_ERROR:
+			/* The result belongs to the prepared statement, so must not be freed */
+			fbfdw_report_prepared_error(ERROR,
+										ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION,
+										result,
+										fmstate->conn,
+										fmstate->query);
+			/* fbfdw_report_prepared_error() will never return here, but break anyway */
+			break;
+		default:
+			break;
+	}
+
+	FIREBIRD_FDW_STATEMENT_DONE(fmstate->query, FQntuples(result));
+
+	firebirdStatEnd(fmstate->serverid, fmstate->query, 0, &stat_start_time, result);
+	firebirdLogRemoteStatement(fmstate->conn, fmstate->query, fmstate->p_nums, p_values,
+							   &stat_start_time, result);
+
+	return result;
+}
+
+
+/**
+ * release_foreign_modify()
+ *
+ * Release the modify operation's prepared statement, if any.
+ */
+static void
+release_foreign_modify(FirebirdFdwModifyState *fmstate)
+{
+	if (fmstate->prepared == NULL)
+		return;
+
+	firebirdConnectionNotePrepared(fmstate->conn, fmstate->prepared, NULL);
+
+	FQdeallocatePrepared(fmstate->conn, fmstate->prepared);
+	FQclear(fmstate->prepared);
+	fmstate->prepared = NULL;
+}
+
+
 /**
  * store_returning_result()
  *
@@ -25,6 +25,8 @@
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
 #include "parser/parsetree.h"
+#include "pgstat.h"
+#include "portability/instr_time.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/array.h"
@@ -44,6 +46,12 @@
 /* http://www.firebirdfaq.org/faq259/ */
 #define FIREBIRD_DEFAULT_PORT 3050
 
+/* Row estimate for stored procedures without "estimated_row_count" */
+#define FIREBIRD_PROCEDURE_DEFAULT_ROWS 1000
+
+/* Number of result rows decoded at a time by a foreign scan */
+#define FIREBIRD_DECODE_BLOCK_ROWS 100
+
 /*
  * In PostgreSQL 11 and earlier, "table_open|close()" were "heap_open|close()";
  * see core commits 4b21acf5 and f25968c4.
@@ -61,10 +69,68 @@
 #define NO_BATCH_SIZE_SPECIFIED -1
 #endif
 
+/*
+ * Aggregate pushdown requires the upper relation infrastructure
+ * (in particular GroupPathExtraData) added in PostgreSQL 11.
+ */
+#if (PG_VERSION_NUM >= 110000)
+#define HAVE_AGGREGATE_PUSHDOWN
+#endif
+
+/*
+ * Join pushdown is provided from PostgreSQL 11, which added partitionwise
+ * joins; like aggregate pushdown it generates a foreign scan with no
+ * base relation, and shares the code guarded by HAVE_AGGREGATE_PUSHDOWN.
+ */
+#if (PG_VERSION_NUM >= 110000)
+#define HAVE_JOIN_PUSHDOWN
+#endif
+
 #if (defined(FIREBIRD_FDW_DEBUG_BUILD))
 #define DEBUG_BUILD
 #endif
 
+/*
+ * Static trace points (USDT probes) on the remote execution paths; these
+ * are only compiled in if built with FIREBIRD_FDW_ENABLE_PROBES=1, and
+ * require <sys/sdt.h> (e.g. as provided by SystemTap).
+ */
+#if (defined(FIREBIRD_FDW_ENABLE_PROBES))
+#include <sys/sdt.h>
+
+#define FIREBIRD_FDW_STATEMENT_START(query) \
+	DTRACE_PROBE1(firebird_fdw, statement__start, query)
+#define FIREBIRD_FDW_STATEMENT_DONE(query, rows) \
+	DTRACE_PROBE2(firebird_fdw, statement__done, query, rows)
+#define FIREBIRD_FDW_FETCH_BLOCK(start_row, nrows) \
+	DTRACE_PROBE2(firebird_fdw, fetch__block, start_row, nrows)
+#define FIREBIRD_FDW_TUPLE_CONVERT_START(row) \
+	DTRACE_PROBE1(firebird_fdw, tuple__convert__start, row)
+#define FIREBIRD_FDW_TUPLE_CONVERT_DONE(row) \
+	DTRACE_PROBE1(firebird_fdw, tuple__convert__done, row)
+#define FIREBIRD_FDW_BATCH_FLUSH_START(query, nrows) \
+	DTRACE_PROBE2(firebird_fdw, batch__flush__start, query, nrows)
+#define FIREBIRD_FDW_BATCH_FLUSH_DONE(query, nrows) \
+	DTRACE_PROBE2(firebird_fdw, batch__flush__done, query, nrows)
+#define FIREBIRD_FDW_XACT_BEGIN(level) \
+	DTRACE_PROBE1(firebird_fdw, xact__begin, level)
+#define FIREBIRD_FDW_XACT_COMMIT() \
+	DTRACE_PROBE(firebird_fdw, xact__commit)
+#define FIREBIRD_FDW_XACT_ABORT() \
+	DTRACE_PROBE(firebird_fdw, xact__abort)
+#else
+#define FIREBIRD_FDW_STATEMENT_START(query) do {} while (0)
+#define FIREBIRD_FDW_STATEMENT_DONE(query, rows) do {} while (0)
+#define FIREBIRD_FDW_FETCH_BLOCK(start_row, nrows) do {} while (0)
+#define FIREBIRD_FDW_TUPLE_CONVERT_START(row) do {} while (0)
+#define FIREBIRD_FDW_TUPLE_CONVERT_DONE(row) do {} while (0)
+#define FIREBIRD_FDW_BATCH_FLUSH_START(query, nrows) do {} while (0)
+#define FIREBIRD_FDW_BATCH_FLUSH_DONE(query, nrows) do {} while (0)
+#define FIREBIRD_FDW_XACT_BEGIN(level) do {} while (0)
+#define FIREBIRD_FDW_XACT_COMMIT() do {} while (0)
+#define FIREBIRD_FDW_XACT_ABORT() do {} while (0)
+#endif
+
 /*
  * Macro to indicate if a given PostgreSQL datatype can be
  * converted to a Firebird type
@@ -94,6 +160,8 @@ typedef struct fbServerOptions {
 	fdwOption updatable;
 	fdwOption quote_identifiers;
 	fdwOption implicit_bool_type;
+	fdwOption external_file_directory;
+	fdwOption trusted_encoding;
 #if (PG_VERSION_NUM >= 140000)
 	fdwOption batch_size;
 	fdwOption truncatable;
@@ -110,6 +178,8 @@ typedef struct fbServerOptions {
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
+	{ { NULL }, false }, \
+	{ { NULL }, false }, \
 	{ { NULL }, false } \
 }
 #else
@@ -120,6 +190,8 @@ typedef struct fbServerOptions {
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
+	{ { NULL }, false }, \
+	{ { NULL }, false }, \
 	{ { NULL }, false } \
 }
 #endif
@@ -131,6 +203,8 @@ typedef struct fbTableOptions {
 	fdwOption updatable;
 	fdwOption estimated_row_count;
 	fdwOption quote_identifier;
+	fdwOption cache_ttl;
+	fdwOption procedure;
 #if (PG_VERSION_NUM >= 140000)
 	fdwOption batch_size;
 	fdwOption truncatable;
@@ -145,6 +219,8 @@ typedef struct fbTableOptions {
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
+	{ { NULL }, false }, \
+	{ { NULL }, false }, \
 	{ { NULL }, false } \
 }
 #else
@@ -153,6 +229,8 @@ typedef struct fbTableOptions {
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
 	{ { NULL }, false }, \
+	{ { NULL }, false }, \
+	{ { NULL }, false }, \
 	{ { NULL }, false } \
 }
 #endif
@@ -161,9 +239,13 @@ typedef struct fbColumnOptions {
 	char **column_name;
 	bool *quote_identifier;
 	bool *implicit_bool_type;
+	int *procedure_parameter;
+	char **query_parameter;
 } fbColumnOptions;
 
 #define fbColumnOptions_init { \
+	NULL, \
+	NULL, \
 	NULL, \
 	NULL, \
 	NULL \
@@ -204,6 +286,7 @@ typedef struct FirebirdFdwState
 {
 	char	   *svr_query;
 	char	   *svr_table;
+	char	   *svr_procedure;
 	bool		disable_pushdowns;	 /* true if server option "disable_pushdowns" supplied */
 	int			estimated_row_count; /* set if server option "estimated_row_count" provided */
 	bool		quote_identifier;
@@ -223,8 +306,88 @@ typedef struct FirebirdFdwState
 	Cost		total_cost;			/* cost estimate, only needed for planning */
 	int			row;
 	char	   *query;				/* query to send to Firebird */
+
+	/* Selectable stored procedures and parameterized queries */
+	Bitmapset  *param_attrs;		/* attnos of columns marked as parameters */
+	List	   *param_attnos;		/* attno of the column for each parameter position, or 0 */
+	List	   *param_names;		/* placeholder name for each parameter position */
+	Bitmapset  *param_outer_attrs;	/* parameter columns only provided by join conditions */
+	List	   *param_args;			/* argument passed for each procedure parameter */
+	char	   *param_query;		/* query with the placeholders replaced */
+
+	/* Aggregate and join pushdown */
+	bool		pushdown_safe;		/* true if relation can be used as input for a pushdown */
+	RelOptInfo *outerrel;			/* for an upper relation, the underlying scan relation;
+									 * for a join relation, the outer relation */
+	RelOptInfo *innerrel;			/* for a join relation, the inner relation */
+	JoinType	jointype;			/* for a join relation, the type of join */
+	List	   *joinclauses;		/* for an outer join, the conditions in its ON clause */
+	List	   *grouped_tlist;		/* target list of a pushed-down aggregation */
+	List	   *having_conds;		/* HAVING conditions to evaluate remotely */
 } FirebirdFdwState;
 
+/*
+ * Wait events reported while waiting for Firebird; from PostgreSQL 17 these
+ * are registered as custom wait events, otherwise the generic "Extension"
+ * wait event is reported.
+ */
+typedef enum
+{
+	FB_WAIT_CONNECT = 0,
+	FB_WAIT_EXECUTE,
+	FB_WAIT_COMMIT,
+	FB_WAIT_BATCH_FLUSH,
+	FB_WAIT_EVENT_COUNT
+} fbWaitEvent;
+
+/* Result cache entry (defined in cache.c) */
+typedef struct fbCachedResult fbCachedResult;
+
+/*
+ * Firebird I/O and record access counters, from the monitoring tables.
+ */
+typedef struct fbServerCounters
+{
+	int64		page_reads;
+	int64		page_fetches;
+	int64		page_marks;
+	int64		seq_reads;			/* records read by natural access */
+	int64		idx_reads;			/* records read via an index */
+} fbServerCounters;
+
+typedef enum
+{
+	FB_COUNTERS_NONE = 0,			/* start values read; differences not yet collected */
+	FB_COUNTERS_COLLECTED,
+	FB_COUNTERS_UNAVAILABLE
+} fbServerCountersState;
+
+/*
+ * Remote operation statistics of a scan or modify node, collected for
+ * EXPLAIN ANALYZE.
+ */
+typedef struct fbInstrumentation
+{
+	instr_time	start_time;			/* start of the current scan */
+	instr_time	prepare_time;		/* preparing remote statements */
+	instr_time	execute_time;		/* executing remote statements and fetching their results */
+	instr_time	first_row_time;		/* from start of scan to first row returned */
+	instr_time	conversion_time;	/* converting fetched values to tuples */
+	bool		have_first_row;
+	int64		round_trips;		/* remote statement executions */
+	int64		batches;			/* batch inserts */
+	int64		rows;				/* rows received */
+	int64		bytes_sent;			/* parameter data sent */
+	int64		bytes_received;		/* result data received */
+	FBconn	   *conn;				/* connection the server counters are read from */
+	fbServerCountersState server_counters;
+	fbServerCounters counters_start;	/* when the node began execution */
+	fbServerCounters counters;		/* differences shown by EXPLAIN */
+} fbInstrumentation;
+
+/* Column-wise decoded block of result rows (defined in decode.c) */
+typedef struct fbDecodeBlock fbDecodeBlock;
+
 /*
  * Execution state of a foreign scan using firebird_fdw.
  */
@@ -237,10 +400,41 @@ typedef struct FirebirdFdwScanState
 	/* Query information */
 	char	   *query;				/* query to send to Firebird */
 	bool		db_key_used;		/* indicate whether RDB$DB_KEY was requested */
+	bool		trusted_encoding;	/* copy text values without the type input function */
 
 	FBresult   *result;
 	int			row;
-
+	fbDecodeBlock *decode_block;	/* rows of "result" decoded into Datums */
+	fbInstrumentation *instr;		/* EXPLAIN ANALYZE statistics, or NULL */
+	int			local_conds;		/* number of conditions evaluated locally */
+
+	/* Result cache */
+	int			cache_ttl;			/* seconds to cache the result; 0 if not cached */
+	Oid			serverid;			/* cache key: foreign server */
+	Oid			userid;				/* cache key: user whose mapping is used */
+	List	   *relids;				/* OIDs of the foreign tables scanned */
+	fbCachedResult *cache_ref;		/* reference to cached or shared results,
+								 * created on first use */
+	fbCachedResult *cached_result;	/* "cache_ref" if "result" is cached or
+								 * shared, otherwise NULL */
+	EState	   *share_estate;		/* executor state within which "result" may
+								 * be shared with identical scans, or NULL */
+
+	/* Retention of fetched rows for replay on rescan */
+	bool		rewind;				/* rescans without parameter changes are expected */
+	Tuplestorestate *tuplestore;	/* rows fetched so far, or NULL */
+	TupleTableSlot *replay_slot;	/* slot for reading from the tuplestore */
+	bool		fetched_all;		/* all rows are in the tuplestore */
+
+	/* Values of stored procedure arguments or query placeholders */
+	List	   *param_exprs;		/* expressions providing the values */
+	FmgrInfo   *param_flinfo;		/* output function of each value */
+	List	   *param_attnos;		/* column each value is returned as */
+	List	   *param_order;		/* value bound to each remote parameter */
+	int			num_params;			/* number of remote parameters */
+	const char **param_values;		/* remote parameter values as text */
+	char	  **column_values;		/* value of each parameter column as text */
+	MemoryContext param_cxt;		/* memory for the values of each execution */
 } FirebirdFdwScanState;
 
 /*
@@ -266,6 +460,9 @@ typedef struct FirebirdFdwModifyState
 
 	int			  p_nums;		  /* number of parameters to transmit */
 	FmgrInfo	 *p_flinfo;		  /* output conversion functions for them */
+	FBresult	 *prepared;		  /* prepared statement, once executed */
+	Oid			  serverid;		  /* foreign server, for statement statistics */
+	fbInstrumentation *instr;	  /* EXPLAIN ANALYZE statistics, or NULL */
 
 	/* working memory context */
 	MemoryContext temp_cxt;		  /* context for per-tuple temporary data */
@@ -277,14 +474,95 @@ typedef struct FirebirdFdwModifyState
 
 
 extern void fbSigInt(SIGNAL_ARGS);
+extern FirebirdFdwState *getFdwState(Oid foreigntableid);
+extern bool firebirdIsTableUpdatable(Oid foreigntableid);
 
 /* connection functions (in connection.c) */
 
 
 extern FBconn *firebirdInstantiateConnection(ForeignServer *server, UserMapping *user);
+extern FBconn *firebirdOpenConnection(ForeignServer *server, UserMapping *user);
+extern void firebirdCheckServerUsage(ForeignServer *server);
 extern void firebirdCloseConnections(bool verbose);
 extern int firebirdCachedConnectionsCount(void);
+extern bool firebirdConnectionInTransaction(ForeignServer *server, UserMapping *user);
+extern void firebirdConnectionNoteStatement(FBconn *conn, int64 bytes_sent, FBresult *res);
+extern void firebirdConnectionNotePrepared(FBconn *conn, FBresult *prepared, const char *query);
+extern int64 firebirdResultBytes(FBresult *res);
+extern uint32 firebirdWaitEventInfo(fbWaitEvent event);
 extern void fbfdw_report_error(int errlevel, int pg_errcode, FBresult *res, FBconn *conn, char *query);
+extern void fbfdw_report_prepared_error(int errlevel, int pg_errcode, FBresult *res, FBconn *conn, char *query);
+
+/* Report waiting for Firebird, e.g. around a remote statement execution */
+static inline void
+firebirdWaitStart(fbWaitEvent event)
+{
+#if (PG_VERSION_NUM >= 90600)
+	pgstat_report_wait_start(firebirdWaitEventInfo(event));
+#endif
+}
+
+static inline void
+firebirdWaitEnd(void)
+{
+#if (PG_VERSION_NUM >= 90600)
+	pgstat_report_wait_end();
+#endif
+}
+
+
+/* result cache functions (in cache.c) */
+
+extern void firebirdCacheInit(void);
+extern fbCachedResult *firebirdCacheRefCreate(EState *estate);
+extern bool firebirdCacheLookup(fbCachedResult *cached, Oid serverid, Oid userid, const char *query);
+extern bool firebirdCacheStore(fbCachedResult *cached, Oid serverid, Oid userid, const char *query,
+							   List *relids, int ttl, FBresult *res);
+extern FBresult *firebirdCacheGetResult(fbCachedResult *cached);
+extern void firebirdCacheRelease(fbCachedResult *cached);
+extern int firebirdCacheInvalidate(Oid relid);
+extern void firebirdCacheNoteModification(Oid relid);
+extern int firebirdCachedResultsCount(void);
+extern bool firebirdSharedResultLookup(fbCachedResult *cached, EState *estate, FBconn *conn,
+									   const char *query);
+extern void firebirdSharedResultStore(fbCachedResult *cached, EState *estate, FBconn *conn,
+									  const char *query, FBresult *res);
+
+
+/* column-wise result decoding functions (in decode.c) */
+
+extern fbDecodeBlock *firebirdDecodeBlockCreate(TupleDesc tupdesc, int *field_map,
+												char **column_values,
+												bool trusted_encoding);
+extern void firebirdDecodeBlockReset(fbDecodeBlock *block);
+extern HeapTuple firebirdDecodeBlockGetTuple(fbDecodeBlock *block, FBresult *res, int row);
+
+
+/* EXPLAIN ANALYZE instrumentation functions (in instrument.c) */
+
+extern fbInstrumentation *firebirdInstrCreate(PlanState *ps, FBconn *conn);
+extern void firebirdInstrStartRemote(fbInstrumentation *instr, instr_time *start_time);
+extern void firebirdInstrEndRemote(fbInstrumentation *instr, instr_time *start_time);
+extern void firebirdInstrCountRow(fbInstrumentation *instr, FBresult *res, int row);
+extern void firebirdInstrExplain(fbInstrumentation *instr, ExplainState *es);
+
+
+/* remote statement statistics functions (in stats.c) */
+
+extern void firebirdStatInit(void);
+extern bool firebirdStatEnabled(void);
+extern void firebirdStatStart(instr_time *start_time);
+extern void firebirdStatEnd(Oid serverid, const char *query, int local_conds, instr_time *start_time, FBresult *res);
+extern char *firebirdStatNormalizeQuery(const char *query);
+
+
+/* slow remote statement logging functions (in log.c) */
+
+extern void firebirdLogInit(void);
+extern bool firebirdLogEnabled(void);
+extern void firebirdLogRemoteStatement(FBconn *conn, const char *query,
+									   int nparams, const char * const *params,
+									   instr_time *start_time, FBresult *res);
 
 
 /* option functions (in options.c) */
@@ -330,6 +608,14 @@ extern void buildSelectSql(StringInfo buf, RangeTblEntry *rte,
 						   List **retrieved_attrs,
 						   bool *db_key_used);
 
+#ifdef HAVE_AGGREGATE_PUSHDOWN
+extern void buildSelectSqlForRel(StringInfo buf,
+								 PlannerInfo *root,
+								 RelOptInfo *foreignrel,
+								 List *tlist,
+								 List **retrieved_attrs);
+#endif
+
 extern void buildWhereClause(StringInfo buf,
 							 PlannerInfo *root,
 							 RelOptInfo *baserel,
@@ -337,6 +623,10 @@ extern void buildWhereClause(StringInfo buf,
 							 bool is_first,
 							 List **params);
 
+extern void buildLockingClause(StringInfo output,
+							   PlanRowMark *rowmark,
+							   int firebird_version);
+
 extern void
 identifyRemoteConditions(PlannerInfo *root,
 						 RelOptInfo *baserel,
@@ -345,12 +635,49 @@ identifyRemoteConditions(PlannerInfo *root,
 						 bool disable_pushdowns,
 						 int firebird_version);
 
+extern void
+identifyParameterArguments(PlannerInfo *root,
+						   RelOptInfo *baserel,
+						   FirebirdFdwState *fdw_state);
+
+extern List *
+getParameterJoinClauses(PlannerInfo *root,
+						RelOptInfo *baserel,
+						FirebirdFdwState *fdw_state,
+						AttrNumber attno);
+
+extern AttrNumber
+getParameterValue(RelOptInfo *baserel,
+				  FirebirdFdwState *fdw_state,
+				  RestrictInfo *ri,
+				  Expr **value);
+
+extern List *
+identifyParameterValues(RelOptInfo *baserel,
+						FirebirdFdwState *fdw_state,
+						List *scan_clauses,
+						List **param_conds,
+						List **param_attnos,
+						List **param_order);
+
 extern bool
 isFirebirdExpr(PlannerInfo *root,
 			   RelOptInfo *baserel,
 			   Expr *expr,
 			   int firebird_version);
 
+extern char *
+getFirebirdExprRejectReason(PlannerInfo *root,
+							RelOptInfo *baserel,
+							Expr *expr,
+							int firebird_version);
+
+extern char *
+getLocalConditionReason(PlannerInfo *root,
+						RelOptInfo *baserel,
+						FirebirdFdwState *fdw_state,
+						Expr *expr);
+
 void convertColumnRef(StringInfo buf,
 					  Oid relid,
 					  int varattno,
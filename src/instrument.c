@@ -0,0 +1,257 @@
+/*-------------------------------------------------------------------------
+ *
+ * EXPLAIN ANALYZE instrumentation for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/instrument.c
+ *
+ * Foreign scans and modify operations executed under EXPLAIN ANALYZE
+ * record the time spent preparing and executing remote statements and
+ * converting their results, as well as the number of round trips and
+ * the amount of data transferred. These are shown with the node's
+ * other EXPLAIN output.
+ *
+ * Additionally, Firebird's own I/O and record access counters for the
+ * attachment are read from the monitoring tables when the node begins
+ * execution, and again when its EXPLAIN (ANALYZE, VERBOSE) output is
+ * produced; the differences are shown. As the monitoring snapshot is fixed
+ * for the lifetime of a transaction, the counters are read in an autonomous
+ * transaction.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "firebird_fdw.h"
+
+
+/* Attachment counters, read in a new monitoring snapshot */
+#define FB_SERVER_COUNTERS_QUERY \
+	"EXECUTE BLOCK RETURNS ( " \
+	"  page_reads BIGINT, page_fetches BIGINT, page_marks BIGINT, " \
+	"  seq_reads BIGINT, idx_reads BIGINT) " \
+	"AS " \
+	"BEGIN " \
+	"  IN AUTONOMOUS TRANSACTION DO " \
+	"    SELECT io.mon$page_reads, io.mon$page_fetches, io.mon$page_marks, " \
+	"           r.mon$record_seq_reads, r.mon$record_idx_reads " \
+	"      FROM mon$attachments a " \
+	"      JOIN mon$io_stats io ON io.mon$stat_id = a.mon$stat_id " \
+	"      JOIN mon$record_stats r ON r.mon$stat_id = a.mon$stat_id " \
+	"     WHERE a.mon$attachment_id = CURRENT_CONNECTION " \
+	"      INTO :page_reads, :page_fetches, :page_marks, :seq_reads, :idx_reads; " \
+	"  SUSPEND; " \
+	"END"
+
+static bool fbInstrGetServerCounters(FBconn *conn, fbServerCounters *counters);
+static void fbInstrShowTime(const char *label, instr_time *time, ExplainState *es);
+static void fbInstrShowCount(const char *label, const char *unit, int64 value, ExplainState *es);
+
+
+/**
+ * firebirdInstrCreate()
+ *
+ * Return instrumentation for a scan or modify node using "conn", if the
+ * node itself is instrumented (i.e. EXPLAIN ANALYZE is being executed),
+ * otherwise NULL.
+ *
+ * The connection's server counters are read here, once; whether they are
+ * shown is only known when the EXPLAIN output is produced.
+ */
+fbInstrumentation *
+firebirdInstrCreate(PlanState *ps, FBconn *conn)
+{
+	fbInstrumentation *instr;
+
+	if (ps->instrument == NULL)
+		return NULL;
+
+	instr = (fbInstrumentation *) palloc0(sizeof(fbInstrumentation));
+	instr->conn = conn;
+
+	if (!fbInstrGetServerCounters(conn, &instr->counters_start))
+		instr->server_counters = FB_COUNTERS_UNAVAILABLE;
+
+	return instr;
+}
+
+
+/**
+ * firebirdInstrStartRemote()
+ *
+ * Note the start of a remote statement execution.
+ */
+void
+firebirdInstrStartRemote(fbInstrumentation *instr, instr_time *start_time)
+{
+	INSTR_TIME_SET_CURRENT(*start_time);
+}
+
+
+/**
+ * firebirdInstrEndRemote()
+ *
+ * Note the end of a remote statement execution begun at "start_time",
+ * and add the execution time to the total.
+ */
+void
+firebirdInstrEndRemote(fbInstrumentation *instr, instr_time *start_time)
+{
+	instr_time	end_time;
+
+	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_ACCUM_DIFF(instr->execute_time, end_time, *start_time);
+	instr->round_trips++;
+}
+
+
+/**
+ * firebirdInstrCountRow()
+ *
+ * Record a row received from Firebird, and its size.
+ */
+void
+firebirdInstrCountRow(fbInstrumentation *instr, FBresult *res, int row)
+{
+	int			nfields = FQnfields(res);
+	int			field;
+
+	instr->rows++;
+
+	for (field = 0; field < nfields; field++)
+	{
+		if (!FQgetisnull(res, row, field))
+			instr->bytes_received += FQgetlength(res, row, field);
+	}
+}
+
+
+/**
+ * firebirdInstrExplain()
+ *
+ * Add the collected instrumentation to the node's EXPLAIN output.
+ *
+ * With VERBOSE, the server counters are read a second time; the
+ * differences from the values read when the node began cover all activity
+ * on the connection in the meantime, which includes any other nodes
+ * sharing it.
+ */
+void
+firebirdInstrExplain(fbInstrumentation *instr, ExplainState *es)
+{
+	if (!INSTR_TIME_IS_ZERO(instr->prepare_time))
+		fbInstrShowTime("Remote Prepare Time", &instr->prepare_time, es);
+
+	fbInstrShowTime("Remote Execution Time", &instr->execute_time, es);
+
+	if (instr->have_first_row)
+		fbInstrShowTime("Time to First Row", &instr->first_row_time, es);
+
+	if (!INSTR_TIME_IS_ZERO(instr->conversion_time))
+		fbInstrShowTime("Conversion Time", &instr->conversion_time, es);
+
+	fbInstrShowCount("Round Trips", NULL, instr->round_trips, es);
+
+	if (instr->batches > 0)
+		fbInstrShowCount("Batches", NULL, instr->batches, es);
+
+	fbInstrShowCount("Rows Received", NULL, instr->rows, es);
+
+	if (instr->bytes_sent > 0)
+		fbInstrShowCount("Bytes Sent", "bytes", instr->bytes_sent, es);
+
+	fbInstrShowCount("Bytes Received", "bytes", instr->bytes_received, es);
+
+	if (es->verbose && instr->server_counters == FB_COUNTERS_NONE)
+	{
+		fbServerCounters counters_end;
+
+		if (fbInstrGetServerCounters(instr->conn, &counters_end))
+		{
+			instr->counters.page_reads = counters_end.page_reads - instr->counters_start.page_reads;
+			instr->counters.page_fetches = counters_end.page_fetches - instr->counters_start.page_fetches;
+			instr->counters.page_marks = counters_end.page_marks - instr->counters_start.page_marks;
+			instr->counters.seq_reads = counters_end.seq_reads - instr->counters_start.seq_reads;
+			instr->counters.idx_reads = counters_end.idx_reads - instr->counters_start.idx_reads;
+
+			instr->server_counters = FB_COUNTERS_COLLECTED;
+		}
+		else
+			instr->server_counters = FB_COUNTERS_UNAVAILABLE;
+	}
+
+	if (es->verbose && instr->server_counters == FB_COUNTERS_COLLECTED)
+	{
+		fbInstrShowCount("Firebird Page Reads", NULL, instr->counters.page_reads, es);
+		fbInstrShowCount("Firebird Page Fetches", NULL, instr->counters.page_fetches, es);
+		fbInstrShowCount("Firebird Page Marks", NULL, instr->counters.page_marks, es);
+		fbInstrShowCount("Firebird Natural Reads", NULL, instr->counters.seq_reads, es);
+		fbInstrShowCount("Firebird Indexed Reads", NULL, instr->counters.idx_reads, es);
+	}
+}
+
+
+/**
+ * fbInstrGetServerCounters()
+ *
+ * Read the attachment's current counters from Firebird's monitoring
+ * tables. Returns false if they are not available, in which case no
+ * counters are shown for the node; this includes Firebird versions
+ * before 2.5, which lack autonomous transactions.
+ */
+static bool
+fbInstrGetServerCounters(FBconn *conn, fbServerCounters *counters)
+{
+	FBresult   *res;
+	bool		success = false;
+
+	if (FQserverVersion(conn) < 20500)
+		return false;
+
+	res = FQexec(conn, FB_SERVER_COUNTERS_QUERY);
+
+	if (FQresultStatus(res) == FBRES_TUPLES_OK && FQntuples(res) == 1)
+	{
+		counters->page_reads = strtoll(FQgetvalue(res, 0, 0), NULL, 10);
+		counters->page_fetches = strtoll(FQgetvalue(res, 0, 1), NULL, 10);
+		counters->page_marks = strtoll(FQgetvalue(res, 0, 2), NULL, 10);
+		counters->seq_reads = strtoll(FQgetvalue(res, 0, 3), NULL, 10);
+		counters->idx_reads = strtoll(FQgetvalue(res, 0, 4), NULL, 10);
+		success = true;
+	}
+	else
+		elog(DEBUG1, "%s: unable to read monitoring counters: %s",
+			 __func__, FQresultErrorMessage(res));
+
+	FQclear(res);
+
+	return success;
+}
+
+
+static void
+fbInstrShowTime(const char *label, instr_time *time, ExplainState *es)
+{
+#if (PG_VERSION_NUM >= 110000)
+	ExplainPropertyFloat(label, "ms", INSTR_TIME_GET_MILLISEC(*time), 3, es);
+#else
+	ExplainPropertyFloat(label, INSTR_TIME_GET_MILLISEC(*time), 3, es);
+#endif
+}
+
+
+static void
+fbInstrShowCount(const char *label, const char *unit, int64 value, ExplainState *es)
+{
+#if (PG_VERSION_NUM >= 110000)
+	ExplainPropertyInteger(label, unit, value, es);
+#else
+	ExplainPropertyLong(label, (long) value, es);
+#endif
+}
@@ -0,0 +1,186 @@
+/*-------------------------------------------------------------------------
+ *
+ * Slow remote statement logging for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/log.c
+ *
+ * Remote statements whose execution takes at least
+ * "firebird_fdw.log_min_remote_duration" milliseconds are written to the
+ * server log, together with their parameters and, if
+ * "firebird_fdw.log_remote_plan" is set, the plan Firebird used. The plan
+ * is only requested from Firebird for statements which are logged.
+ *
+ * If "firebird_fdw.log_remote_parameters" is off, parameter values are
+ * redacted, and the statement is logged with its literal constants
+ * replaced by "?", as in firebird_fdw_stat_statements().
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <limits.h>
+
+#include "firebird_fdw.h"
+
+#include "utils/guc.h"
+
+
+/* GUC variables */
+static int	fbLogMinRemoteDuration = -1;
+static bool fbLogRemotePlan = false;
+static bool fbLogRemoteParameters = true;
+
+
+/**
+ * firebirdLogInit()
+ *
+ * Called from _PG_init() to define the logging GUCs.
+ */
+void
+firebirdLogInit(void)
+{
+	DefineCustomIntVariable("firebird_fdw.log_min_remote_duration",
+							"Sets the minimum execution time above which remote statements will be logged.",
+							"Zero logs all remote statements, -1 disables logging.",
+							&fbLogMinRemoteDuration,
+							-1,
+							-1, INT_MAX,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("firebird_fdw.log_remote_plan",
+							 "Logs the Firebird plan of logged remote statements.",
+							 NULL,
+							 &fbLogRemotePlan,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("firebird_fdw.log_remote_parameters",
+							 "Logs the parameter values of logged remote statements.",
+							 "If disabled, parameter values are redacted.",
+							 &fbLogRemoteParameters,
+							 true,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+#if (PG_VERSION_NUM >= 150000)
+	MarkGUCPrefixReserved("firebird_fdw");
+#else
+	EmitWarningsOnPlaceholders("firebird_fdw");
+#endif
+}
+
+
+/**
+ * firebirdLogEnabled()
+ *
+ * Indicate whether remote statements are to be timed for logging.
+ */
+bool
+firebirdLogEnabled(void)
+{
+	return fbLogMinRemoteDuration >= 0;
+}
+
+
+/**
+ * firebirdLogRemoteStatement()
+ *
+ * Log the execution of "query", begun at "start_time", with the "nparams"
+ * parameters "params" and result "res", if its duration reaches
+ * firebird_fdw.log_min_remote_duration. The result is not freed.
+ *
+ * Unless firebird_fdw.log_remote_parameters is set, "query" is logged
+ * normalized, as it may contain constants pushed down from the local query.
+ */
+void
+firebirdLogRemoteStatement(FBconn *conn, const char *query,
+						   int nparams, const char * const *params,
+						   instr_time *start_time, FBresult *res)
+{
+	instr_time	elapsed;
+	double		msecs;
+	StringInfoData detail;
+	char	   *logged_query;
+	int			i;
+
+	if (!firebirdLogEnabled() || INSTR_TIME_IS_ZERO(*start_time))
+		return;
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, *start_time);
+	msecs = INSTR_TIME_GET_MILLISEC(elapsed);
+
+	if (msecs < (double) fbLogMinRemoteDuration)
+		return;
+
+	if (fbLogRemoteParameters == true)
+		logged_query = (char *) query;
+	else
+		logged_query = firebirdStatNormalizeQuery(query);
+
+	initStringInfo(&detail);
+
+	for (i = 0; i < nparams; i++)
+	{
+		appendStringInfo(&detail, "%s$%i = ",
+						 i == 0 ? "Parameters: " : ", ",
+						 i + 1);
+
+		if (params == NULL || params[i] == NULL)
+			appendStringInfoString(&detail, "NULL");
+		else if (fbLogRemoteParameters == false)
+			appendStringInfoString(&detail, "<redacted>");
+		else
+			appendStringInfo(&detail, "'%s'", params[i]);
+	}
+
+	/* Only request the plan of a statement which executed successfully */
+	if (fbLogRemotePlan == true &&
+		(FQresultStatus(res) == FBRES_TUPLES_OK || FQresultStatus(res) == FBRES_COMMAND_OK))
+	{
+		char	   *plan = FQexplainStatement(conn, query);
+
+		if (plan != NULL)
+		{
+			if (detail.len > 0)
+				appendStringInfoChar(&detail, '\n');
+			appendStringInfo(&detail, "Firebird plan: %s", plan);
+			free(plan);
+		}
+	}
+
+	if (FQresultStatus(res) == FBRES_TUPLES_OK)
+		ereport(LOG,
+				(errmsg("remote duration: %.3f ms  rows: %i  statement: %s",
+						msecs, FQntuples(res), logged_query),
+				 detail.len > 0 ? errdetail_internal("%s", detail.data) : 0));
+	else
+		ereport(LOG,
+				(errmsg("remote duration: %.3f ms  statement: %s",
+						msecs, logged_query),
+				 detail.len > 0 ? errdetail_internal("%s", detail.data) : 0));
+
+	pfree(detail.data);
+
+	if (logged_query != query)
+		pfree(logged_query);
+}
@@ -0,0 +1,839 @@
+/*-------------------------------------------------------------------------
+ *
+ * Incremental local mirrors of foreign tables for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/mirror.c
+ *
+ * A mirror is a local table holding a copy of a foreign table's data.
+ * When a mirror is created, a trigger is installed on the Firebird table
+ * which records the primary key values of each inserted, updated or
+ * deleted row in a change log table. Synchronising the mirror replaces
+ * only the local rows with the logged key values, so its cost depends on
+ * the number of rows changed rather than the size of the table.
+ *
+ * Key values are logged as text and converted to the types of the local
+ * table's primary key columns. Mirrors are recorded in the table
+ * "firebird_fdw_mirror" in the extension's schema.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "firebird_fdw.h"
+
+#include "catalog/pg_class.h"
+#include "executor/spi.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+
+
+/* Maximum number of changed rows to apply with each local statement */
+#define FIREBIRD_MIRROR_BATCH_SIZE 100
+
+/* Length of the change log table's key value columns */
+#define FIREBIRD_MIRROR_KEY_LENGTH 1000
+
+typedef struct fbMirrorKeyColumn
+{
+	char	   *attname;		/* column name in the local table */
+	char	   *typname;		/* formatted type of the local column */
+	char	   *fb_column;		/* quoted Firebird column name */
+} fbMirrorKeyColumn;
+
+extern Datum firebird_fdw_create_mirror(PG_FUNCTION_ARGS);
+extern Datum firebird_fdw_sync_mirror(PG_FUNCTION_ARGS);
+extern Datum firebird_fdw_drop_mirror(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(firebird_fdw_create_mirror);
+PG_FUNCTION_INFO_V1(firebird_fdw_sync_mirror);
+PG_FUNCTION_INFO_V1(firebird_fdw_drop_mirror);
+
+static char *fbMirrorCatalogName(FunctionCallInfo fcinfo);
+static FBconn *fbMirrorGetConnection(Oid foreign_table);
+static List *fbMirrorGetKeyColumns(Oid foreign_table, Oid local_table);
+static char *fbMirrorGetColumnList(Oid local_table);
+static void fbMirrorCreateLog(FBconn *conn, Oid foreign_table, FirebirdFdwState *fdw_state,
+							  List *key_columns);
+static void fbMirrorDropLog(FBconn *conn, Oid foreign_table);
+static void fbMirrorExecRemote(FBconn *conn, char *query);
+static int64 fbMirrorSync(Oid foreign_table, Oid local_table, Oid remote_id);
+static void fbMirrorApplyBatch(Oid foreign_table, Oid local_table,
+							   List *key_columns, char *column_list,
+							   FBresult *res, int start_row, int end_row);
+
+
+/**
+ * firebird_fdw_create_mirror()
+ *
+ * Create a mirror of the specified foreign table in the specified local
+ * table, which must have a primary key, and copy the foreign table's
+ * current data into it.
+ */
+Datum
+firebird_fdw_create_mirror(PG_FUNCTION_ARGS)
+{
+	Oid			foreign_table = PG_GETARG_OID(0);
+	Oid			local_table = PG_GETARG_OID(1);
+	char	   *catalog = fbMirrorCatalogName(fcinfo);
+	FirebirdFdwState *fdw_state;
+	ForeignTable *table;
+	ForeignServer *server;
+	UserMapping *user;
+	FBconn	   *conn;
+	List	   *key_columns;
+	StringInfoData buf;
+	Oid			argtypes[3] = {OIDOID, OIDOID, OIDOID};
+	Datum		values[3];
+	char	   *column_list;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	if (get_rel_relkind(foreign_table) != RELKIND_FOREIGN_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a foreign table",
+						get_rel_name(foreign_table))));
+
+	if (get_rel_relkind(local_table) != RELKIND_RELATION &&
+		get_rel_relkind(local_table) != RELKIND_PARTITIONED_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table",
+						get_rel_name(local_table))));
+
+	fdw_state = getFdwState(foreign_table);
+
+	if (fdw_state->svr_query != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("unable to create a mirror of foreign table \"%s\"",
+						get_rel_name(foreign_table)),
+				 errdetail("Foreign tables defined with the \"query\" option cannot be mirrored.")));
+
+	if (fdw_state->svr_procedure != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("unable to create a mirror of foreign table \"%s\"",
+						get_rel_name(foreign_table)),
+				 errdetail("Foreign tables defined with the \"procedure\" option cannot be mirrored.")));
+
+	SPI_connect();
+
+	/* Check the foreign table is not already mirrored */
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "SELECT 1 FROM %s WHERE foreign_table = $1",
+					 catalog);
+
+	values[0] = ObjectIdGetDatum(foreign_table);
+
+	if (SPI_execute_with_args(buf.data, 1, argtypes, values, NULL, true, 1) != SPI_OK_SELECT)
+		elog(ERROR, "unable to query \"%s\"", catalog);
+
+	if (SPI_processed > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DUPLICATE_OBJECT),
+				 errmsg("foreign table \"%s\" is already mirrored",
+						get_rel_name(foreign_table))));
+
+	/* Existing local data would be indistinguishable from the copy */
+	resetStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "SELECT 1 FROM %s LIMIT 1",
+					 quote_qualified_identifier(get_namespace_name(get_rel_namespace(local_table)),
+												get_rel_name(local_table)));
+
+	if (SPI_execute(buf.data, true, 1) != SPI_OK_SELECT)
+		elog(ERROR, "unable to execute \"%s\"", buf.data);
+
+	if (SPI_processed > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("unable to create a mirror of foreign table \"%s\"",
+						get_rel_name(foreign_table)),
+				 errdetail("Local table \"%s\" is not empty.",
+						   get_rel_name(local_table)),
+				 errhint("Remove the existing rows from the local table before creating the mirror.")));
+
+	key_columns = fbMirrorGetKeyColumns(foreign_table, local_table);
+	column_list = fbMirrorGetColumnList(local_table);
+
+	/*
+	 * The copy is read in the remote transaction's snapshot, which must
+	 * begin after the change log trigger is committed, so that changes
+	 * are either contained in the copy or logged.
+	 */
+	table = GetForeignTable(foreign_table);
+	server = GetForeignServer(table->serverid);
+	user = GetUserMapping(GetUserId(), server->serverid);
+
+	if (firebirdConnectionInTransaction(server, user))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("unable to create a mirror of foreign table \"%s\"",
+						get_rel_name(foreign_table)),
+				 errdetail("Foreign server \"%s\" has already been accessed in the current transaction.",
+						   server->servername),
+				 errhint("Create the mirror in a separate transaction.")));
+
+	/*
+	 * The change log objects are created on a separate connection in
+	 * autocommit mode, so they are committed before the copy is made.
+	 */
+	conn = firebirdOpenConnection(server, user);
+	FQsetAutocommit(conn, true);
+
+	PG_TRY();
+	{
+		fbMirrorCreateLog(conn, foreign_table, fdw_state, key_columns);
+
+		/* Copy the foreign table's current data */
+		resetStringInfo(&buf);
+		appendStringInfo(&buf,
+						 "INSERT INTO %s (%s) SELECT %s FROM %s",
+						 quote_qualified_identifier(get_namespace_name(get_rel_namespace(local_table)),
+													get_rel_name(local_table)),
+						 column_list,
+						 column_list,
+						 quote_qualified_identifier(get_namespace_name(get_rel_namespace(foreign_table)),
+													get_rel_name(foreign_table)));
+
+		if (SPI_execute(buf.data, false, 0) != SPI_OK_INSERT)
+			elog(ERROR, "unable to execute \"%s\"", buf.data);
+
+		/* Record the mirror */
+		resetStringInfo(&buf);
+		appendStringInfo(&buf,
+						 "INSERT INTO %s (foreign_table, local_table, remote_id) VALUES ($1, $2, $3)",
+						 catalog);
+
+		values[0] = ObjectIdGetDatum(foreign_table);
+		values[1] = ObjectIdGetDatum(local_table);
+		values[2] = ObjectIdGetDatum(foreign_table);
+
+		if (SPI_execute_with_args(buf.data, 3, argtypes, values, NULL, false, 0) != SPI_OK_INSERT)
+			elog(ERROR, "unable to insert into \"%s\"", catalog);
+	}
+	PG_CATCH();
+	{
+		fbMirrorDropLog(conn, foreign_table);
+		FQfinish(conn);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	FQfinish(conn);
+
+	SPI_finish();
+
+	PG_RETURN_VOID();
+}
+
+
+/**
+ * firebird_fdw_sync_mirror()
+ *
+ * Apply changes logged since the previous synchronisation to the mirror
+ * of the specified foreign table, or to all mirrors if NULL is provided.
+ * Returns the number of changed rows applied.
+ */
+Datum
+firebird_fdw_sync_mirror(PG_FUNCTION_ARGS)
+{
+	char	   *catalog = fbMirrorCatalogName(fcinfo);
+	StringInfoData buf;
+	Oid			argtypes[1] = {OIDOID};
+	Datum		values[1];
+	int			nmirrors;
+	Oid		   *mirrors;
+	int64		total = 0;
+	int			i;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	SPI_connect();
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "SELECT foreign_table, local_table, remote_id FROM %s",
+					 catalog);
+
+	if (PG_ARGISNULL(0))
+	{
+		appendStringInfoString(&buf, " ORDER BY foreign_table");
+
+		if (SPI_execute(buf.data, true, 0) != SPI_OK_SELECT)
+			elog(ERROR, "unable to query \"%s\"", catalog);
+	}
+	else
+	{
+		appendStringInfoString(&buf, " WHERE foreign_table = $1");
+
+		values[0] = PG_GETARG_DATUM(0);
+
+		if (SPI_execute_with_args(buf.data, 1, argtypes, values, NULL, true, 0) != SPI_OK_SELECT)
+			elog(ERROR, "unable to query \"%s\"", catalog);
+
+		if (SPI_processed == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("foreign table \"%s\" is not mirrored",
+							get_rel_name(PG_GETARG_OID(0)))));
+	}
+
+	/* Copy the mirror definitions, as the tuple table will be overwritten */
+	nmirrors = (int) SPI_processed;
+	mirrors = (Oid *) palloc(sizeof(Oid) * 3 * Max(nmirrors, 1));
+
+	for (i = 0; i < nmirrors; i++)
+	{
+		int			col;
+
+		for (col = 0; col < 3; col++)
+		{
+			bool		isnull;
+
+			mirrors[i * 3 + col] = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[i],
+																   SPI_tuptable->tupdesc,
+																   col + 1,
+																   &isnull));
+		}
+	}
+
+	for (i = 0; i < nmirrors; i++)
+		total += fbMirrorSync(mirrors[i * 3],
+							  mirrors[i * 3 + 1],
+							  mirrors[i * 3 + 2]);
+
+	SPI_finish();
+
+	PG_RETURN_INT64(total);
+}
+
+
+/**
+ * firebird_fdw_drop_mirror()
+ *
+ * Remove the Firebird change log objects of the specified foreign table's
+ * mirror. The local table itself is not modified.
+ */
+Datum
+firebird_fdw_drop_mirror(PG_FUNCTION_ARGS)
+{
+	Oid			foreign_table = PG_GETARG_OID(0);
+	char	   *catalog = fbMirrorCatalogName(fcinfo);
+	StringInfoData buf;
+	Oid			argtypes[1] = {OIDOID};
+	Datum		values[1];
+	Oid			remote_id;
+	bool		isnull;
+	FBconn	   *conn;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	SPI_connect();
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "DELETE FROM %s WHERE foreign_table = $1 RETURNING remote_id",
+					 catalog);
+
+	values[0] = ObjectIdGetDatum(foreign_table);
+
+	if (SPI_execute_with_args(buf.data, 1, argtypes, values, NULL, false, 0) != SPI_OK_DELETE_RETURNING)
+		elog(ERROR, "unable to delete from \"%s\"", catalog);
+
+	if (SPI_processed == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("foreign table \"%s\" is not mirrored",
+						get_rel_name(foreign_table))));
+
+	remote_id = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[0],
+											   SPI_tuptable->tupdesc,
+											   1,
+											   &isnull));
+
+	conn = fbMirrorGetConnection(foreign_table);
+
+	resetStringInfo(&buf);
+	appendStringInfo(&buf, "DROP TRIGGER FBFDW_TRG_%u", remote_id);
+	fbMirrorExecRemote(conn, buf.data);
+
+	resetStringInfo(&buf);
+	appendStringInfo(&buf, "DROP TABLE FBFDW_LOG_%u", remote_id);
+	fbMirrorExecRemote(conn, buf.data);
+
+	resetStringInfo(&buf);
+	appendStringInfo(&buf, "DROP SEQUENCE FBFDW_SEQ_%u", remote_id);
+	fbMirrorExecRemote(conn, buf.data);
+
+	SPI_finish();
+
+	PG_RETURN_VOID();
+}
+
+
+/**
+ * fbMirrorCatalogName()
+ *
+ * Return the qualified name of the table recording mirrors, which is
+ * in the same schema as the calling function.
+ */
+static char *
+fbMirrorCatalogName(FunctionCallInfo fcinfo)
+{
+	Oid			nspid = get_func_namespace(fcinfo->flinfo->fn_oid);
+
+	return psprintf("%s.firebird_fdw_mirror",
+					quote_identifier(get_namespace_name(nspid)));
+}
+
+
+/**
+ * fbMirrorGetConnection()
+ *
+ * Return a connection to the server of the specified foreign table.
+ * Statements executed on it form part of the remote transaction, and are
+ * committed or rolled back with the local transaction.
+ */
+static FBconn *
+fbMirrorGetConnection(Oid foreign_table)
+{
+	ForeignTable *table = GetForeignTable(foreign_table);
+	ForeignServer *server = GetForeignServer(table->serverid);
+	UserMapping *user = GetUserMapping(GetUserId(), server->serverid);
+	FBconn	   *conn = firebirdInstantiateConnection(server, user);
+
+	if (FQstatus(conn) != CONNECTION_OK)
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_ESTABLISH_CONNECTION),
+				 errmsg("unable to connect to foreign server \"%s\"",
+						server->servername)));
+
+	return conn;
+}
+
+
+/**
+ * fbMirrorGetKeyColumns()
+ *
+ * Return the primary key columns of the local table, together with the
+ * corresponding Firebird column names of the foreign table.
+ *
+ * Must be called after SPI_connect().
+ */
+static List *
+fbMirrorGetKeyColumns(Oid foreign_table, Oid local_table)
+{
+	const char *query =
+		"    SELECT a.attname::pg_catalog.text, \n"
+		"           pg_catalog.format_type(a.atttypid, a.atttypmod) \n"
+		"      FROM pg_catalog.pg_index i \n"
+		"INNER JOIN pg_catalog.pg_attribute a \n"
+		"        ON (a.attrelid = i.indrelid AND a.attnum = ANY (i.indkey)) \n"
+		"     WHERE i.indrelid = $1 \n"
+		"       AND i.indisprimary \n"
+		"  ORDER BY a.attnum";
+	Oid			argtypes[1] = {OIDOID};
+	Datum		values[1];
+	List	   *key_columns = NIL;
+	FirebirdFdwState *fdw_state = getFdwState(foreign_table);
+	uint64		row;
+
+	values[0] = ObjectIdGetDatum(local_table);
+
+	if (SPI_execute_with_args(query, 1, argtypes, values, NULL, true, 0) != SPI_OK_SELECT)
+		elog(ERROR, "unable to query primary key of \"%s\"",
+			 get_rel_name(local_table));
+
+	if (SPI_processed == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("table \"%s\" has no primary key",
+						get_rel_name(local_table)),
+				 errhint("The primary key columns are used to identify changed rows.")));
+
+	for (row = 0; row < SPI_processed; row++)
+	{
+		fbMirrorKeyColumn *key_column = palloc0(sizeof(fbMirrorKeyColumn));
+		AttrNumber	attnum;
+		StringInfoData fb_column;
+
+		key_column->attname = SPI_getvalue(SPI_tuptable->vals[row], SPI_tuptable->tupdesc, 1);
+		key_column->typname = SPI_getvalue(SPI_tuptable->vals[row], SPI_tuptable->tupdesc, 2);
+
+		attnum = get_attnum(foreign_table, key_column->attname);
+
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("foreign table \"%s\" has no column \"%s\"",
+							get_rel_name(foreign_table),
+							key_column->attname),
+					 errdetail("The primary key columns of the local table must also exist in the foreign table.")));
+
+		initStringInfo(&fb_column);
+		convertColumnRef(&fb_column, foreign_table, attnum, fdw_state->quote_identifier);
+		key_column->fb_column = fb_column.data;
+
+		key_columns = lappend(key_columns, key_column);
+	}
+
+	return key_columns;
+}
+
+
+/**
+ * fbMirrorGetColumnList()
+ *
+ * Return a comma-separated list of the local table's columns, which are
+ * copied from the corresponding foreign table columns.
+ */
+static char *
+fbMirrorGetColumnList(Oid local_table)
+{
+	Relation	rel = table_open(local_table, AccessShareLock);
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	StringInfoData buf;
+	bool		first = true;
+	int			i;
+
+	initStringInfo(&buf);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped)
+			continue;
+
+		if (!first)
+			appendStringInfoString(&buf, ", ");
+		first = false;
+
+		appendStringInfoString(&buf, quote_identifier(NameStr(att->attname)));
+	}
+
+	table_close(rel, AccessShareLock);
+
+	return buf.data;
+}
+
+
+/**
+ * fbMirrorCreateLog()
+ *
+ * Create the Firebird change log table, sequence and trigger of the
+ * specified foreign table's mirror on "conn".
+ */
+static void
+fbMirrorCreateLog(FBconn *conn, Oid foreign_table, FirebirdFdwState *fdw_state,
+				  List *key_columns)
+{
+	StringInfoData buf;
+	ListCell   *lc;
+	int			i;
+
+	initStringInfo(&buf);
+
+	/*
+	 * Create the Firebird change log table, sequence and trigger; the
+	 * foreign table's OID is used to generate unique object names.
+	 */
+	appendStringInfo(&buf,
+					 "CREATE TABLE FBFDW_LOG_%u (SEQ BIGINT NOT NULL",
+					 foreign_table);
+
+	for (i = 1; i <= list_length(key_columns); i++)
+		appendStringInfo(&buf,
+						 ", KEY_%i VARCHAR(%i) CHARACTER SET UTF8",
+						 i,
+						 FIREBIRD_MIRROR_KEY_LENGTH);
+
+	appendStringInfoChar(&buf, ')');
+
+	fbMirrorExecRemote(conn, buf.data);
+
+	resetStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "CREATE SEQUENCE FBFDW_SEQ_%u",
+					 foreign_table);
+
+	fbMirrorExecRemote(conn, buf.data);
+
+	resetStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "CREATE TRIGGER FBFDW_TRG_%u FOR %s\n"
+					 "AFTER INSERT OR UPDATE OR DELETE\n"
+					 "AS\n"
+					 "BEGIN\n",
+					 foreign_table,
+					 quote_fb_identifier(fdw_state->svr_table,
+										 fdw_state->quote_identifier));
+
+	for (i = 0; i < 2; i++)
+	{
+		const char *row = (i == 0) ? "OLD" : "NEW";
+		int			key;
+
+		appendStringInfo(&buf,
+						 "  IF (%s) THEN\n"
+						 "    INSERT INTO FBFDW_LOG_%u (SEQ",
+						 (i == 0) ? "UPDATING OR DELETING" : "INSERTING OR UPDATING",
+						 foreign_table);
+
+		for (key = 1; key <= list_length(key_columns); key++)
+			appendStringInfo(&buf, ", KEY_%i", key);
+
+		appendStringInfo(&buf,
+						 ")\n"
+						 "    VALUES (NEXT VALUE FOR FBFDW_SEQ_%u",
+						 foreign_table);
+
+		foreach(lc, key_columns)
+		{
+			fbMirrorKeyColumn *key_column = (fbMirrorKeyColumn *) lfirst(lc);
+
+			appendStringInfo(&buf,
+							 ", CAST(%s.%s AS VARCHAR(%i))",
+							 row,
+							 key_column->fb_column,
+							 FIREBIRD_MIRROR_KEY_LENGTH);
+		}
+
+		appendStringInfoString(&buf, ");\n");
+	}
+
+	appendStringInfoString(&buf, "END");
+
+	fbMirrorExecRemote(conn, buf.data);
+}
+
+
+/**
+ * fbMirrorDropLog()
+ *
+ * Remove any of the Firebird change log objects of the specified foreign
+ * table's mirror from "conn", which must be in autocommit mode, after
+ * its creation failed. Errors are ignored, as not all objects may exist.
+ */
+static void
+fbMirrorDropLog(FBconn *conn, Oid foreign_table)
+{
+	char	   *query;
+
+	query = psprintf("DROP TRIGGER FBFDW_TRG_%u", foreign_table);
+	FQclear(FQexec(conn, query));
+
+	query = psprintf("DROP TABLE FBFDW_LOG_%u", foreign_table);
+	FQclear(FQexec(conn, query));
+
+	query = psprintf("DROP SEQUENCE FBFDW_SEQ_%u", foreign_table);
+	FQclear(FQexec(conn, query));
+}
+
+
+/**
+ * fbMirrorExecRemote()
+ *
+ * Execute a statement returning no rows on Firebird.
+ */
+static void
+fbMirrorExecRemote(FBconn *conn, char *query)
+{
+	FBresult   *res;
+
+	elog(DEBUG2, "remote statement:\n%s", query);
+
+	res = FQexec(conn, query);
+
+	if (FQresultStatus(res) != FBRES_COMMAND_OK)
+		fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, query);
+
+	FQclear(res);
+}
+
+
+/**
+ * fbMirrorSync()
+ *
+ * Apply changes logged since the previous synchronisation to a single
+ * mirror, and remove the applied entries from the change log.
+ *
+ * As the remote transaction uses snapshot isolation, log entries
+ * committed by other transactions after it started are neither seen
+ * nor removed, and will be applied by the next synchronisation.
+ */
+static int64
+fbMirrorSync(Oid foreign_table, Oid local_table, Oid remote_id)
+{
+	List	   *key_columns = fbMirrorGetKeyColumns(foreign_table, local_table);
+	char	   *column_list = fbMirrorGetColumnList(local_table);
+	FBconn	   *conn = fbMirrorGetConnection(foreign_table);
+	FBresult   *res;
+	StringInfoData buf;
+	char	   *max_seq;
+	int			nrows;
+	int			row;
+	int			i;
+
+	elog(DEBUG2, "entering function %s", __func__);
+
+	/*
+	 * Cached results of the foreign table would not reflect the changes;
+	 * the foreign table itself has not been modified, so the cache need
+	 * not be bypassed for the rest of the transaction.
+	 */
+	(void) firebirdCacheInvalidate(foreign_table);
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "SELECT MAX(SEQ) FROM FBFDW_LOG_%u",
+					 remote_id);
+
+	res = FQexec(conn, buf.data);
+
+	if (FQresultStatus(res) != FBRES_TUPLES_OK)
+		fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, buf.data);
+
+	if (FQntuples(res) == 0 || FQgetisnull(res, 0, 0))
+	{
+		FQclear(res);
+		return 0;
+	}
+
+	max_seq = pstrdup(FQgetvalue(res, 0, 0));
+	FQclear(res);
+
+	/* Fetch the key values of changed rows */
+	resetStringInfo(&buf);
+	appendStringInfoString(&buf, "SELECT DISTINCT ");
+
+	for (i = 1; i <= list_length(key_columns); i++)
+		appendStringInfo(&buf, "%sKEY_%i", (i > 1) ? ", " : "", i);
+
+	appendStringInfo(&buf,
+					 " FROM FBFDW_LOG_%u WHERE SEQ <= %s",
+					 remote_id,
+					 max_seq);
+
+	res = FQexec(conn, buf.data);
+
+	if (FQresultStatus(res) != FBRES_TUPLES_OK)
+		fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, buf.data);
+
+	nrows = FQntuples(res);
+
+	PG_TRY();
+	{
+		for (row = 0; row < nrows; row += FIREBIRD_MIRROR_BATCH_SIZE)
+			fbMirrorApplyBatch(foreign_table, local_table,
+							   key_columns, column_list,
+							   res, row, Min(row + FIREBIRD_MIRROR_BATCH_SIZE, nrows));
+	}
+	PG_CATCH();
+	{
+		FQclear(res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	FQclear(res);
+
+	/* Remove the applied log entries */
+	resetStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "DELETE FROM FBFDW_LOG_%u WHERE SEQ <= %s",
+					 remote_id,
+					 max_seq);
+
+	fbMirrorExecRemote(conn, buf.data);
+
+	elog(DEBUG2, "%s: %i changed rows applied to \"%s\"",
+		 __func__, nrows, get_rel_name(local_table));
+
+	return (int64) nrows;
+}
+
+
+/**
+ * fbMirrorApplyBatch()
+ *
+ * Replace the local table's rows having the key values in rows
+ * "start_row" to "end_row" (exclusive) of "res" with the foreign table's
+ * current rows, if any, with those key values.
+ *
+ * The key values are embedded as constants, so the condition is pushed
+ * down to Firebird when fetching the current rows.
+ */
+static void
+fbMirrorApplyBatch(Oid foreign_table, Oid local_table,
+				   List *key_columns, char *column_list,
+				   FBresult *res, int start_row, int end_row)
+{
+	StringInfoData where;
+	StringInfoData buf;
+	int			row;
+
+	initStringInfo(&where);
+
+	for (row = start_row; row < end_row; row++)
+	{
+		ListCell   *lc;
+		int			col = 0;
+
+		appendStringInfoString(&where, (row > start_row) ? " OR (" : "(");
+
+		foreach(lc, key_columns)
+		{
+			fbMirrorKeyColumn *key_column = (fbMirrorKeyColumn *) lfirst(lc);
+
+			if (col > 0)
+				appendStringInfoString(&where, " AND ");
+
+			appendStringInfo(&where,
+							 "%s = CAST(%s AS %s)",
+							 quote_identifier(key_column->attname),
+							 quote_literal_cstr(FQgetvalue(res, row, col)),
+							 key_column->typname);
+			col++;
+		}
+
+		appendStringInfoChar(&where, ')');
+	}
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "DELETE FROM %s WHERE %s",
+					 quote_qualified_identifier(get_namespace_name(get_rel_namespace(local_table)),
+												get_rel_name(local_table)),
+					 where.data);
+
+	if (SPI_execute(buf.data, false, 0) != SPI_OK_DELETE)
+		elog(ERROR, "unable to execute \"%s\"", buf.data);
+
+	resetStringInfo(&buf);
+	appendStringInfo(&buf,
+					 "INSERT INTO %s (%s) SELECT %s FROM %s WHERE %s",
+					 quote_qualified_identifier(get_namespace_name(get_rel_namespace(local_table)),
+												get_rel_name(local_table)),
+					 column_list,
+					 column_list,
+					 quote_qualified_identifier(get_namespace_name(get_rel_namespace(foreign_table)),
+												get_rel_name(foreign_table)),
+					 where.data);
+
+	if (SPI_execute(buf.data, false, 0) != SPI_OK_INSERT)
+		elog(ERROR, "unable to execute \"%s\"", buf.data);
+
+	pfree(where.data);
+	pfree(buf.data);
+}
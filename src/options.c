@@ -36,6 +36,8 @@ static struct FirebirdFdwOption valid_options[] =
 	{ "updatable",			 ForeignServerRelationId },
 	{ "quote_identifiers",	 ForeignServerRelationId },
 	{ "implicit_bool_type",	 ForeignServerRelationId },
+	{ "external_file_directory", ForeignServerRelationId },
+	{ "trusted_encoding",	 ForeignServerRelationId },
 #if (PG_VERSION_NUM >= 140000)
 	{ "batch_size",			 ForeignServerRelationId },
 	{ "truncatable",		 ForeignServerRelationId },
@@ -50,6 +52,8 @@ static struct FirebirdFdwOption valid_options[] =
 	{ "updatable",			 ForeignTableRelationId	 },
 	{ "estimated_row_count", ForeignTableRelationId	 },
 	{ "quote_identifier",	 ForeignTableRelationId	 },
+	{ "cache_ttl",			 ForeignTableRelationId	 },
+	{ "procedure",			 ForeignTableRelationId	 },
 #if (PG_VERSION_NUM >= 140000)
 	{ "batch_size",			 ForeignTableRelationId  },
 	{ "truncatable",		 ForeignTableRelationId  },
@@ -58,6 +62,8 @@ static struct FirebirdFdwOption valid_options[] =
 	{ "column_name",		 AttributeRelationId	 },
 	{ "quote_identifier",	 AttributeRelationId	 },
 	{ "implicit_bool_type",	 AttributeRelationId	 },
+	{ "procedure_parameter", AttributeRelationId	 },
+	{ "query_parameter",	 AttributeRelationId	 },
 	{ NULL,					 InvalidOid }
 };
 
@@ -89,13 +95,19 @@ firebird_fdw_validator(PG_FUNCTION_ARGS)
 	char		*svr_database = NULL;
 	char		*svr_query = NULL;
 	char		*svr_table = NULL;
+	char		*svr_procedure = NULL;
+	char		*external_file_directory = NULL;
 #if (PG_VERSION_NUM >= 140000)
 	int			svr_batch_size = NO_BATCH_SIZE_SPECIFIED;
 	bool		truncatable_set = false;
 #endif
 
 	bool		 disable_pushdowns_set = false;
+	bool		 trusted_encoding_set = false;
 	bool		 updatable_set = false;
+	int			 cache_ttl = -1;
+	int			 procedure_parameter = -1;
+	bool		 query_parameter_set = false;
 
 	elog(DEBUG2, "entering function %s", __func__);
 
@@ -204,6 +216,11 @@ firebird_fdw_validator(PG_FUNCTION_ARGS)
 						(errcode(ERRCODE_SYNTAX_ERROR),
 						 errmsg("conflicting options: 'query' cannot be used with 'table_name'")));
 
+			if (svr_procedure)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting options: 'query' cannot be used with 'procedure'")));
+
 			if (svr_query)
 				ereport(ERROR,
 						(errcode(ERRCODE_SYNTAX_ERROR),
@@ -219,6 +236,11 @@ firebird_fdw_validator(PG_FUNCTION_ARGS)
 					errmsg("conflicting options: table cannot be used with query")
 					));
 
+			if (svr_procedure)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting options: 'table_name' cannot be used with 'procedure'")));
+
 			if (svr_table)
 				ereport(ERROR,
 						(errcode(ERRCODE_SYNTAX_ERROR),
@@ -226,6 +248,65 @@ firebird_fdw_validator(PG_FUNCTION_ARGS)
 
 			svr_table = defGetString(def);
 		}
+		else if (strcmp(def->defname, "procedure") == 0)
+		{
+			if (svr_query || svr_table)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting options: 'procedure' cannot be used with 'query' or 'table_name'")));
+
+			if (svr_procedure)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options: procedure (%s)", defGetString(def))));
+
+			svr_procedure = defGetString(def);
+		}
+		else if (strcmp(def->defname, "query_parameter") == 0)
+		{
+			const char *name = defGetString(def);
+			const char *ptr;
+
+			if (query_parameter_set)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("redundant option: \"query_parameter\" set more than once")));
+
+			query_parameter_set = true;
+
+			for (ptr = name; *ptr != '\0'; ptr++)
+			{
+				if (!(isalpha((unsigned char) *ptr) || *ptr == '_' ||
+					  (ptr > name && (isdigit((unsigned char) *ptr) || *ptr == '$'))))
+					break;
+			}
+
+			if (ptr == name || *ptr != '\0')
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("invalid \"query_parameter\" value \"%s\"", name),
+						 errhint("Placeholder names must begin with a letter or underscore, followed by letters, digits, underscores or dollar signs.")));
+		}
+		else if (strcmp(def->defname, "procedure_parameter") == 0)
+		{
+			if (procedure_parameter != -1)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("redundant option: \"procedure_parameter\" set more than once")));
+
+			if (parse_int(defGetString(def), &procedure_parameter, 0, NULL) == false)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("an error was encountered when parsing the provided \"procedure_parameter\" value")));
+			}
+			else if (procedure_parameter < 1)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"procedure_parameter\" must have a value of 1 or greater")));
+			}
+		}
 		else if (strcmp(def->defname, "disable_pushdowns") == 0)
 		{
 			if (disable_pushdowns_set)
@@ -236,6 +317,16 @@ firebird_fdw_validator(PG_FUNCTION_ARGS)
 
 			disable_pushdowns_set = true;
 		}
+		else if (strcmp(def->defname, "trusted_encoding") == 0)
+		{
+			if (trusted_encoding_set)
+				ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("redundant option: 'trusted_encoding' set more than once")));
+			(void) defGetBoolean(def);
+
+			trusted_encoding_set = true;
+		}
 		else if (strcmp(def->defname, "updatable") == 0)
 		{
 			bool updatable;
@@ -253,6 +344,45 @@ firebird_fdw_validator(PG_FUNCTION_ARGS)
 				ereport(ERROR,
 						(errcode(ERRCODE_SYNTAX_ERROR),
 						 errmsg("foreign tables defined with the \"query\" option cannot be set as \"updatable\"")));
+
+			if (svr_procedure && updatable == true)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("foreign tables defined with the \"procedure\" option cannot be set as \"updatable\"")));
+		}
+		else if (strcmp(def->defname, "external_file_directory") == 0)
+		{
+			if (external_file_directory)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("redundant option: \"external_file_directory\" set more than once")));
+
+			external_file_directory = defGetString(def);
+
+			if (!is_absolute_path(external_file_directory))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"external_file_directory\" must be an absolute path")));
+		}
+		else if (strcmp(def->defname, "cache_ttl") == 0)
+		{
+			if (cache_ttl != -1)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("redundant option: \"cache_ttl\" set more than once")));
+
+			if (parse_int(defGetString(def), &cache_ttl, 0, NULL) == false)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("an error was encountered when parsing the provided \"cache_ttl\" value")));
+			}
+			else if (cache_ttl < 0)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("\"cache_ttl\" must have a value of 0 or greater")));
+			}
 		}
 #if (PG_VERSION_NUM >= 140000)
 		else if (strcmp(def->defname, "batch_size") == 0)
@@ -382,6 +512,20 @@ firebirdGetServerOptions(ForeignServer *server,
 			options->implicit_bool_type.provided = true;
 			continue;
 		}
+
+		if (options->external_file_directory.opt.strptr != NULL && strcmp(def->defname, "external_file_directory") == 0)
+		{
+			*options->external_file_directory.opt.strptr = defGetString(def);
+			options->external_file_directory.provided = true;
+			continue;
+		}
+
+		if (options->trusted_encoding.opt.boolptr != NULL && strcmp(def->defname, "trusted_encoding") == 0)
+		{
+			*options->trusted_encoding.opt.boolptr = defGetBoolean(def);
+			options->trusted_encoding.provided = true;
+			continue;
+		}
 #if (PG_VERSION_NUM >= 140000)
 		if (options->batch_size.opt.intptr != NULL && strcmp(def->defname, "batch_size") == 0 )
 		{
@@ -412,6 +556,7 @@ firebirdGetTableOptions(ForeignTable *table,
 						fbTableOptions *options)
 {
 	ListCell	  *lc;
+	bool		   have_procedure = false;
 
 	foreach (lc, table->options)
 	{
@@ -419,6 +564,18 @@ firebirdGetTableOptions(ForeignTable *table,
 
 		elog(DEBUG3, "table option: \"%s\"", def->defname);
 
+		if (strcmp(def->defname, "procedure") == 0)
+		{
+			have_procedure = true;
+
+			if (options->procedure.opt.strptr != NULL)
+			{
+				*options->procedure.opt.strptr = defGetString(def);
+				options->procedure.provided = true;
+			}
+			continue;
+		}
+
 		/* table-level options */
 		if (options->query.opt.strptr != NULL && strcmp(def->defname, "query") == 0)
 		{
@@ -455,6 +612,13 @@ firebirdGetTableOptions(ForeignTable *table,
 			continue;
 		}
 
+		if (options->cache_ttl.opt.intptr != NULL && strcmp(def->defname, "cache_ttl") == 0)
+		{
+			*options->cache_ttl.opt.intptr = strtod(defGetString(def), NULL);
+			options->cache_ttl.provided = true;
+			continue;
+		}
+
 #if (PG_VERSION_NUM >= 140000)
 		if (options->batch_size.opt.intptr != NULL && strcmp(def->defname, "batch_size") == 0 )
 		{
@@ -473,10 +637,11 @@ firebirdGetTableOptions(ForeignTable *table,
 	}
 
 	/*
-	 * If no query and no table name specified, default to the PostgreSQL
-	 * table name.
+	 * If no query, procedure or table name specified, default to the
+	 * PostgreSQL table name.
 	 */
-	if (options->table_name.opt.strptr != NULL && options->query.opt.strptr != NULL)
+	if (options->table_name.opt.strptr != NULL && options->query.opt.strptr != NULL
+		&& have_procedure == false)
 	{
 		if (!*options->table_name.opt.strptr && !*options->query.opt.strptr)
 			*options->table_name.opt.strptr = get_rel_name(table->relid);
@@ -514,5 +679,17 @@ firebirdGetColumnOptions(Oid foreigntableid, int varattno,
 			*options->implicit_bool_type = defGetBoolean(def);
 			continue;
 		}
+
+		if (options->procedure_parameter != NULL && strcmp(def->defname, "procedure_parameter") == 0)
+		{
+			*options->procedure_parameter = strtod(defGetString(def), NULL);
+			continue;
+		}
+
+		if (options->query_parameter != NULL && strcmp(def->defname, "query_parameter") == 0)
+		{
+			*options->query_parameter = defGetString(def);
+			continue;
+		}
 	}
 }
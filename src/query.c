@@ -0,0 +1,252 @@
+/*-------------------------------------------------------------------------
+ *
+ * Ad-hoc remote queries for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/query.c
+ *
+ * firebird_fdw_query() executes an arbitrary Firebird statement on a
+ * foreign server and returns its result as a set of records, without a
+ * foreign table needing to be defined.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "firebird_fdw.h"
+
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+
+
+typedef struct fbQueryState
+{
+	FBresult   *res;
+	int			nfields;
+	AttInMetadata *attinmeta;
+} fbQueryState;
+
+extern Datum firebird_fdw_query(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(firebird_fdw_query);
+
+static void fbQueryRelease(void *arg);
+static bool fbQueryIsSelect(const char *query);
+
+
+/**
+ * firebird_fdw_query()
+ *
+ * Execute a statement on the named server, with any parameters bound to
+ * its "?" placeholders, and return the result rows.
+ *
+ * The statement is executed on the server's cached connection, and
+ * therefore in the same remote transaction as foreign table operations.
+ * As for foreign table modifications, any statement other than a query
+ * causes cached results for the server's tables to be discarded.
+ * Rows are built one per call from the Firebird result, which is held
+ * until the function's multi-call context is reset.
+ */
+Datum
+firebird_fdw_query(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	fbQueryState *state;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		char	   *server_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+		char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(1));
+		ArrayType  *params = PG_GETARG_ARRAYTYPE_P(2);
+		ForeignServer *server;
+		UserMapping *user;
+		FBconn	   *conn;
+		FBresult   *res;
+		TupleDesc	tupdesc;
+		MemoryContext oldcontext;
+		MemoryContextCallback *cb;
+		Datum	   *param_datums;
+		bool	   *param_nulls;
+		char	  **param_values;
+		int			nparams;
+		int			i;
+
+		elog(DEBUG2, "entering function %s", __func__);
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("a column definition list is required for firebird_fdw_query()")));
+
+		deconstruct_array(params, TEXTOID, -1, false, 'i',
+						  &param_datums, &param_nulls, &nparams);
+
+		param_values = (char **) palloc0(sizeof(char *) * (nparams + 1));
+
+		for (i = 0; i < nparams; i++)
+		{
+			if (param_nulls[i] == false)
+				param_values[i] = TextDatumGetCString(param_datums[i]);
+		}
+
+		server = GetForeignServerByName(server_name, false);
+		firebirdCheckServerUsage(server);
+
+		user = GetUserMapping(GetUserId(), server->serverid);
+		conn = firebirdInstantiateConnection(server, user);
+
+		elog(DEBUG1, "ad-hoc query:\n%s", query);
+
+		/*
+		 * The tables the statement affects are not known, so discard all
+		 * cached results if it may modify data.
+		 */
+		if (!fbQueryIsSelect(query))
+			firebirdCacheNoteModification(InvalidOid);
+
+		firebirdWaitStart(FB_WAIT_EXECUTE);
+
+		if (nparams > 0)
+			res = FQexecParams(conn,
+							   query,
+							   nparams,
+							   NULL,
+							   (const char **) param_values,
+							   NULL,
+							   NULL,
+							   0);
+		else
+			res = FQexec(conn, query);
+
+		firebirdWaitEnd();
+
+		firebirdConnectionNoteStatement(conn, strlen(query), res);
+
+		if (FQresultStatus(res) != FBRES_TUPLES_OK)
+			fbfdw_report_error(ERROR, ERRCODE_FDW_ERROR, res, conn, query);
+
+		state = (fbQueryState *) palloc0(sizeof(fbQueryState));
+		state->res = res;
+		state->nfields = FQnfields(res);
+
+		/* Ensure the result is freed even if the scan is not completed */
+		cb = (MemoryContextCallback *) palloc(sizeof(MemoryContextCallback));
+		cb->func = fbQueryRelease;
+		cb->arg = (void *) state;
+		MemoryContextRegisterResetCallback(funcctx->multi_call_memory_ctx, cb);
+
+		if (state->nfields != tupdesc->natts)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("query returns %i columns, but the column definition list has %i columns",
+							state->nfields, tupdesc->natts)));
+
+		state->attinmeta = TupleDescGetAttInMetadata(tupdesc);
+
+		funcctx->max_calls = FQntuples(res);
+		funcctx->user_fctx = (void *) state;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	state = (fbQueryState *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		int			row = (int) funcctx->call_cntr;
+		char	  **values = (char **) palloc(sizeof(char *) * state->nfields);
+		HeapTuple	tuple;
+		int			field;
+
+		for (field = 0; field < state->nfields; field++)
+		{
+			if (FQgetisnull(state->res, row, field))
+				values[field] = NULL;
+			else
+				values[field] = FQgetvalue(state->res, row, field);
+		}
+
+		tuple = BuildTupleFromCStrings(state->attinmeta, values);
+
+		pfree(values);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+
+/**
+ * fbQueryRelease()
+ *
+ * Memory context reset callback to free the Firebird result.
+ */
+static void
+fbQueryRelease(void *arg)
+{
+	fbQueryState *state = (fbQueryState *) arg;
+
+	if (state->res != NULL)
+	{
+		FQclear(state->res);
+		state->res = NULL;
+	}
+}
+
+
+/**
+ * fbQueryIsSelect()
+ *
+ * Indicate whether the statement is a query, i.e. begins with SELECT or
+ * WITH after any leading comments and parentheses.
+ */
+static bool
+fbQueryIsSelect(const char *query)
+{
+	const char *ptr = query;
+
+	for (;;)
+	{
+		if (isspace((unsigned char) *ptr) || *ptr == '(')
+			ptr++;
+		else if (ptr[0] == '-' && ptr[1] == '-')
+		{
+			while (*ptr != '\0' && *ptr != '\n')
+				ptr++;
+		}
+		else if (ptr[0] == '/' && ptr[1] == '*')
+		{
+			const char *end = strstr(ptr + 2, "*/");
+
+			if (end == NULL)
+				return false;
+
+			ptr = end + 2;
+		}
+		else
+			break;
+	}
+
+	if (pg_strncasecmp(ptr, "SELECT", 6) == 0)
+		ptr += 6;
+	else if (pg_strncasecmp(ptr, "WITH", 4) == 0)
+		ptr += 4;
+	else
+		return false;
+
+	return !(isalnum((unsigned char) *ptr) || *ptr == '_' || *ptr == '$');
+}
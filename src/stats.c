@@ -0,0 +1,651 @@
+/*-------------------------------------------------------------------------
+ *
+ * Remote statement statistics for firebird_fdw
+ *
+ * Copyright (c) 2013-2023 Ian Barwick
+ *
+ * This software is released under the PostgreSQL Licence
+ *
+ * Author: Ian Barwick <barwick@gmail.com>
+ *
+ * IDENTIFICATION
+ *		  firebird_fdw/src/stats.c
+ *
+ * If firebird_fdw is loaded via "shared_preload_libraries", statistics
+ * about each statement executed on a Firebird server are accumulated in
+ * shared memory, in the manner of pg_stat_statements. Statements are
+ * identified by foreign server, local user and database, and normalized
+ * query text, i.e. with literal constants replaced by "?". Only
+ * statements which complete successfully are recorded. The statistics
+ * are returned by firebird_fdw_stat_statements() and cleared by
+ * firebird_fdw_stat_statements_reset().
+ *
+ * Each statement has a "usage" count, increased by each execution; once
+ * the table of statements is full, the usage of all statements is
+ * decayed and the least used few percent discarded to make room for new
+ * ones, as pg_stat_statements does.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <ctype.h>
+
+#include "firebird_fdw.h"
+
+#include "access/hash.h"
+#if (PG_VERSION_NUM >= 130000)
+#include "common/hashfn.h"
+#endif
+#if (PG_VERSION_NUM >= 100000)
+#include "catalog/pg_authid.h"
+#endif
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/acl.h"
+#include "utils/memutils.h"
+#include "utils/tuplestore.h"
+
+
+/* Maximum number of statements tracked */
+#define FB_STAT_MAX_ENTRIES 1000
+
+/* Maximum length of stored query text, including terminator */
+#define FB_STAT_QUERY_LEN 1024
+
+/* Usage accounting, as in pg_stat_statements */
+#define FB_STAT_USAGE_EXEC 1.0			/* usage added by each execution */
+#define FB_STAT_ASSUMED_MEDIAN_INIT 10.0	/* initial median usage */
+#define FB_STAT_USAGE_DECAY_FACTOR 0.99	/* decay applied when the table is full */
+#define FB_STAT_USAGE_DEALLOC_PERCENT 5	/* percentage of entries then discarded */
+
+typedef struct fbStatKey
+{
+	Oid			serverid;
+	Oid			userid;				/* user executing the statement */
+	Oid			dbid;				/* database in which it was executed */
+	uint64		queryid;			/* hash of normalized query text */
+} fbStatKey;
+
+typedef struct fbStatEntry
+{
+	fbStatKey	key;				/* hash key; must be first */
+	slock_t		mutex;				/* protects the counters */
+	int64		calls;
+	double		total_time;			/* in milliseconds */
+	int64		rows;
+	int64		bytes;
+	int64		local_conds;		/* conditions evaluated locally */
+	double		usage;				/* usage factor */
+	char		query[FB_STAT_QUERY_LEN];
+} fbStatEntry;
+
+typedef struct fbStatSharedState
+{
+	LWLock	   *lock;				/* protects hash table lookup/modification */
+	double		cur_median_usage;	/* current median usage, for new entries */
+} fbStatSharedState;
+
+extern Datum firebird_fdw_stat_statements(PG_FUNCTION_ARGS);
+extern Datum firebird_fdw_stat_statements_reset(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(firebird_fdw_stat_statements);
+PG_FUNCTION_INFO_V1(firebird_fdw_stat_statements_reset);
+
+static fbStatSharedState *fbStatState = NULL;
+static HTAB *fbStatHash = NULL;
+
+#if (PG_VERSION_NUM >= 150000)
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+#endif
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+static void fbStatShmemRequest(void);
+static void fbStatShmemStartup(void);
+static Size fbStatMemSize(void);
+static uint64 fbStatHashQuery(const char *query);
+static fbStatEntry *fbStatEntryAlloc(fbStatKey *key, const char *query);
+static void fbStatEntryDealloc(void);
+static int	fbStatUsageCmp(const void *lhs, const void *rhs);
+static void fbStatCheckLoaded(void);
+
+
+/**
+ * firebirdStatInit()
+ *
+ * Called from _PG_init() to request shared memory for the statistics, if
+ * the library is being preloaded.
+ */
+void
+firebirdStatInit(void)
+{
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+#if (PG_VERSION_NUM >= 150000)
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = fbStatShmemRequest;
+#else
+	fbStatShmemRequest();
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = fbStatShmemStartup;
+}
+
+
+static void
+fbStatShmemRequest(void)
+{
+#if (PG_VERSION_NUM >= 150000)
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+#endif
+
+	RequestAddinShmemSpace(fbStatMemSize());
+#if (PG_VERSION_NUM >= 90600)
+	RequestNamedLWLockTranche("firebird_fdw", 1);
+#else
+	RequestAddinLWLocks(1);
+#endif
+}
+
+
+static void
+fbStatShmemStartup(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	fbStatState = ShmemInitStruct("firebird_fdw stat statements",
+								  sizeof(fbStatSharedState),
+								  &found);
+
+	if (!found)
+	{
+#if (PG_VERSION_NUM >= 90600)
+		fbStatState->lock = &(GetNamedLWLockTranche("firebird_fdw"))->lock;
+#else
+		fbStatState->lock = LWLockAssign();
+#endif
+		fbStatState->cur_median_usage = FB_STAT_ASSUMED_MEDIAN_INIT;
+	}
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(fbStatKey);
+	info.entrysize = sizeof(fbStatEntry);
+
+	fbStatHash = ShmemInitHash("firebird_fdw stat statements hash",
+							   FB_STAT_MAX_ENTRIES, FB_STAT_MAX_ENTRIES,
+							   &info,
+							   HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+static Size
+fbStatMemSize(void)
+{
+	return add_size(MAXALIGN(sizeof(fbStatSharedState)),
+					hash_estimate_size(FB_STAT_MAX_ENTRIES, sizeof(fbStatEntry)));
+}
+
+
+/**
+ * firebirdStatEnabled()
+ *
+ * Indicate whether statement statistics are being collected.
+ */
+bool
+firebirdStatEnabled(void)
+{
+	return fbStatState != NULL && fbStatHash != NULL;
+}
+
+
+/**
+ * firebirdStatStart()
+ *
+ * Note the start time of a remote statement, if statistics are being
+ * collected or slow statements are being logged.
+ */
+void
+firebirdStatStart(instr_time *start_time)
+{
+	if (firebirdStatEnabled() || firebirdLogEnabled())
+		INSTR_TIME_SET_CURRENT(*start_time);
+	else
+		INSTR_TIME_SET_ZERO(*start_time);
+}
+
+
+/**
+ * firebirdStatEnd()
+ *
+ * Record the successful execution of "query" on the server "serverid",
+ * begun at "start_time", with result "res". "local_conds" is the number
+ * of the scan's conditions which could not be sent with the query. The
+ * result is not freed.
+ */
+void
+firebirdStatEnd(Oid serverid, const char *query, int local_conds, instr_time *start_time, FBresult *res)
+{
+	instr_time	elapsed;
+	fbStatKey	key;
+	fbStatEntry *entry;
+	char	   *normalized;
+	int64		rows = 0;
+	int64		bytes = 0;
+
+	if (!firebirdStatEnabled() || INSTR_TIME_IS_ZERO(*start_time))
+		return;
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, *start_time);
+
+	if (FQresultStatus(res) == FBRES_TUPLES_OK)
+	{
+		rows = FQntuples(res);
+		bytes = firebirdResultBytes(res);
+	}
+
+	normalized = firebirdStatNormalizeQuery(query);
+
+	memset(&key, 0, sizeof(key));
+	key.serverid = serverid;
+	key.userid = GetUserId();
+	key.dbid = MyDatabaseId;
+	key.queryid = fbStatHashQuery(normalized);
+
+	LWLockAcquire(fbStatState->lock, LW_SHARED);
+
+	entry = (fbStatEntry *) hash_search(fbStatHash, &key, HASH_FIND, NULL);
+
+	if (entry == NULL)
+	{
+		/* Need exclusive lock to add an entry */
+		LWLockRelease(fbStatState->lock);
+		LWLockAcquire(fbStatState->lock, LW_EXCLUSIVE);
+
+		entry = fbStatEntryAlloc(&key, normalized);
+	}
+
+	if (entry != NULL)
+	{
+		SpinLockAcquire(&entry->mutex);
+
+		entry->calls++;
+		entry->total_time += INSTR_TIME_GET_MILLISEC(elapsed);
+		entry->rows += rows;
+		entry->bytes += bytes;
+		entry->local_conds += local_conds;
+		entry->usage += FB_STAT_USAGE_EXEC;
+
+		SpinLockRelease(&entry->mutex);
+	}
+
+	LWLockRelease(fbStatState->lock);
+
+	pfree(normalized);
+}
+
+
+/**
+ * fbStatHashQuery()
+ *
+ * Return a 64-bit hash of the normalized query text "query".
+ */
+static uint64
+fbStatHashQuery(const char *query)
+{
+	int			len = strlen(query);
+
+#if (PG_VERSION_NUM >= 110000)
+	return DatumGetUInt64(hash_any_extended((const unsigned char *) query, len, 0));
+#else
+	/*
+	 * No 64-bit hash function is available; combine the hashes of the text
+	 * with and without its first character, which are independent of each
+	 * other.
+	 */
+	uint64		hash;
+
+	hash = (uint64) DatumGetUInt32(hash_any((const unsigned char *) query, len)) << 32;
+
+	if (len > 0)
+		hash |= DatumGetUInt32(hash_any((const unsigned char *) query + 1, len - 1));
+
+	return hash;
+#endif
+}
+
+
+/**
+ * fbStatEntryAlloc()
+ *
+ * Find or create the entry for "key"; the caller must hold the lock
+ * exclusively. If the table is full, the least used entries are
+ * discarded first. The query text is stored truncated, if necessary,
+ * at a character boundary.
+ */
+static fbStatEntry *
+fbStatEntryAlloc(fbStatKey *key, const char *query)
+{
+	fbStatEntry *entry;
+	bool		found;
+
+	entry = (fbStatEntry *) hash_search(fbStatHash, key, HASH_FIND, NULL);
+
+	if (entry != NULL)
+		return entry;
+
+	if (hash_get_num_entries(fbStatHash) >= FB_STAT_MAX_ENTRIES)
+		fbStatEntryDealloc();
+
+	entry = (fbStatEntry *) hash_search(fbStatHash, key, HASH_ENTER_NULL, &found);
+
+	if (entry != NULL && !found)
+	{
+		int			query_len = pg_mbcliplen(query, strlen(query), FB_STAT_QUERY_LEN - 1);
+
+		entry->calls = 0;
+		entry->total_time = 0.0;
+		entry->rows = 0;
+		entry->bytes = 0;
+		entry->local_conds = 0;
+		/* Start new entries at the median usage, so they are not discarded at once */
+		entry->usage = fbStatState->cur_median_usage;
+		memcpy(entry->query, query, query_len);
+		entry->query[query_len] = '\0';
+		SpinLockInit(&entry->mutex);
+	}
+
+	return entry;
+}
+
+
+/**
+ * fbStatEntryDealloc()
+ *
+ * Decay the usage of all entries and discard the least used
+ * FB_STAT_USAGE_DEALLOC_PERCENT percent of them (at least 10); the caller
+ * must hold the lock exclusively.
+ */
+static void
+fbStatEntryDealloc(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	fbStatEntry **entries;
+	fbStatEntry *entry;
+	int			nentries = 0;
+	int			nvictims;
+	int			i;
+
+	entries = (fbStatEntry **) palloc(hash_get_num_entries(fbStatHash) * sizeof(fbStatEntry *));
+
+	hash_seq_init(&hash_seq, fbStatHash);
+
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		entries[nentries++] = entry;
+		entry->usage *= FB_STAT_USAGE_DECAY_FACTOR;
+	}
+
+	qsort(entries, nentries, sizeof(fbStatEntry *), fbStatUsageCmp);
+
+	if (nentries > 0)
+		fbStatState->cur_median_usage = entries[nentries / 2]->usage;
+
+	nvictims = Max(10, nentries * FB_STAT_USAGE_DEALLOC_PERCENT / 100);
+	nvictims = Min(nvictims, nentries);
+
+	for (i = 0; i < nvictims; i++)
+		hash_search(fbStatHash, &entries[i]->key, HASH_REMOVE, NULL);
+
+	pfree(entries);
+}
+
+
+/**
+ * fbStatUsageCmp()
+ *
+ * qsort comparator for sorting entries into increasing usage order.
+ */
+static int
+fbStatUsageCmp(const void *lhs, const void *rhs)
+{
+	double		l_usage = (*(fbStatEntry *const *) lhs)->usage;
+	double		r_usage = (*(fbStatEntry *const *) rhs)->usage;
+
+	if (l_usage < r_usage)
+		return -1;
+	else if (l_usage > r_usage)
+		return +1;
+	else
+		return 0;
+}
+
+
+/**
+ * firebirdStatNormalizeQuery()
+ *
+ * Return a copy of "query" with string and numeric literals replaced
+ * by "?", so that statements differing only in the constants pushed
+ * down to Firebird are counted together. Also used to keep constants
+ * out of the server log.
+ */
+char *
+firebirdStatNormalizeQuery(const char *query)
+{
+	StringInfoData buf;
+	const char *ptr = query;
+
+	initStringInfo(&buf);
+
+	while (*ptr != '\0')
+	{
+		if (*ptr == '\'')
+		{
+			/* string literal, with '' as an embedded quote */
+			ptr++;
+			while (*ptr != '\0')
+			{
+				if (*ptr == '\'' && *(ptr + 1) == '\'')
+					ptr += 2;
+				else if (*ptr == '\'')
+				{
+					ptr++;
+					break;
+				}
+				else
+					ptr++;
+			}
+
+			appendStringInfoChar(&buf, '?');
+		}
+		else if (*ptr == '"')
+		{
+			/* quoted identifier, copied as-is */
+			appendStringInfoChar(&buf, *ptr++);
+			while (*ptr != '\0' && *ptr != '"')
+				appendStringInfoChar(&buf, *ptr++);
+			if (*ptr == '"')
+				appendStringInfoChar(&buf, *ptr++);
+		}
+		else if (isdigit((unsigned char) *ptr) &&
+				 (ptr == query ||
+				  !(isalnum((unsigned char) *(ptr - 1)) || *(ptr - 1) == '_' || *(ptr - 1) == '$')))
+		{
+			/* numeric literal, not part of an identifier */
+			while (isdigit((unsigned char) *ptr) || *ptr == '.')
+				ptr++;
+
+			if (*ptr == 'e' || *ptr == 'E')
+			{
+				ptr++;
+				if (*ptr == '+' || *ptr == '-')
+					ptr++;
+				while (isdigit((unsigned char) *ptr))
+					ptr++;
+			}
+
+			appendStringInfoChar(&buf, '?');
+		}
+		else
+			appendStringInfoChar(&buf, *ptr++);
+	}
+
+	return buf.data;
+}
+
+
+static void
+fbStatCheckLoaded(void)
+{
+	if (!firebirdStatEnabled())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("firebird_fdw must be loaded via \"shared_preload_libraries\" to collect statement statistics")));
+}
+
+
+/**
+ * firebird_fdw_stat_statements()
+ *
+ * Return the accumulated statement statistics. As with pg_stat_statements,
+ * the query text of statements executed by other users is only shown to
+ * superusers and members of pg_read_all_stats.
+ */
+Datum
+firebird_fdw_stat_statements(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS hash_seq;
+	fbStatEntry *entry;
+	Oid			userid = GetUserId();
+	bool		is_allowed_role;
+
+	fbStatCheckLoaded();
+
+#if (PG_VERSION_NUM >= 140000)
+	is_allowed_role = has_privs_of_role(userid, ROLE_PG_READ_ALL_STATS);
+#elif (PG_VERSION_NUM >= 100000)
+	is_allowed_role = has_privs_of_role(userid, DEFAULT_ROLE_READ_ALL_STATS);
+#else
+	is_allowed_role = superuser();
+#endif
+
+	/* check to see if caller supports this function returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Switch into long-lived context to construct returned data structures */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for function's result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(fbStatState->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, fbStatHash);
+
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[10];
+		bool		nulls[10];
+		int64		calls;
+		double		total_time;
+		int64		rows;
+		int64		bytes;
+		int64		local_conds;
+
+		SpinLockAcquire(&entry->mutex);
+		calls = entry->calls;
+		total_time = entry->total_time;
+		rows = entry->rows;
+		bytes = entry->bytes;
+		local_conds = entry->local_conds;
+		SpinLockRelease(&entry->mutex);
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = ObjectIdGetDatum(entry->key.serverid);
+		values[1] = ObjectIdGetDatum(entry->key.userid);
+		values[2] = ObjectIdGetDatum(entry->key.dbid);
+
+		if (is_allowed_role || entry->key.userid == userid)
+			values[3] = CStringGetTextDatum(entry->query);
+		else
+			values[3] = CStringGetTextDatum("<insufficient privilege>");
+
+		values[4] = Int64GetDatum(calls);
+		values[5] = Float8GetDatum(total_time);
+		values[6] = Float8GetDatum(calls > 0 ? total_time / calls : 0.0);
+		values[7] = Int64GetDatum(rows);
+		values[8] = Int64GetDatum(bytes);
+		values[9] = Int64GetDatum(local_conds);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(fbStatState->lock);
+
+	return (Datum) 0;
+}
+
+
+/**
+ * firebird_fdw_stat_statements_reset()
+ *
+ * Discard all statement statistics.
+ */
+Datum
+firebird_fdw_stat_statements_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	fbStatEntry *entry;
+
+	fbStatCheckLoaded();
+
+	LWLockAcquire(fbStatState->lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hash_seq, fbStatHash);
+
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(fbStatHash, &entry->key, HASH_REMOVE, NULL);
+
+	LWLockRelease(fbStatState->lock);
+
+	PG_RETURN_VOID();
+}
@@ -20,13 +20,13 @@ my $node = FirebirdFDWNode->new();
 # ----------------------
 
 if ($node->{firebird_major_version} >= 4) {
-	plan tests => 14;
+	plan tests => 19;
 }
 elsif ($node->{firebird_major_version} >= 3) {
-	plan tests => 12;
+	plan tests => 17;
 }
 else {
-	plan tests => 5;
+	plan tests => 10;
 }
 
 # Prepare table
@@ -440,6 +440,285 @@ EO_SQL
 }
 
 
+# 15) Integer boundary values
+# ---------------------------
+#
+# Values at the limits of each type; 19-digit BIGINT values are not
+# decoded directly but by the type input function.
+
+my $int_table = $node->init_table(
+    definition_fb => [
+        ['id',     'INT NOT NULL PRIMARY KEY'],
+        ['int2_c', 'SMALLINT'],
+        ['int4_c', 'INTEGER'],
+        ['int8_c', 'BIGINT'],
+    ],
+    definition_pg => [
+        ['id',     'INT NOT NULL'],
+        ['int2_c', 'SMALLINT'],
+        ['int4_c', 'INTEGER'],
+        ['int8_c', 'BIGINT'],
+    ],
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        <<'EO_SQL',
+INSERT INTO %s (id, int2_c, int4_c, int8_c)
+     VALUES (1, -32768, -2147483648, -9223372036854775808)
+EO_SQL
+        $int_table,
+    ),
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        <<'EO_SQL',
+INSERT INTO %s (id, int2_c, int4_c, int8_c)
+     VALUES (2, 32767, 2147483647, 9223372036854775807)
+EO_SQL
+        $int_table,
+    ),
+);
+
+my ($q15_res, $q15_stdout, $q15_stderr) = $node->psql(
+    sprintf(
+        q|SELECT int2_c, int4_c, int8_c FROM %s ORDER BY id|,
+        $int_table,
+    ),
+);
+
+is (
+    $q15_stdout,
+    qq/-32768|-2147483648|-9223372036854775808\n32767|2147483647|9223372036854775807/,
+    q|Check integer boundary values|,
+);
+
+$node->firebird_drop_table($int_table);
+
+# 16) FLOAT values
+# ----------------
+#
+# A Firebird FLOAT must yield the same float4 value as float4in() would.
+
+my $float_table = $node->init_table(
+    definition_fb => [
+        ['id',       'INT NOT NULL PRIMARY KEY'],
+        ['float4_c', 'FLOAT'],
+    ],
+    definition_pg => [
+        ['id',       'INT NOT NULL'],
+        ['float4_c', 'REAL'],
+    ],
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s (id, float4_c) VALUES (1, 3.14159)|,
+        $float_table,
+    ),
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s (id, float4_c) VALUES (2, 0.1)|,
+        $float_table,
+    ),
+);
+
+my ($q16_res, $q16_stdout, $q16_stderr) = $node->psql(
+    sprintf(
+        <<'EO_SQL',
+SELECT id, float4_c = CASE id WHEN 1 THEN '3.14159'::REAL ELSE '0.1'::REAL END
+  FROM %s
+ ORDER BY id
+EO_SQL
+        $float_table,
+    ),
+);
+
+is (
+    $q16_stdout,
+    qq/1|t\n2|t/,
+    q|Check FLOAT values|,
+);
+
+$node->firebird_drop_table($float_table);
+
+# 17) CHAR(n) padding
+# -------------------
+#
+# Firebird pads CHAR(n) values to their declared length; the PostgreSQL
+# value must be padded (or trimmed) to the PostgreSQL column's length.
+
+my $char_table = $node->init_table(
+    definition_fb => [
+        ['id',     'INT NOT NULL PRIMARY KEY'],
+        ['char_c', 'CHAR(5)'],
+    ],
+    definition_pg => [
+        ['id',     'INT NOT NULL'],
+        ['char_c', 'CHAR(3)'],
+    ],
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s (id, char_c) VALUES (1, 'ab')|,
+        $char_table,
+    ),
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s (id, char_c) VALUES (2, 'abc')|,
+        $char_table,
+    ),
+);
+
+my ($q17_res, $q17_stdout, $q17_stderr) = $node->psql(
+    sprintf(
+        q|SELECT id, char_c, octet_length(char_c) FROM %s WHERE id IN (1, 2) ORDER BY id|,
+        $char_table,
+    ),
+);
+
+is (
+    $q17_stdout,
+    qq/1|ab |3\n2|abc|3/,
+    q|Check CHAR(n) padding|,
+);
+
+# 18) Type input function called only for returned rows
+# ------------------------------------------------------
+#
+# A value rejected by the type input function must not cause an error
+# if its row is never returned.
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s (id, char_c) VALUES (3, 'abcde')|,
+        $char_table,
+    ),
+);
+
+my ($q18_res, $q18_stdout, $q18_stderr) = $node->psql(
+    sprintf(
+        q|SELECT id, char_c FROM %s ORDER BY id LIMIT 1|,
+        $char_table,
+    ),
+);
+
+is (
+    $q18_stdout,
+    qq/1|ab /,
+    q|Check a value not accepted by the type input function is only converted if returned|,
+);
+
+$node->firebird_drop_table($char_table);
+
+# 19) CHAR(n) padding in a multibyte database
+# -------------------------------------------
+
+my $mb_dbname = 'fdw_test_utf8';
+
+$node->postgres_node->safe_psql(
+    'postgres',
+    sprintf(
+        q|CREATE DATABASE %s ENCODING 'UTF8' LC_COLLATE 'C' LC_CTYPE 'C' TEMPLATE template0|,
+        $mb_dbname,
+    ),
+);
+
+$node->postgres_node->safe_psql(
+    $mb_dbname,
+    sprintf(
+        <<'EO_SQL',
+CREATE EXTENSION firebird_fdw;
+
+CREATE SERVER %s
+  FOREIGN DATA WRAPPER firebird_fdw
+  OPTIONS (
+    address 'localhost',
+    database '%s',
+    port '%i'
+  );
+
+CREATE USER MAPPING
+  FOR CURRENT_USER
+  SERVER %s
+  OPTIONS(
+    username '%s',
+    password '%s'
+  );
+EO_SQL
+        $node->server_name,
+        $node->{firebird_dbname},
+        $node->{firebird_dbport},
+        $node->server_name,
+        $ENV{'ISC_USER'},
+        $ENV{'ISC_PASSWORD'},
+    ),
+);
+
+my $mb_char_table = $node->init_table(
+    firebird_only => 1,
+    definition_fb => [
+        ['id',     'INT NOT NULL PRIMARY KEY'],
+        ['char_c', 'CHAR(4) CHARACTER SET UTF8'],
+    ],
+);
+
+$node->postgres_node->safe_psql(
+    $mb_dbname,
+    sprintf(
+        <<'EO_SQL',
+CREATE FOREIGN TABLE %s (
+  id      INT NOT NULL,
+  char_c  CHAR(4)
+)
+  SERVER %s
+  OPTIONS (table_name '%s')
+EO_SQL
+        $mb_char_table,
+        $node->server_name,
+        $mb_char_table,
+    ),
+);
+
+$node->postgres_node->safe_psql(
+    $mb_dbname,
+    sprintf(
+        q|INSERT INTO %s (id, char_c) VALUES (1, 'äö')|,
+        $mb_char_table,
+    ),
+);
+
+my ($q19_res, $q19_stdout, $q19_stderr) = $node->postgres_node->psql(
+    $mb_dbname,
+    sprintf(
+        q|SELECT char_c, octet_length(char_c) FROM %s WHERE id = 1|,
+        $mb_char_table,
+    ),
+);
+
+is (
+    $q19_stdout,
+    qq/äö  |6/,
+    q|Check CHAR(n) padding in a multibyte database|,
+);
+
+$node->firebird_drop_table($mb_char_table);
+
+$node->postgres_node->safe_psql(
+    'postgres',
+    sprintf(
+        q|DROP DATABASE %s|,
+        $mb_dbname,
+    ),
+);
+
+
 # Clean up
 # --------
 
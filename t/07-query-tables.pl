@@ -7,7 +7,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 2;
+use Test::More tests => 8;
 
 use FirebirdFDWNode;
 
@@ -17,6 +17,8 @@ use FirebirdFDWNode;
 
 my $node = FirebirdFDWNode->new();
 
+my $version = $node->pg_version();
+
 # Prepare table
 # --------------
 
@@ -90,6 +92,113 @@ like (
     q|Check INSERT on foreign table defined as query fails|,
 );
 
+# 3) Placeholders bound from column conditions
+# --------------------------------------------
+
+my $param_table_name = sprintf(q|%s_param|, $table_name);
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+CREATE FOREIGN TABLE %s (
+  prefix VARCHAR(10) OPTIONS (query_parameter 'prefix'),
+  lang_count INT
+)
+SERVER %s
+OPTIONS(
+   query $$SELECT COUNT(*) AS lang_count /* counts :prefix */ FROM %s WHERE name_english STARTING WITH :prefix$$
+)
+EO_SQL
+        $param_table_name,
+        $node->server_name(),
+        $table_name,
+    ),
+);
+
+my $select_q3 = sprintf(
+    q|SELECT prefix, lang_count FROM %s WHERE prefix = 'Eng'|,
+    $param_table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql( $select_q3 );
+
+is(
+	$res_stdout,
+	'Eng|1',
+	'placeholder bound from column condition',
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql( qq|EXPLAIN (VERBOSE, COSTS OFF) $select_q3| );
+
+like (
+    $res_stdout,
+    qr/STARTING WITH \?/,
+    q|Check placeholder is bound as a parameter in the remote query|,
+);
+
+like (
+    $res_stdout,
+    qr|/\* counts :prefix \*/|,
+    q|Check placeholder in a comment is not substituted|,
+);
+
+# 4) Placeholder column without a value
+# -------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT lang_count FROM %s WHERE prefix IN ('Eng', 'Ger')|,
+        $param_table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/unable to determine a value for parameter column "prefix"/,
+    q|Check placeholder without a value is rejected|,
+);
+
+# 5) Placeholder bound from a join condition
+# ------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT v.prefix, p.lang_count FROM (VALUES ('Eng'), ('Ger')) v(prefix) JOIN %s p ON p.prefix = v.prefix ORDER BY v.prefix|,
+        $param_table_name,
+    ),
+);
+
+is(
+	$res_stdout,
+	qq/Eng|1\nGer|0/,
+	'placeholder bound for each row of a join',
+);
+
+# 6) Placeholder bound from a prepared statement parameter
+# --------------------------------------------------------
+
+SKIP: {
+    skip q|plan_cache_mode requires PostgreSQL 12 or later|, 1 if $version < 120000;
+
+    ($res, $res_stdout, $res_stderr) = $node->psql(
+        sprintf(
+            <<'EO_SQL',
+SET plan_cache_mode = force_generic_plan;
+PREPARE param_query(text) AS SELECT lang_count FROM %s WHERE prefix = $1;
+EXECUTE param_query('Eng');
+EXECUTE param_query('Ger');
+EO_SQL
+            $param_table_name,
+        ),
+    );
+
+    is(
+        $res_stdout,
+        qq/1\n0/,
+        'placeholder bound in a generic plan',
+    );
+}
+
 # Clean up
 # --------
 
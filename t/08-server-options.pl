@@ -9,7 +9,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 5;
+use Test::More tests => 7;
 
 use FirebirdFDWNode;
 
@@ -181,6 +181,69 @@ is(
 	q|Drop "updatable" option|,
 );
 
+# 6. Check "trusted_encoding"
+# ---------------------------
+
+$node->add_server_option('trusted_encoding', 'true');
+
+my $table_name_6 = $node->init_table();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s VALUES('ja', 'Japanese', '日本語')|,
+        $table_name_6,
+    ),
+);
+
+my $options_q6 = sprintf(
+    q|SELECT lang_id, name_english, name_native, length(name_native) FROM %s|,
+    $table_name_6,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($options_q6);
+
+is(
+	$res_stdout,
+	q/ja|Japanese|日本語|3/,
+	q|Check values retrieved with "trusted_encoding"|,
+);
+
+$node->firebird_drop_table($table_name_6);
+
+# 7. Check "trusted_encoding" does not bypass the declared length
+# ---------------------------------------------------------------
+
+my $table_name_7 = $node->init_table(
+    definition_pg => [
+        ['LANG_ID',      'CHAR(2) NOT NULL'],
+        ['NAME_ENGLISH', 'VARCHAR(64) NOT NULL'],
+        ['NAME_NATIVE',  'VARCHAR(2) NOT NULL'],
+    ],
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s VALUES('xx', 'Overlong', 'abc')|,
+        $table_name_7,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT name_native FROM %s|,
+        $table_name_7,
+    ),
+);
+
+like(
+	$res_stderr,
+	qr/value too long for type character varying\(2\)/,
+	q|Check overlong value rejected with "trusted_encoding"|,
+);
+
+$node->drop_server_option('trusted_encoding');
+$node->firebird_drop_table($table_name_7);
+
 
 # Clean up
 # --------
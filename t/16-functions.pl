@@ -7,7 +7,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 2;
+use Test::More tests => 7;
 
 use FirebirdFDWNode;
 
@@ -55,3 +55,100 @@ is (
 );
 
 
+# 3. Check firebird_fdw_query() output
+# ------------------------------------
+
+my $table_name = $node->init_table();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch'), ('en', 'English', 'English')|,
+        $table_name,
+    ),
+);
+
+my $q3_sql = sprintf(
+    q|SELECT * FROM firebird_fdw_query('%s', 'WITH t AS (SELECT lang_id, name_english FROM %s) SELECT * FROM t WHERE lang_id = ?', 'de') AS t(lang_id CHAR(2), name_english VARCHAR(64))|,
+    $node->server_name(),
+    $table_name,
+);
+
+my ($q3_res, $q3_stdout, $q3_stderr) = $node->psql($q3_sql);
+
+is (
+    $q3_stdout,
+    q/de|German/,
+    q|Check firebird_fdw_query() output|,
+);
+
+# 4. Check firebird_fdw_query() column count mismatch
+# ---------------------------------------------------
+
+my $q4_sql = sprintf(
+    q|SELECT * FROM firebird_fdw_query('%s', 'SELECT lang_id, name_english FROM %s') AS t(lang_id CHAR(2))|,
+    $node->server_name(),
+    $table_name,
+);
+
+my ($q4_res, $q4_stdout, $q4_stderr) = $node->psql($q4_sql);
+
+like (
+    $q4_stderr,
+    qr/query returns 2 columns, but the column definition list has 1 columns/,
+    q|Check firebird_fdw_query() column count mismatch|,
+);
+
+# 5. Check firebird_fdw_connections() output
+# -------------------------------------------
+
+my $q5_sql = sprintf(
+    q|SELECT lang_id FROM %s WHERE lang_id = 'de'; SELECT server_name, xact_depth, statements > 0, prepared_statements FROM firebird_fdw_connections()|,
+    $table_name,
+);
+
+my ($q5_res, $q5_stdout, $q5_stderr) = $node->psql($q5_sql);
+
+is (
+    $q5_stdout,
+    sprintf(qq/de\n%s|0|t|0/, $node->server_name()),
+    q|Check firebird_fdw_connections() output|,
+);
+
+# 6. Check a failed modify operation does not leave a prepared statement
+# ----------------------------------------------------------------------
+
+my $q6_sql = sprintf(
+    <<'EO_SQL',
+BEGIN;
+INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch');
+ROLLBACK;
+SELECT server_name, prepared_statements FROM firebird_fdw_connections();
+EO_SQL
+    $table_name,
+);
+
+my ($q6_res, $q6_stdout, $q6_stderr) = $node->psql($q6_sql);
+
+is (
+    $q6_stdout,
+    sprintf(qq/%s|0/, $node->server_name()),
+    q|Check prepared statement released after failed modify operation|,
+);
+
+# 7. Check firebird_fdw_query() requires USAGE on the foreign server
+# ------------------------------------------------------------------
+
+my $q7_sql = sprintf(
+    q|SET session AUTHORIZATION foo; SELECT * FROM firebird_fdw_query('%s', 'SELECT 1 FROM rdb$database') AS t(i INT)|,
+    $node->server_name(),
+);
+
+my ($q7_res, $q7_stdout, $q7_stderr) = $node->psql($q7_sql);
+
+like (
+    $q7_stderr,
+    qr/permission denied for foreign server/,
+    q|Check firebird_fdw_query() requires USAGE on the foreign server|,
+);
+
+$node->firebird_drop_table($table_name);
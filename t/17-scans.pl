@@ -19,7 +19,7 @@ our $node = FirebirdFDWNode->new();
 
 our $version = $node->pg_version();
 
-plan tests => 1;
+plan tests => 5;
 
 # Ensure rescans work properly
 # -----------------------------
@@ -166,6 +166,85 @@ is (
     q|Check query results match|,
 );
 
+# Check replay of retained rows on rescan
+# ---------------------------------------
+#
+# The inner side of an unparameterized nested loop is rescanned for
+# each outer row; the rows fetched on the first scan are replayed
+# rather than being fetched again. With a semi join, the inner scan
+# is rescanned before all rows have been fetched.
+
+my $q2_sql = sprintf(
+    q|SELECT count(*) FROM generate_series(1, 5) g, %s p WHERE p.c0 > g|,
+    $q1_table_name,
+);
+
+my ($q2_res, $q2_expected, $q2_stderr) = $node->psql($q2_sql);
+
+my ($q2_nl_res, $q2_nl_stdout, $q2_nl_stderr) = $node->psql(
+    qq|SET enable_hashjoin = off; SET enable_mergejoin = off; SET enable_material = off; $q2_sql|,
+);
+
+is (
+    $q2_nl_stdout,
+    $q2_expected,
+    q|Check nested loop rescan results match|,
+);
+
+my $q3_sql = sprintf(
+    q|SELECT count(*) FROM generate_series(1, 5) g WHERE EXISTS (SELECT 1 FROM %s p WHERE p.c0 > g)|,
+    $q1_table_name,
+);
+
+my ($q3_res, $q3_stdout, $q3_stderr) = $node->psql(
+    qq|SET enable_hashjoin = off; SET enable_mergejoin = off; SET enable_material = off; $q3_sql|,
+);
+
+is (
+    $q3_stdout,
+    '5',
+    q|Check nested loop semi join rescan results|,
+);
+
+# Check identical scans in the same query
+# ---------------------------------------
+#
+# Both scans issue the same remote query, so the second one uses the
+# result fetched by the first one.
+
+my $q4_sql = sprintf(
+    q|SELECT count(*) FROM (SELECT c0 FROM %s UNION ALL SELECT c0 FROM %s) u|,
+    $q1_table_name,
+    $q1_table_name,
+);
+
+my ($q4_res, $q4_stdout, $q4_stderr) = $node->psql($q4_sql);
+
+my ($q4_single_res, $q4_single_stdout, $q4_single_stderr) = $node->psql(
+    sprintf(
+        q|SELECT count(*) * 2 FROM %s|,
+        $q1_table_name,
+    ),
+);
+
+is (
+    $q4_stdout,
+    $q4_single_stdout,
+    q|Check identical scans results match|,
+);
+
+my ($q4_debug_res, $q4_debug_stdout, $q4_debug_stderr) = $node->psql(
+    qq|SET client_min_messages = debug1; $q4_sql|,
+);
+
+my $q4_remote_queries = () = $q4_debug_stderr =~ m/remote query:/g;
+
+is (
+    $q4_remote_queries,
+    1,
+    q|Check identical scans execute the remote query once|,
+);
+
 # Clean up
 # --------
 
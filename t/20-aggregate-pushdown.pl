@@ -0,0 +1,181 @@
+#!/usr/bin/env perl
+
+# 20-aggregate-pushdown.pl
+#
+# Check aggregate pushdown, including partial aggregation for
+# partitionwise aggregation (PostgreSQL 11 and later)
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+if ($version < 110000) {
+    plan skip_all => sprintf(
+        q|version is %i, tests for 11 and later|,
+        $version,
+    );
+}
+
+plan tests => 7;
+
+# Prepare table
+# -------------
+
+my $table_name = $node->init_table(
+    definition_pg => [
+        ['id',  'INT NOT NULL'],
+        ['grp', 'INT NOT NULL'],
+        ['val', 'INT'],
+    ],
+    definition_fb => [
+        ['id',  'INT NOT NULL PRIMARY KEY'],
+        ['grp', 'INT NOT NULL'],
+        ['val', 'INT'],
+    ],
+    estimated_row_count => 30,
+);
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (id, grp, val) SELECT i, i %% 3, i FROM generate_series(1, 30) i|,
+        $table_name,
+    ),
+);
+
+# 1) Simple aggregation is pushed down
+# ------------------------------------
+
+my $agg_q1 = sprintf(
+    q|SELECT grp, count(*), sum(val), min(val), max(val) FROM %s GROUP BY grp ORDER BY grp|,
+    $table_name,
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(qq|EXPLAIN $agg_q1|);
+
+like (
+    $res_stdout,
+    qr/Firebird query: SELECT grp, COUNT\(\*\), SUM\(val\), MIN\(val\), MAX\(val\) FROM \S+ GROUP BY grp/i,
+    q|Check aggregate pushdown|,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($agg_q1);
+
+is (
+    $res_stdout,
+    qq/0|10|165|3|30\n1|10|145|1|28\n2|10|155|2|29/,
+    q|Check pushed-down aggregate result|,
+);
+
+# 2) Aggregation with a HAVING clause
+# -----------------------------------
+
+my $agg_q2 = sprintf(
+    q|SELECT grp, count(*) FROM %s WHERE val > 10 GROUP BY grp HAVING sum(val) > 130 ORDER BY grp|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($agg_q2);
+
+is (
+    $res_stdout,
+    qq/0|7\n2|7/,
+    q|Check pushed-down aggregate with HAVING clause|,
+);
+
+# 3) Partial aggregation for partitionwise aggregation
+# ----------------------------------------------------
+
+my $part_name = $node->make_table_name();
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+CREATE TABLE %s (
+  id  INT NOT NULL,
+  grp INT NOT NULL,
+  val INT
+) PARTITION BY RANGE (id)
+EO_SQL
+        $part_name,
+    ),
+);
+
+$node->safe_psql(
+    sprintf(
+        q|ALTER TABLE %s ATTACH PARTITION %s FOR VALUES FROM (1) TO (1000)|,
+        $part_name,
+        $table_name,
+    ),
+);
+
+my $agg_q3 = sprintf(
+    q|SELECT grp, count(*), avg(val) FROM %s GROUP BY grp ORDER BY grp|,
+    $part_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|SET enable_partitionwise_aggregate = on; EXPLAIN $agg_q3|,
+);
+
+like (
+    $res_stdout,
+    qr/Partial .+Firebird query: SELECT grp, COUNT\(\*\), '\{' \|\| COUNT\(val\) \|\| ',' \|\| COALESCE\(SUM\(val\), 0\) \|\| '\}'/s,
+    q|Check partial aggregate pushdown|,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|SET enable_partitionwise_aggregate = on; $agg_q3|,
+);
+
+is (
+    $res_stdout,
+    qq/0|10|16.5000000000000000\n1|10|14.5000000000000000\n2|10|15.5000000000000000/,
+    q|Check partial aggregate result|,
+);
+
+# 4) Grouping by a constant is not pushed down
+# --------------------------------------------
+
+my $agg_q4 = sprintf(
+    q|SELECT 2 AS two, count(*) FROM %s GROUP BY two|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|EXPLAIN (VERBOSE, COSTS OFF) $agg_q4|,
+);
+
+unlike (
+    $res_stdout,
+    qr/Firebird query: .+GROUP BY/,
+    q|Check grouping by a constant is not pushed down|,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($agg_q4);
+
+is (
+    $res_stdout,
+    q/2|30/,
+    q|Check result of grouping by a constant|,
+);
+
+# Clean up
+# --------
+
+$node->safe_psql(qq|DROP TABLE $part_name|);
+
+$node->drop_foreign_server();
+
+$node->firebird_drop_table($table_name);
+
+done_testing();
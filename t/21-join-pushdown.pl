@@ -0,0 +1,200 @@
+#!/usr/bin/env perl
+
+# 21-join-pushdown.pl
+#
+# Check join pushdown, including partitionwise joins between foreign
+# partitions on the same server (PostgreSQL 11 and later)
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+if ($version < 110000) {
+    plan skip_all => sprintf(
+        q|version is %i, tests for 11 and later|,
+        $version,
+    );
+}
+
+plan tests => 5;
+
+# Prepare tables
+# --------------
+#
+# Two "orders" and two "items" partitions, with matching ranges
+
+my @definition_pg = (
+    ['id',  'INT NOT NULL'],
+    ['val', 'VARCHAR(10)'],
+);
+
+my @definition_fb = (
+    ['id',  'INT NOT NULL PRIMARY KEY'],
+    ['val', 'VARCHAR(10)'],
+);
+
+my %tables = ();
+
+foreach my $table (qw(orders_1 orders_2 items_1 items_2)) {
+    $tables{$table} = $node->init_table(
+        definition_pg => \@definition_pg,
+        definition_fb => \@definition_fb,
+        estimated_row_count => 5,
+    );
+}
+
+foreach my $part (1, 2) {
+    my $lower = ($part - 1) * 10 + 1;
+
+    $node->safe_psql(
+        sprintf(
+            q{INSERT INTO %s SELECT i, 'o' || i FROM generate_series(%i, %i) i},
+            $tables{"orders_$part"},
+            $lower,
+            $lower + 4,
+        ),
+    );
+
+    # only odd-numbered items
+    $node->safe_psql(
+        sprintf(
+            q{INSERT INTO %s SELECT i, 'i' || i FROM generate_series(%i, %i, 2) i},
+            $tables{"items_$part"},
+            $lower,
+            $lower + 4,
+        ),
+    );
+}
+
+# 1) Simple join is pushed down
+# -----------------------------
+
+my $join_q1 = sprintf(
+    q|SELECT o.id, o.val, i.val FROM %s o INNER JOIN %s i ON o.id = i.id WHERE o.id > 1 ORDER BY 1|,
+    $tables{orders_1},
+    $tables{items_1},
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(qq|EXPLAIN $join_q1|);
+
+like (
+    $res_stdout,
+    qr/Firebird query: SELECT r\d+\.id, r\d+\.val, r\d+\.val FROM \S+ r\d+ INNER JOIN \S+ r\d+ ON \(\(r\d+\.id = r\d+\.id\)\) WHERE \(\(r\d+\.id > 1\)\)/,
+    q|Check join pushdown|,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($join_q1);
+
+is (
+    $res_stdout,
+    qq/3|o3|i3\n5|o5|i5/,
+    q|Check pushed-down join result|,
+);
+
+# 2) Outer join
+# -------------
+
+my $join_q2 = sprintf(
+    q|SELECT o.id, i.val FROM %s o LEFT JOIN %s i ON o.id = i.id ORDER BY 1|,
+    $tables{orders_1},
+    $tables{items_1},
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($join_q2);
+
+is (
+    $res_stdout,
+    qq/1|i1\n2|\n3|i3\n4|\n5|i5/,
+    q|Check pushed-down outer join result|,
+);
+
+# 3) Partitionwise join
+# ---------------------
+
+my $orders = $node->make_table_name();
+my $items = $node->make_table_name();
+
+foreach my $parent ($orders, $items) {
+    $node->safe_psql(
+        sprintf(
+            q|CREATE TABLE %s (id INT NOT NULL, val VARCHAR(10)) PARTITION BY RANGE (id)|,
+            $parent,
+        ),
+    );
+}
+
+foreach my $part (1, 2) {
+    my $lower = ($part - 1) * 10 + 1;
+
+    $node->safe_psql(
+        sprintf(
+            q|ALTER TABLE %s ATTACH PARTITION %s FOR VALUES FROM (%i) TO (%i)|,
+            $orders,
+            $tables{"orders_$part"},
+            $lower,
+            $lower + 10,
+        ),
+    );
+
+    $node->safe_psql(
+        sprintf(
+            q|ALTER TABLE %s ATTACH PARTITION %s FOR VALUES FROM (%i) TO (%i)|,
+            $items,
+            $tables{"items_$part"},
+            $lower,
+            $lower + 10,
+        ),
+    );
+}
+
+my $join_q3 = sprintf(
+    q|SELECT o.id, i.val FROM %s o INNER JOIN %s i ON o.id = i.id ORDER BY 1|,
+    $orders,
+    $items,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|SET enable_partitionwise_join = on; EXPLAIN $join_q3|,
+);
+
+my @pushed_joins = ($res_stdout =~ m/Firebird query: SELECT [^\n]+ INNER JOIN /g);
+
+is (
+    scalar @pushed_joins,
+    2,
+    q|Check partitionwise join pushdown|,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|SET enable_partitionwise_join = on; $join_q3|,
+);
+
+is (
+    $res_stdout,
+    qq/1|i1\n3|i3\n5|i5\n11|i11\n13|i13\n15|i15/,
+    q|Check partitionwise join result|,
+);
+
+# Clean up
+# --------
+
+$node->safe_psql(qq|DROP TABLE $orders|);
+$node->safe_psql(qq|DROP TABLE $items|);
+
+$node->drop_foreign_server();
+
+foreach my $table (values %tables) {
+    $node->firebird_drop_table($table);
+}
+
+done_testing();
@@ -0,0 +1,167 @@
+#!/usr/bin/env perl
+
+# 22-result-cache.pl
+#
+# Check caching of remote query results with the "cache_ttl" table option
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+plan tests => 6;
+
+# Prepare table
+# -------------
+
+my $table_name = $node->init_table();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('en', 'English', 'English')|,
+        $table_name,
+    ),
+);
+
+$node->safe_psql(
+    sprintf(
+        q|ALTER FOREIGN TABLE %s OPTIONS (ADD cache_ttl '600')|,
+        $table_name,
+    ),
+);
+
+my $select_sql = sprintf(
+    q|SELECT name_english FROM %s WHERE lang_id = 'en'|,
+    $table_name,
+);
+
+my $count_sql = q|SELECT setting FROM firebird_fdw_diag() WHERE name = 'cached_result_count'|;
+
+# 1) Result is cached and reused
+# ------------------------------
+#
+# The cache is local to the backend, so each test is executed
+# in a single session.
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|$select_sql; $select_sql; $count_sql|,
+);
+
+is (
+    $res_stdout,
+    qq/English\nEnglish\n1/,
+    q|Check result is cached|,
+);
+
+# 2) Explicit invalidation
+# ------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|%s; SELECT firebird_fdw_cache_invalidate('%s'); %s|,
+        $select_sql,
+        $table_name,
+        $count_sql,
+    ),
+);
+
+is (
+    $res_stdout,
+    qq/English\n1\n0/,
+    q|Check cached result is invalidated explicitly|,
+);
+
+# 3) Modification via firebird_fdw invalidates the cache
+# ------------------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|%s; UPDATE %s SET name_english = 'British English' WHERE lang_id = 'en'; %s; %s|,
+        $select_sql,
+        $table_name,
+        $count_sql,
+        $select_sql,
+    ),
+);
+
+is (
+    $res_stdout,
+    qq/English\n0\nBritish English/,
+    q|Check modification invalidates cached result|,
+);
+
+# 4) Modification via firebird_fdw_query() invalidates the cache
+# ---------------------------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|%s; SELECT * FROM firebird_fdw_query('%s', $$UPDATE %s SET name_english = 'English' WHERE lang_id = 'en' RETURNING name_english$$) AS t(name_english VARCHAR(64)); %s; %s|,
+        $select_sql,
+        $node->server_name(),
+        $table_name,
+        $count_sql,
+        $select_sql,
+    ),
+);
+
+is (
+    $res_stdout,
+    qq/British English\nEnglish\n0\nEnglish/,
+    q|Check modification via firebird_fdw_query() invalidates cached result|,
+);
+
+# 5) Results larger than "firebird_fdw.cache_max_size" are not cached
+# --------------------------------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_cache_invalidate('%s'); SET firebird_fdw.cache_max_size = 0; %s; %s|,
+        $table_name,
+        $select_sql,
+        $count_sql,
+    ),
+);
+
+is (
+    $res_stdout,
+    qq/0\nEnglish\n0/,
+    q|Check result is not cached if larger than "firebird_fdw.cache_max_size"|,
+);
+
+# 6) Cache is not used for tables without "cache_ttl"
+# ---------------------------------------------------
+
+$node->safe_psql(
+    sprintf(
+        q|ALTER FOREIGN TABLE %s OPTIONS (DROP cache_ttl)|,
+        $table_name,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    qq|$select_sql; $count_sql|,
+);
+
+is (
+    $res_stdout,
+    qq/English\n0/,
+    q|Check result is not cached without "cache_ttl"|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+
+$node->firebird_drop_table($table_name);
+
+done_testing();
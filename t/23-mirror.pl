@@ -0,0 +1,181 @@
+#!/usr/bin/env perl
+
+# 23-mirror.pl
+#
+# Check creation and incremental synchronisation of local mirrors
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+plan tests => 6;
+
+# Prepare tables
+# --------------
+
+my $table_name = $node->init_table();
+my $local_name = $node->make_table_name();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('en', 'English', 'English'), ('de', 'German', 'Deutsch')|,
+        $table_name,
+    ),
+);
+
+$node->safe_psql(
+    sprintf(
+        q|CREATE TABLE %s (LIKE %s, PRIMARY KEY (lang_id))|,
+        $local_name,
+        $table_name,
+    ),
+);
+
+my $local_query = sprintf(
+    q|SELECT lang_id, name_english FROM %s ORDER BY lang_id|,
+    $local_name,
+);
+
+# 1) Local table must be empty
+# ----------------------------
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('xx', 'Local', 'Local')|,
+        $local_name,
+    ),
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_create_mirror('%s', '%s')|,
+        $table_name,
+        $local_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/is not empty/,
+    q|Check mirror creation fails for non-empty local table|,
+);
+
+$node->safe_psql(qq|DELETE FROM $local_name|);
+
+# 2) Initial copy
+# ---------------
+
+$node->safe_psql(
+    sprintf(
+        q|SELECT firebird_fdw_create_mirror('%s', '%s')|,
+        $table_name,
+        $local_name,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($local_query);
+
+is (
+    $res_stdout,
+    qq/de|German\nen|English/,
+    q|Check mirror initial copy|,
+);
+
+# 3) Changes made in Firebird are applied
+# ---------------------------------------
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|UPDATE %s SET name_english = 'British English' WHERE lang_id = 'en'|,
+        $table_name,
+    ),
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|DELETE FROM %s WHERE lang_id = 'de'|,
+        $table_name,
+    ),
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('fr', 'French', 'Français')|,
+        $table_name,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_sync_mirror('%s')|,
+        $table_name,
+    ),
+);
+
+is (
+    $res_stdout,
+    '3',
+    q|Check number of changed rows applied|,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($local_query);
+
+is (
+    $res_stdout,
+    qq/en|British English\nfr|French/,
+    q|Check mirror synchronisation|,
+);
+
+# 4) Change log is emptied after synchronisation
+# ----------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    q|SELECT firebird_fdw_sync_mirror()|,
+);
+
+is (
+    $res_stdout,
+    '0',
+    q|Check no changes pending after synchronisation|,
+);
+
+# 5) Dropping the mirror
+# ----------------------
+
+$node->safe_psql(
+    sprintf(
+        q|SELECT firebird_fdw_drop_mirror('%s')|,
+        $table_name,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    q|SELECT count(*) FROM firebird_fdw_mirror|,
+);
+
+is (
+    $res_stdout,
+    '0',
+    q|Check mirror is dropped|,
+);
+
+# Clean up
+# --------
+
+$node->safe_psql(qq|DROP TABLE $local_name|);
+
+$node->drop_foreign_server();
+
+$node->firebird_drop_table($table_name);
+
+done_testing();
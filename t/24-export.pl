@@ -0,0 +1,104 @@
+#!/usr/bin/env perl
+
+# 24-export.pl
+#
+# Check export of remote query results with firebird_fdw_export()
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+plan tests => 3;
+
+# Prepare table
+# -------------
+
+my $table_name = $node->init_table();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('en', 'English', 'English'), ('zz', 'Quote "and", comma', 'Tab	and \\ backslash')|,
+        $table_name,
+    ),
+);
+
+my $export_file = sprintf(
+    q|%s/export.out|,
+    $node->{postgres_node}->basedir(),
+);
+
+my $export_query = sprintf(
+    q|SELECT lang_id, name_english, name_native FROM %s ORDER BY lang_id|,
+    $table_name,
+);
+
+sub read_export_file {
+    open(my $fh, '<', $export_file) or die "unable to open $export_file: $!";
+    local $/;
+    my $contents = <$fh>;
+    close($fh);
+    return $contents;
+}
+
+# 1) CSV format
+# -------------
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_export('%s', '%s', '%s', 'csv', true)|,
+        $node->server_name(),
+        $export_query,
+        $export_file,
+    ),
+);
+
+is (
+    $res_stdout,
+    '2',
+    q|Check number of rows exported|,
+);
+
+is (
+    read_export_file(),
+    qq/LANG_ID,NAME_ENGLISH,NAME_NATIVE\nen,English,English\nzz,"Quote ""and"", comma",Tab\tand \\ backslash\n/,
+    q|Check CSV export|,
+);
+
+# 2) Text format
+# --------------
+
+$node->safe_psql(
+    sprintf(
+        q|SELECT firebird_fdw_export('%s', '%s', '%s', 'text')|,
+        $node->server_name(),
+        $export_query,
+        $export_file,
+    ),
+);
+
+is (
+    read_export_file(),
+    qq/en\tEnglish\tEnglish\nzz\tQuote "and", comma\tTab\\tand \\\\ backslash\n/,
+    q|Check text export|,
+);
+
+# Clean up
+# --------
+
+unlink($export_file);
+
+$node->drop_foreign_server();
+
+$node->firebird_drop_table($table_name);
+
+done_testing();
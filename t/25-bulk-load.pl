@@ -0,0 +1,178 @@
+#!/usr/bin/env perl
+
+# 25-bulk-load.pl
+#
+# Check bulk loading via Firebird external tables with firebird_fdw_bulk_load()
+#
+# The Firebird server must be able to read files in the directory specified
+# by FIREBIRD_FDW_EXTERNAL_FILE_DIRECTORY via the directory's group, and the
+# directory must also be permitted by its "ExternalFileAccess" setting.
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+if (!defined($ENV{'FIREBIRD_FDW_EXTERNAL_FILE_DIRECTORY'})) {
+    plan skip_all => q|FIREBIRD_FDW_EXTERNAL_FILE_DIRECTORY not set|;
+}
+else {
+    plan tests => 6;
+}
+
+# Prepare table
+# -------------
+
+my $table_name = $node->init_table(
+    definition_fb => [
+        ['LANG_ID',      'CHAR(2) NOT NULL PRIMARY KEY'],
+        ['NAME_ENGLISH', 'VARCHAR(64) NOT NULL'],
+        ['NAME_NATIVE',  'VARCHAR(64)'],
+    ],
+    definition_pg => [
+        ['LANG_ID',      'CHAR(2) NOT NULL'],
+        ['NAME_ENGLISH', 'VARCHAR(64) NOT NULL'],
+        ['NAME_NATIVE',  'VARCHAR(64)'],
+    ],
+);
+
+$node->add_server_option(
+    'external_file_directory',
+    $ENV{'FIREBIRD_FDW_EXTERNAL_FILE_DIRECTORY'},
+);
+
+# 1) Load rows, including NULLs and multibyte characters
+# ------------------------------------------------------
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_bulk_load('%s', $$SELECT * FROM (VALUES ('en', 'English', NULL), ('fr', 'French', 'Français'), ('jp', 'Japanese', '日本語')) v$$)|,
+        $table_name,
+    ),
+);
+
+is (
+    $res_stdout,
+    '3',
+    q|Check number of rows loaded|,
+);
+
+# 2) Check loaded rows
+# --------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT lang_id, name_english, name_native IS NULL, name_native FROM %s ORDER BY lang_id|,
+        $table_name,
+    ),
+);
+
+is (
+    $res_stdout,
+    qq/en|English|t|\nfr|French|f|Français\njp|Japanese|f|日本語/,
+    q|Check loaded rows|,
+);
+
+# 3) Value too long for column
+# ----------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_bulk_load('%s', $$SELECT 'xxxxxxxxxxxx', 'x', 'x'$$)|,
+        $table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/value too long for Firebird column/,
+    q|Check overlong value is rejected|,
+);
+
+# 4) Chunked load, split into parts and resumed
+# ----------------------------------------------
+
+$node->safe_psql(qq|DELETE FROM $table_name|);
+
+my $parts_query = q{SELECT lpad(i::text, 2, '0'), 'Lang ' || i, NULL FROM generate_series(1, 10) i ORDER BY i};
+
+foreach my $part (0, 1) {
+    $node->safe_psql(
+        sprintf(
+            q|SELECT firebird_fdw_bulk_load('%s', $$%s$$, commit_every => 2, resume_from => 4, part => %i, parts => 2)|,
+            $table_name,
+            $parts_query,
+            $part,
+        ),
+    );
+}
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT string_agg(lang_id, ',' ORDER BY lang_id) FROM %s|,
+        $table_name,
+    ),
+);
+
+is (
+    $res_stdout,
+    '05,06,07,08,09,10',
+    q|Check rows loaded in parts from resume point|,
+);
+
+# 5) Resume point reported on error
+# ---------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_bulk_load('%s', $$SELECT * FROM (VALUES ('aa', 'A', NULL), ('bb', 'B', NULL), ('cc', NULL, NULL)) v$$, commit_every => 1)|,
+        $table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/2 rows committed, resume with resume_from => 2/,
+    q|Check resume point is reported|,
+);
+
+# 6) Foreign table not updatable
+# ------------------------------
+
+$node->safe_psql(
+    sprintf(
+        q|ALTER FOREIGN TABLE %s OPTIONS (ADD updatable 'false')|,
+        $table_name,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT firebird_fdw_bulk_load('%s', $$SELECT 'zz', 'Z', NULL$$)|,
+        $table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/unable to bulk load into foreign table/,
+    q|Check bulk load into non-updatable foreign table is rejected|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+
+$node->firebird_drop_table($table_name);
+
+done_testing();
@@ -0,0 +1,217 @@
+#!/usr/bin/env perl
+
+# 26-procedures.pl
+#
+# Check foreign tables defined as selectable stored procedures, with
+# input parameters supplied from WHERE clause conditions
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+our $node = FirebirdFDWNode->new();
+
+our $version = $node->pg_version();
+
+plan tests => 8;
+
+# Prepare table and procedure
+# ---------------------------
+
+my $table_name = $node->init_table();
+my $proc_name = $node->make_table_name();
+my $proc_table_name = $node->make_table_name();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch'), ('el', 'Greek', 'Ελληνικά'), ('en', 'English', 'English')|,
+        $table_name,
+    ),
+);
+
+$node->firebird_execute_sql(
+    sprintf(
+        <<'EO_SQL',
+CREATE PROCEDURE %s (p_prefix VARCHAR(10))
+RETURNS (lang_id CHAR(2), name_english VARCHAR(64))
+AS
+BEGIN
+  FOR SELECT lang_id, name_english
+        FROM %s
+       WHERE name_english STARTING WITH :p_prefix
+        INTO :lang_id, :name_english
+  DO SUSPEND;
+END
+EO_SQL
+        $proc_name,
+        $table_name,
+    ),
+);
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+CREATE FOREIGN TABLE %s (
+  prefix VARCHAR(10) OPTIONS (procedure_parameter '1'),
+  lang_id CHAR(2),
+  name_english VARCHAR(64)
+)
+SERVER %s
+OPTIONS (procedure '%s', estimated_row_count '10')
+EO_SQL
+        $proc_table_name,
+        $node->server_name(),
+        $proc_name,
+    ),
+);
+
+# 1) Parameter value passed to the procedure
+# ------------------------------------------
+
+my $proc_query = sprintf(
+    q|SELECT prefix, lang_id, name_english FROM %s WHERE prefix = 'G' ORDER BY lang_id|,
+    $proc_table_name,
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql($proc_query);
+
+is (
+    $res_stdout,
+    qq/G|de|German\nG|el|Greek/,
+    q|Check procedure called with parameter|,
+);
+
+# 2) Parameter is sent as procedure argument
+# ------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(qq|EXPLAIN (VERBOSE, COSTS OFF) $proc_query|);
+
+like (
+    $res_stdout,
+    qr/FROM $proc_name\(\?\)$/mi,
+    q|Check parameter is passed as procedure argument|,
+);
+
+# 3) Other conditions are combined with the parameter
+# ---------------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT lang_id FROM %s WHERE prefix = 'G' AND lang_id <> 'de'|,
+        $proc_table_name,
+    ),
+);
+
+is (
+    $res_stdout,
+    'el',
+    q|Check additional conditions are applied|,
+);
+
+# 4) Foreign table is not updatable
+# ---------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|DELETE FROM %s WHERE prefix = 'G'|,
+        $proc_table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/unable to modify a foreign table defined as a procedure/,
+    q|Check procedure cannot be modified|,
+);
+
+# 5) Parameter compared with a list of values
+# -------------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT lang_id FROM %s WHERE prefix IN ('E', 'G')|,
+        $proc_table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/unable to determine a value for parameter column "prefix"/,
+    q|Check parameter without a value is rejected|,
+);
+
+# 6) Parameter provided by a join condition
+# -----------------------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT v.prefix, p.lang_id FROM (VALUES ('E'), ('G')) v(prefix) JOIN %s p ON p.prefix = v.prefix ORDER BY p.lang_id|,
+        $proc_table_name,
+    ),
+);
+
+is (
+    $res_stdout,
+    qq/G|de\nG|el\nE|en/,
+    q|Check procedure called for each row of a join|,
+);
+
+# 7) Parameter provided by a prepared statement parameter
+# -------------------------------------------------------
+
+SKIP: {
+    skip q|plan_cache_mode requires PostgreSQL 12 or later|, 2 if $version < 120000;
+
+    my $prepare = sprintf(
+        <<'EO_SQL',
+SET plan_cache_mode = force_generic_plan;
+PREPARE proc_query(text) AS SELECT lang_id FROM %s WHERE prefix = $1 ORDER BY lang_id;
+EO_SQL
+        $proc_table_name,
+    );
+
+    ($res, $res_stdout, $res_stderr) = $node->psql(
+        $prepare . q|EXECUTE proc_query('G'); EXECUTE proc_query('E');|,
+    );
+
+    is (
+        $res_stdout,
+        qq/de\nel\nen/,
+        q|Check generic plan called with each parameter value|,
+    );
+
+    # 8) NULL parameter value
+    # -----------------------
+
+    ($res, $res_stdout, $res_stderr) = $node->psql(
+        $prepare . q|EXECUTE proc_query(NULL);|,
+    );
+
+    is (
+        $res_stdout,
+        '',
+        q|Check NULL parameter value returns no rows|,
+    );
+}
+
+# Clean up
+# --------
+
+$node->firebird_execute_sql(
+    sprintf(
+        q|DROP PROCEDURE %s|,
+        $proc_name,
+    ),
+);
+
+$node->drop_foreign_server();
+
+$node->firebird_drop_table($table_name);
+
+done_testing();
@@ -0,0 +1,187 @@
+#!/usr/bin/env perl
+
+# 27-row-locking.pl
+#
+# Check SELECT ... FOR UPDATE is executed with "WITH LOCK"
+
+use strict;
+use warnings;
+
+use Test::More tests => 6;
+
+use IPC::Run;
+use Time::HiRes qw(time sleep);
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+my $node = FirebirdFDWNode->new();
+
+my ($version, $version_int) = $node->get_firebird_version();
+
+my $table_name = $node->init_table();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch'), ('en', 'English', 'English')|,
+        $table_name,
+    ),
+);
+
+# 1) Locking clause is added to the remote query
+# ----------------------------------------------
+
+my $q1_sql = sprintf(
+    q|SELECT lang_id, name_english FROM %s WHERE lang_id = 'de' FOR UPDATE|,
+    $table_name,
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql(qq|EXPLAIN $q1_sql|);
+
+like (
+    $res_stdout,
+    qr/Firebird query: SELECT .+, rdb\$db_key FROM \S+ WHERE \(\(.+\)\) FOR UPDATE WITH LOCK$/m,
+    q|Check FOR UPDATE is pushed down as WITH LOCK|,
+);
+
+# 2) Locked rows are returned
+# ---------------------------
+
+($res, $res_stdout, $res_stderr) = $node->psql($q1_sql);
+
+is (
+    $res_stdout,
+    q/de|German/,
+    q|Check FOR UPDATE result|,
+);
+
+# 3) SKIP LOCKED (Firebird 5.0 and later)
+# ---------------------------------------
+
+my $q3_sql = sprintf(
+    q|EXPLAIN SELECT lang_id FROM %s FOR UPDATE SKIP LOCKED|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q3_sql);
+
+if ($version_int >= 50000) {
+    like (
+        $res_stdout,
+        qr/FOR UPDATE WITH LOCK SKIP LOCKED$/m,
+        q|Check SKIP LOCKED is pushed down|,
+    );
+}
+else {
+    like (
+        $res_stderr,
+        qr/SKIP LOCKED requires Firebird 5.0 or later/,
+        q|Check SKIP LOCKED is rejected before Firebird 5.0|,
+    );
+}
+
+# 4) NOWAIT is rejected
+# ---------------------
+
+my $q4_sql = sprintf(
+    q|SELECT lang_id FROM %s FOR UPDATE NOWAIT|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q4_sql);
+
+like (
+    $res_stderr,
+    qr/NOWAIT is not supported for firebird_fdw foreign tables/,
+    q|Check NOWAIT is rejected|,
+);
+
+# 5) Locked row blocks a concurrent update
+# -----------------------------------------
+#
+# A background session holds the lock for a few seconds; an update of
+# the same row from another Firebird connection must wait until the
+# lock is released.
+
+my $lock_seconds = 4;
+
+my ($lock_stdout, $lock_stderr) = ('', '');
+
+my $lock_h = IPC::Run::start(
+    [
+        'psql', '-XAtq',
+        '-d', $node->postgres_node->connstr($node->dbname()),
+        '-c', sprintf(
+            q|BEGIN; SELECT lang_id FROM %s WHERE lang_id = 'de' FOR UPDATE; SELECT pg_sleep(%i); COMMIT;|,
+            $table_name,
+            $lock_seconds,
+        ),
+    ],
+    '>', \$lock_stdout,
+    '2>', \$lock_stderr,
+);
+
+# Give the background session time to acquire the lock
+sleep(1);
+
+my $fb_conn = $node->firebird_new_conn();
+
+my $update_start = time();
+
+# The update may fail with an update conflict once the lock is released
+eval {
+    $fb_conn->do(
+        sprintf(
+            q|UPDATE %s SET name_english = name_english WHERE lang_id = 'de'|,
+            $table_name,
+        ),
+    );
+};
+
+my $update_wait = time() - $update_start;
+
+$fb_conn->disconnect();
+
+$lock_h->finish();
+
+cmp_ok (
+    $update_wait,
+    '>=',
+    $lock_seconds - 2,
+    q|Check locked row blocks a concurrent update|,
+);
+
+# 6) Rows of a query-defined table can't be locked
+# -------------------------------------------------
+
+my $query_table_name = sprintf(q|%s_query|, $table_name);
+
+$node->safe_psql(
+    sprintf(
+        q|CREATE FOREIGN TABLE %s (lang_id CHAR(2)) SERVER %s OPTIONS (query $$SELECT lang_id FROM %s$$)|,
+        $query_table_name,
+        $node->server_name(),
+        $table_name,
+    ),
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    sprintf(
+        q|SELECT lang_id FROM %s FOR UPDATE|,
+        $query_table_name,
+    ),
+);
+
+like (
+    $res_stderr,
+    qr/unable to lock rows of a foreign table defined as a query/,
+    q|Check FOR UPDATE on a query-defined table is rejected|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+$node->firebird_drop_table($table_name);
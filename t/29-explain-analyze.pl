@@ -0,0 +1,89 @@
+#!/usr/bin/env perl
+
+# 29-explain-analyze.pl
+#
+# Check remote operation statistics are shown by EXPLAIN ANALYZE
+
+use strict;
+use warnings;
+
+use Test::More tests => 4;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+my $node = FirebirdFDWNode->new();
+
+my $table_name = $node->init_table();
+
+# 1) INSERT statistics
+# --------------------
+
+my $q1_sql = sprintf(
+    q|EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch'), ('en', 'English', 'English')|,
+    $table_name,
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql($q1_sql);
+
+like (
+    $res_stdout,
+    qr/Remote Prepare Time: [0-9.]+ ms.+Bytes Sent: 31 bytes/s,
+    q|Check EXPLAIN ANALYZE statistics for INSERT|,
+);
+
+# 2) Scan statistics
+# ------------------
+
+my $q2_sql = sprintf(
+    q|EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) SELECT lang_id FROM %s|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q2_sql);
+
+like (
+    $res_stdout,
+    qr/Remote Execution Time: [0-9.]+ ms.+Round Trips: 1.+Rows Received: 2.+Bytes Received: [0-9]+ bytes/s,
+    q|Check EXPLAIN ANALYZE statistics for a scan|,
+);
+
+# 3) No statistics without ANALYZE
+# --------------------------------
+
+my $q3_sql = sprintf(
+    q|EXPLAIN (COSTS OFF) SELECT lang_id FROM %s|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q3_sql);
+
+unlike (
+    $res_stdout,
+    qr/Round Trips/,
+    q|Check statistics are not shown without ANALYZE|,
+);
+
+# 4) Firebird counters with VERBOSE
+# ---------------------------------
+
+my $q4_sql = sprintf(
+    q|EXPLAIN (ANALYZE, VERBOSE, COSTS OFF, TIMING OFF, SUMMARY OFF) SELECT lang_id FROM %s|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q4_sql);
+
+like (
+    $res_stdout,
+    qr/Firebird Page Fetches: [0-9]+.+Firebird Natural Reads: 2/s,
+    q|Check Firebird counters are shown with VERBOSE|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+$node->firebird_drop_table($table_name);
@@ -0,0 +1,135 @@
+#!/usr/bin/env perl
+
+# 30-stat-statements.pl
+#
+# Check remote statement statistics
+
+use strict;
+use warnings;
+
+use Test::More tests => 5;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+my $node = FirebirdFDWNode->new();
+
+$node->postgres_node->append_conf(
+    'postgresql.conf',
+    q|shared_preload_libraries = 'firebird_fdw'|,
+);
+$node->postgres_node->restart();
+
+my $table_name = $node->init_table();
+
+$node->safe_psql(
+    sprintf(
+        q|INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch'), ('en', 'English', 'English')|,
+        $table_name,
+    ),
+);
+
+$node->safe_psql(q|SELECT firebird_fdw_stat_statements_reset()|);
+
+# 1) Statements differing only in constants are counted together
+# ---------------------------------------------------------------
+
+foreach my $lang_id (qw(de en)) {
+    $node->safe_psql(
+        sprintf(
+            q|SELECT * FROM %s WHERE lang_id = '%s'|,
+            $table_name,
+            $lang_id,
+        ),
+    );
+}
+
+my $q1_sql = sprintf(
+    q|SELECT server_name, calls, rows, userid = (SELECT oid FROM pg_roles WHERE rolname = current_user), dbid = (SELECT oid FROM pg_database WHERE datname = current_database()) FROM firebird_fdw_stat_statements WHERE query LIKE '%% FROM %s WHERE %%'|,
+    $table_name,
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql($q1_sql);
+
+is (
+    $res_stdout,
+    sprintf(q/%s|2|2|t|t/, $node->server_name()),
+    q|Check statement statistics|,
+);
+
+# 2) Constants are normalized
+# ---------------------------
+
+my $q2_sql = sprintf(
+    q|SELECT query LIKE '%%= ?%%' FROM firebird_fdw_stat_statements WHERE query LIKE '%% FROM %s WHERE %%'|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q2_sql);
+
+is (
+    $res_stdout,
+    q/t/,
+    q|Check query text is normalized|,
+);
+
+# 3) Conditions evaluated locally are counted
+# --------------------------------------------
+
+$node->safe_psql(
+    sprintf(
+        q|SELECT * FROM %s WHERE name_english ~ '^E'|,
+        $table_name,
+    ),
+);
+
+my $q3_sql = sprintf(
+    q|SELECT calls, local_conditions FROM firebird_fdw_stat_statements WHERE query LIKE '%% FROM %s' AND query NOT LIKE '%% WHERE %%'|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q3_sql);
+
+is (
+    $res_stdout,
+    q/1|1/,
+    q|Check conditions evaluated locally are counted|,
+);
+
+# 4) Query text hidden from other users
+# -------------------------------------
+
+$node->safe_psql(q|CREATE USER stat_user|);
+
+($res, $res_stdout, $res_stderr) = $node->psql(
+    q|SET SESSION AUTHORIZATION stat_user; SELECT DISTINCT query FROM firebird_fdw_stat_statements()|,
+);
+
+is (
+    $res_stdout,
+    q/<insufficient privilege>/,
+    q|Check query text is hidden from other users|,
+);
+
+$node->safe_psql(q|DROP USER stat_user|);
+
+# 5) Reset
+# --------
+
+$node->safe_psql(q|SELECT firebird_fdw_stat_statements_reset()|);
+
+($res, $res_stdout, $res_stderr) = $node->psql(q|SELECT COUNT(*) FROM firebird_fdw_stat_statements|);
+
+is (
+    $res_stdout,
+    q/0/,
+    q|Check statistics are reset|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+$node->firebird_drop_table($table_name);
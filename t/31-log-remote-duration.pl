@@ -0,0 +1,128 @@
+#!/usr/bin/env perl
+
+# 31-log-remote-duration.pl
+#
+# Check logging of remote statements with firebird_fdw.log_min_remote_duration
+
+use strict;
+use warnings;
+
+use Test::More tests => 4;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+my $node = FirebirdFDWNode->new();
+
+my $table_name = $node->init_table();
+
+# Return the server log output written since "$offset"
+sub log_since {
+    my $offset = shift;
+
+    open(my $fh, '<', $node->postgres_node->logfile)
+        or die "unable to open log file: $!";
+    seek($fh, $offset, 0);
+    local $/;
+    my $output = <$fh>;
+    close($fh);
+
+    return $output;
+}
+
+# 1) Statement with parameters is logged
+# --------------------------------------
+
+my $log_offset = -s $node->postgres_node->logfile;
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+SET firebird_fdw.log_min_remote_duration = 0;
+INSERT INTO %s (lang_id, name_english, name_native) VALUES ('de', 'German', 'Deutsch');
+EO_SQL
+        $table_name,
+    ),
+);
+
+like (
+    log_since($log_offset),
+    qr/remote duration: [0-9.]+ ms  statement: INSERT INTO.+Parameters: \$1 = 'de', \$2 = 'German', \$3 = 'Deutsch'/s,
+    q|Check remote statement is logged with parameters|,
+);
+
+# 2) Parameter values are redacted
+# --------------------------------
+
+$log_offset = -s $node->postgres_node->logfile;
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+SET firebird_fdw.log_min_remote_duration = 0;
+SET firebird_fdw.log_remote_parameters = off;
+INSERT INTO %s (lang_id, name_english, name_native) VALUES ('en', 'English', 'English');
+EO_SQL
+        $table_name,
+    ),
+);
+
+like (
+    log_since($log_offset),
+    qr/Parameters: \$1 = <redacted>, \$2 = <redacted>, \$3 = <redacted>/,
+    q|Check parameter values are redacted|,
+);
+
+# 3) Constants are removed from the statement
+# -------------------------------------------
+
+$log_offset = -s $node->postgres_node->logfile;
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+SET firebird_fdw.log_min_remote_duration = 0;
+SET firebird_fdw.log_remote_parameters = off;
+SELECT name_english FROM %s WHERE lang_id = 'de';
+EO_SQL
+        $table_name,
+    ),
+);
+
+my $q3_log = log_since($log_offset);
+
+like (
+    $q3_log,
+    qr/statement: SELECT[^\n]+\?/,
+    q|Check constants are replaced in the statement|,
+);
+
+# 4) Firebird plan is logged
+# --------------------------
+
+$log_offset = -s $node->postgres_node->logfile;
+
+$node->safe_psql(
+    sprintf(
+        <<'EO_SQL',
+SET firebird_fdw.log_min_remote_duration = 0;
+SET firebird_fdw.log_remote_plan = on;
+SELECT * FROM %s;
+EO_SQL
+        $table_name,
+    ),
+);
+
+like (
+    log_since($log_offset),
+    qr/remote duration: [0-9.]+ ms  rows: 2  statement: SELECT.+Firebird plan: .*PLAN/s,
+    q|Check Firebird plan is logged|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+$node->firebird_drop_table($table_name);
@@ -0,0 +1,73 @@
+#!/usr/bin/env perl
+
+# 32-local-filter-reason.pl
+#
+# Check EXPLAIN VERBOSE shows why conditions are evaluated locally
+
+use strict;
+use warnings;
+
+use Test::More tests => 3;
+
+use FirebirdFDWNode;
+
+# Initialize nodes
+# ----------------
+
+my $node = FirebirdFDWNode->new();
+
+my $table_name = $node->init_table();
+
+# 1) Unsupported operator
+# -----------------------
+
+my $q1_sql = sprintf(
+    q|EXPLAIN (VERBOSE, COSTS OFF) SELECT * FROM %s WHERE name_english ~ '^E'|,
+    $table_name,
+);
+
+my ($res, $res_stdout, $res_stderr) = $node->psql($q1_sql);
+
+like (
+    $res_stdout,
+    qr/Local filter reason: unsupported operator \(~\)/,
+    q|Check reason for an unsupported operator|,
+);
+
+# 2) Unsupported node type; the pushed-down condition has no reason
+# ------------------------------------------------------------------
+
+my $q2_sql = sprintf(
+    q|EXPLAIN (VERBOSE, COSTS OFF) SELECT * FROM %s WHERE lang_id = 'en' AND CASE WHEN name_native = 'English' THEN TRUE ELSE FALSE END|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q2_sql);
+
+like (
+    $res_stdout,
+    qr/Local filter reason: unsupported node type \(CASE\)$/m,
+    q|Check reason for an unsupported node type|,
+);
+
+# 3) No reason without VERBOSE
+# ----------------------------
+
+my $q3_sql = sprintf(
+    q|EXPLAIN (COSTS OFF) SELECT * FROM %s WHERE name_english ~ '^E'|,
+    $table_name,
+);
+
+($res, $res_stdout, $res_stderr) = $node->psql($q3_sql);
+
+unlike (
+    $res_stdout,
+    qr/Local filter reason/,
+    q|Check reason is not shown without VERBOSE|,
+);
+
+# Clean up
+# --------
+
+$node->drop_foreign_server();
+$node->firebird_drop_table($table_name);
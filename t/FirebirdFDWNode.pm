@@ -485,6 +485,10 @@ sub dbname {
     shift->{dbname};
 }
 
+sub postgres_node {
+    shift->{postgres_node};
+}
+
 sub psql {
     my $self = shift;
     my $sql = shift;
@@ -648,6 +652,28 @@ sub firebird_conn {
     shift->{firebird_dbh};
 }
 
+# Open an additional Firebird connection, e.g. to act as a concurrent
+# session; the caller is responsible for disconnecting it.
+
+sub firebird_new_conn {
+    my $self = shift;
+
+    return DBI->connect(
+        sprintf(
+            q|dbi:Firebird:host=localhost;dbname=%s;port=%i|,
+            $self->{firebird_dbname},
+            $self->{firebird_dbport},
+        ),
+        undef,
+        undef,
+        {
+            PrintError => 0,
+            RaiseError => 1,
+            AutoCommit => 1,
+        }
+    );
+}
+
 sub firebird_reconnect {
     my $self = shift;
 